@@ -11,6 +11,7 @@
 #include "2_Signal.h"
 #include "6_MQTT.h"
 #include "9_Serial2Net.h"
+#include "25_Log.h"
 
 
 
@@ -44,6 +45,8 @@ namespace RFLink { namespace Wifi {
 
         bool clientParamsHaveChanged = false; // this will be set to True when Client Wifi mode configuration has changed
         bool accessPointParamsHaveChanged = false; // this will be set to True when Client Wifi mode configuration has changed
+        bool clientBeginPending = false;            // WiFi.begin() is due at clientBeginTime, once the new IP config settled
+        unsigned long clientBeginTime;
 
 // All json variable names
         const char json_name_client_enabled[] = "client_enabled";
@@ -65,6 +68,25 @@ namespace RFLink { namespace Wifi {
 // end of json variable names
 
 
+        enum ConfigItemIndex {
+            ConfigItem_ClientEnabled,
+            ConfigItem_ClientDhcpEnabled,
+            ConfigItem_ClientSsid,
+            ConfigItem_ClientPassword,
+            ConfigItem_ClientIp,
+            ConfigItem_ClientMask,
+            ConfigItem_ClientGateway,
+            ConfigItem_ClientDns,
+            ConfigItem_ClientHostname,
+            ConfigItem_ApEnabled,
+            ConfigItem_ApSsid,
+            ConfigItem_ApPassword,
+            ConfigItem_ApIp,
+            ConfigItem_ApNetwork,
+            ConfigItem_ApMask,
+            ConfigItem_EOF,
+        };
+
         Config::ConfigItem configItems[] =  {
                 Config::ConfigItem(json_name_client_enabled,      Config::SectionId::Wifi_id, false, clientParamsUpdatedCallback),
                 Config::ConfigItem(json_name_client_dhcp_enabled, Config::SectionId::Wifi_id, true, clientParamsUpdatedCallback),
@@ -85,61 +107,62 @@ namespace RFLink { namespace Wifi {
 
                 Config::ConfigItem()
         };
+        static_assert(sizeof(configItems) / sizeof(Config::ConfigItem) == ConfigItem_EOF + 1, "configItems has missing/extra items, please compare with ConfigItemIndex enum declarations");
 
         void refreshClientParametersFromConfig(bool triggerChanges=true) {
 
           Config::ConfigItem *item;
           bool changesDetected = false;
 
-          item = Config::findConfigItem(json_name_client_enabled, Config::SectionId::Wifi_id);
+          item = &configItems[ConfigItem_ClientEnabled];
           if( item->getBoolValue() != params::client_enabled) {
             changesDetected = true;
             params::client_enabled = item->getBoolValue();
           }
 
-          item = Config::findConfigItem(json_name_client_dhcp_enabled, Config::SectionId::Wifi_id);
+          item = &configItems[ConfigItem_ClientDhcpEnabled];
           if( item->getBoolValue() != params::client_dhcp_enabled) {
             changesDetected = true;
             params::client_dhcp_enabled = item->getBoolValue();
           }
 
-          item = Config::findConfigItem(json_name_client_ssid, Config::SectionId::Wifi_id);
+          item = &configItems[ConfigItem_ClientSsid];
           if( params::client_ssid != item->getCharValue() ) {
             changesDetected = true;
             params::client_ssid = item->getCharValue();
           }
 
-          item = Config::findConfigItem(json_name_client_password, Config::SectionId::Wifi_id);
+          item = &configItems[ConfigItem_ClientPassword];
           if( params::client_password != item->getCharValue() ) {
             changesDetected = true;
             params::client_password = item->getCharValue();
           }
 
-          item = Config::findConfigItem(json_name_client_ip, Config::SectionId::Wifi_id);
+          item = &configItems[ConfigItem_ClientIp];
           if( params::client_ip != item->getCharValue() ) {
             changesDetected = true;
             params::client_ip = item->getCharValue();
           }
 
-          item = Config::findConfigItem(json_name_client_mask, Config::SectionId::Wifi_id);
+          item = &configItems[ConfigItem_ClientMask];
           if( params::client_mask != item->getCharValue() ) {
             changesDetected = true;
             params::client_mask = item->getCharValue();
           }
 
-          item = Config::findConfigItem(json_name_client_gateway, Config::SectionId::Wifi_id);
+          item = &configItems[ConfigItem_ClientGateway];
           if( params::client_gateway != item->getCharValue() ) {
             changesDetected = true;
             params::client_gateway = item->getCharValue();
           }
 
-          item = Config::findConfigItem(json_name_client_dns, Config::SectionId::Wifi_id);
+          item = &configItems[ConfigItem_ClientDns];
           if( params::client_dns != item->getCharValue() ) {
             changesDetected = true;
             params::client_dns = item->getCharValue();
           }
 
-          item = Config::findConfigItem(json_name_client_hostname, Config::SectionId::Wifi_id);
+          item = &configItems[ConfigItem_ClientHostname];
           if( params::client_hostname != item->getCharValue() ) {
             changesDetected = true;
             params::client_hostname = item->getCharValue();
@@ -148,7 +171,7 @@ namespace RFLink { namespace Wifi {
           // Applying changes will happen in mainLoop()
           if(triggerChanges && changesDetected) {
             clientParamsHaveChanged = true;
-            Serial.println(F("Client Wifi settings haver changed and will be applied at next loop"));
+            Log::printf(Log::Module_Wifi, Log::Level_Info, PSTR("Client Wifi settings haver changed and will be applied at next loop"));
           }
         }
 
@@ -157,37 +180,37 @@ namespace RFLink { namespace Wifi {
           Config::ConfigItem *item;
           bool changesDetected = false;
 
-          item = Config::findConfigItem(json_name_ap_enabled, Config::SectionId::Wifi_id);
+          item = &configItems[ConfigItem_ApEnabled];
           if( item->getBoolValue() != params::AP_enabled) {
             changesDetected = true;
             params::AP_enabled = item->getBoolValue();
           }
 
-          item = Config::findConfigItem(json_name_ap_ssid, Config::SectionId::Wifi_id);
+          item = &configItems[ConfigItem_ApSsid];
           if( params::AP_ssid != item->getCharValue() ) {
             changesDetected = true;
             params::AP_ssid = item->getCharValue();
           }
 
-          item = Config::findConfigItem(json_name_ap_password, Config::SectionId::Wifi_id);
+          item = &configItems[ConfigItem_ApPassword];
           if( params::AP_password != item->getCharValue() ) {
             changesDetected = true;
             params::AP_password = item->getCharValue();
           }
 
-          item = Config::findConfigItem(json_name_ap_ip, Config::SectionId::Wifi_id);
+          item = &configItems[ConfigItem_ApIp];
           if( params::AP_ip != item->getCharValue() ) {
             changesDetected = true;
             params::AP_ip = item->getCharValue();
           }
 
-          item = Config::findConfigItem(json_name_ap_network, Config::SectionId::Wifi_id);
+          item = &configItems[ConfigItem_ApNetwork];
           if( params::AP_network != item->getCharValue() ) {
             changesDetected = true;
             params::AP_network = item->getCharValue();
           }
 
-          item = Config::findConfigItem(json_name_ap_mask, Config::SectionId::Wifi_id);
+          item = &configItems[ConfigItem_ApMask];
           if( params::AP_mask != item->getCharValue() ) {
             changesDetected = true;
             params::AP_mask = item->getCharValue();
@@ -196,7 +219,7 @@ namespace RFLink { namespace Wifi {
           // Applying changes will happen in mainLoop()
           if(triggerChanges && changesDetected) {
             accessPointParamsHaveChanged = true;
-            Serial.println(F("AP Wifi settings haver changed and will be applied at next loop"));
+            Log::printf(Log::Module_Wifi, Log::Level_Info, PSTR("AP Wifi settings haver changed and will be applied at next loop"));
           }
 
         }
@@ -243,16 +266,12 @@ namespace RFLink { namespace Wifi {
               WiFi.config(IPAddress((uint32_t) 0), IPAddress((uint32_t) 0), IPAddress((uint32_t) 0));
             }
 
-            delay(500);
-            if(!WiFi.isConnected() || WiFi.SSID() != params::client_ssid) {
-              WiFi.begin(params::client_ssid.c_str(), params::client_password.c_str());
-            }
-
-            WiFi.setAutoConnect(true);
-            WiFi.setAutoReconnect(true);
-
+            // the rest is done by mainLoop(), so the receiver is not stalled meanwhile
+            clientBeginTime = millis() + 500;
+            clientBeginPending = true;
           }
           else {
+            clientBeginPending = false;
             Serial.println(F("WiFi Client mode will be disconnected"));
             WiFi.setAutoConnect(false);
             WiFi.setAutoReconnect(false);
@@ -311,7 +330,7 @@ namespace RFLink { namespace Wifi {
 
         void reconnectServices() {
           if(RFLink::Mqtt::params::enabled)
-            RFLink::Mqtt::reconnect(1, true);
+            RFLink::Mqtt::reconnect(true);
           if(RFLink::Serial2Net::params::enabled)
             RFLink::Serial2Net::restartServer();
         }
@@ -464,6 +483,16 @@ void eventHandler_WiFiStationDisconnected(const WiFiEventStationModeDisconnected
             resetClientWifi();
           }
 
+          if( clientBeginPending && (long)(millis() - clientBeginTime) >= 0 ) {
+            clientBeginPending = false;
+            if(!WiFi.isConnected() || WiFi.SSID() != params::client_ssid) {
+              WiFi.begin(params::client_ssid.c_str(), params::client_password.c_str());
+            }
+
+            WiFi.setAutoConnect(true);
+            WiFi.setAutoReconnect(true);
+          }
+
 
 #if defined(RFLINK_OTA_ENABLED)
           ArduinoOTA.handle();
@@ -14,6 +14,11 @@
 #include "9_Serial2Net.h"
 #include "10_Wifi.h"
 #include "12_Portal.h"
+#include "18_Multicast.h"
+#include "20_Devices.h"
+#include "21_Filter.h"
+#include "25_Log.h"
+#include "26_SerialTx.h"
 
 #if defined(DEBUG) || defined(RFLINK_DEBUG)
 #define DEBUG_RFLINK_CONFIG
@@ -32,6 +37,7 @@ namespace RFLink
         }
 
         const char configFileName[] = "/config.json";
+        const char snapshotFileName[] = "/config.bin";
 
         const char *jsonSections[] = {
             "wifi",
@@ -42,6 +48,11 @@ namespace RFLink
             "signal",
             "radio",
             "serial2net",
+            "multicast",
+            "devices",
+            "filter",
+            "log",
+            "serial",
             "root" // this is always the last one and matches index SectionId::EOF_id
         };
 #define jsonSections_count sizeof(jsonSections) / sizeof(char *)
@@ -52,15 +63,20 @@ namespace RFLink
 #if defined(RFLINK_WIFI_ENABLED)
             &RFLink::Wifi::configItems[0],
             &RFLink::Mqtt::configItems[0],
+            &RFLink::Multicast::configItems[0],
 #endif
             &RFLink::Portal::configItems[0],
             &RFLink::Signal::configItems[0],
             &RFLink::Radio::configItems[0],
             &RFLink::Serial2Net::configItems[0],
+            &RFLink::Devices::configItems[0],
+            &RFLink::Filter::configItems[0],
+            &RFLink::Log::configItems[0],
+            &RFLink::SerialTx::configItems[0],
         };
 #define configItemListsSize (sizeof(configItemLists) / sizeof(ConfigItem *))
 
-        StaticJsonDocument<4096> doc;
+        void removeSnapshot();
 
         void resetConfig()
         {
@@ -71,6 +87,7 @@ namespace RFLink
             if (LittleFS.exists(configFileName))
                 LittleFS.remove(configFileName);
 #endif
+            removeSnapshot();
 
             Serial.println(F("Config has been reset and requires a reboot to complete"));
         }
@@ -122,73 +139,231 @@ namespace RFLink
             return nullptr;
         }
 
-        void setup()
+        fs::FS &fileSystem()
         {
-            Serial.print(F("Loading persistent filesystem... "));
-
 #ifdef ESP32
-            if (!LITTLEFS.begin(true))
+            return LITTLEFS;
+#else
+            return LittleFS;
+#endif
+        }
+
+        /**
+         * Binary image of every item, in configItemLists order:
+         * long as 4 bytes, bool as 1 byte, string as 2 bytes length + characters (no terminator).
+         * It is trusted only if version, schema, JSON file contents hash and checksum all match.
+         * */
+        struct SnapshotHeader
+        {
+            uint32_t magic;
+            uint16_t version;
+            uint16_t itemCount;
+            uint32_t schemaHash;   // names, sections and types of the items, changes with the firmware
+            uint32_t jsonFileHash; // config.json was edited behind our back if this does not match
+            uint32_t payloadSize;
+            uint32_t checksum;     // of the payload
+        };
+
+        const uint32_t snapshotMagic = 0x434C4652; // "RFLC"
+
+        uint32_t fnv1a(const uint8_t *data, size_t length, uint32_t hash = 2166136261UL)
+        {
+            for (size_t i = 0; i < length; i++)
+                hash = (hash ^ data[i]) * 16777619UL;
+            return hash;
+        }
+
+        void snapshotSchema(uint16_t &itemCount, uint32_t &schemaHash, uint32_t &payloadSize)
+        {
+            itemCount = 0;
+            schemaHash = 2166136261UL;
+            payloadSize = 0;
+
+            for (unsigned int i = 0; i < configItemListsSize; i++)
             {
-                Serial.println(F(" FAILED!!"));
-                return;
+                for (ConfigItem *item = configItemLists[i]; !item->typeIsEOF(); item++)
+                {
+                    uint8_t tags[2] = {(uint8_t)item->section, (uint8_t)item->type};
+                    schemaHash = fnv1a(tags, sizeof(tags), schemaHash);
+                    schemaHash = fnv1a((const uint8_t *)item->json_name, strlen(item->json_name), schemaHash);
+                    itemCount++;
+
+                    if (item->typeIsLongInt())
+                        payloadSize += sizeof(int32_t);
+                    else if (item->typeIsBool())
+                        payloadSize += 1;
+                    else if (item->typeIsChar())
+                        payloadSize += sizeof(uint16_t) + strlen(item->getCharValue());
+                }
             }
-            Serial.print(F("OK. "));
+        }
 
-            Serial.printf_P(PSTR("File system usage: %u/%uKB.\r\n"), LITTLEFS.usedBytes() / 1024, LITTLEFS.totalBytes() / 1024);
-#else // this is ESP8266
-            if (!LittleFS.begin())
+        uint32_t jsonFileHash()
+        {
+            uint32_t hash = 2166136261UL;
+            File file = fileSystem().open(configFileName, "r");
+            if (!file)
+                return hash;
+            uint8_t chunk[128];
+            size_t length;
+            while ((length = file.read(chunk, sizeof(chunk))) > 0)
+                hash = fnv1a(chunk, length, hash);
+            file.close();
+            return hash;
+        }
+
+        void removeSnapshot()
+        {
+            if (fileSystem().exists(snapshotFileName))
+                fileSystem().remove(snapshotFileName);
+        }
+
+        bool saveSnapshotToFlash()
+        {
+            SnapshotHeader header;
+            header.magic = snapshotMagic;
+            header.version = CONFIG_SNAPSHOT_VERSION;
+            snapshotSchema(header.itemCount, header.schemaHash, header.payloadSize);
+            header.jsonFileHash = jsonFileHash();
+
+            uint8_t *payload = (uint8_t *)malloc(header.payloadSize);
+            if (payload == nullptr)
             {
-                Serial.println(F(" FAILED!!"));
-                return;
+                removeSnapshot(); // an old one would not match config.json anymore
+                return false;
             }
-            Serial.print(F("OK. "));
-
-            FSInfo info;
-            LittleFS.info(info);
-            Serial.printf_P(PSTR("File system usage: %u/%uKB.\r\n"), info.usedBytes / 1024, info.totalBytes / 1024);
-#endif
 
-            // DEBUG ONLY? Let's iterate over all registered configItems and count them/sanitize
+            uint8_t *cursor = payload;
             for (unsigned int i = 0; i < configItemListsSize; i++)
             {
-                ConfigItem *item = configItemLists[i];
-
-                while (!item->typeIsEOF())
+                for (ConfigItem *item = configItemLists[i]; !item->typeIsEOF(); item++)
                 {
-                    if (item->typeIsChar())
+                    if (item->typeIsLongInt())
                     {
-#ifdef DEBUG_RFLINK_CONFIG
-                        Serial.printf(PSTR("added configitem '%s' with default_value="), item->json_name);
-                        Serial.println(item->getCharDefaultValue());
-#endif
+                        int32_t value = item->getLongIntValue();
+                        memcpy(cursor, &value, sizeof(value));
+                        cursor += sizeof(value);
                     }
-                    else if (item->typeIsLongInt())
+                    else if (item->typeIsBool())
                     {
-#ifdef DEBUG_RFLINK_CONFIG
-                        sprintf(tmp, "added configitem '%s' with default_value=", item->json_name);
-                        Serial.print(tmp);
-                        Serial.println(item->getLongIntDefaultValue());
-#endif
+                        *cursor++ = item->getBoolValue() ? 1 : 0;
+                    }
+                    else if (item->typeIsChar())
+                    {
+                        uint16_t length = strlen(item->getCharValue());
+                        memcpy(cursor, &length, sizeof(length));
+                        cursor += sizeof(length);
+                        memcpy(cursor, item->getCharValue(), length);
+                        cursor += length;
+                    }
+                }
+            }
+            header.checksum = fnv1a(payload, header.payloadSize);
+
+            if (fileSystem().exists(F("/tmp.bin")))
+                fileSystem().remove(F("/tmp.bin"));
+            File file = fileSystem().open(F("/tmp.bin"), "w");
+            bool written = file &&
+                           file.write((const uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+                           file.write(payload, header.payloadSize) == header.payloadSize;
+            file.close();
+            free(payload);
+
+            removeSnapshot();
+            if (!written)
+            {
+                Serial.println(F("Failed to write config snapshot"));
+                return false;
+            }
+            fileSystem().rename(F("/tmp.bin"), snapshotFileName);
+            return true;
+        }
+
+        /**
+         * @return false if there is no usable snapshot, items are then left for loadConfigFromJsonFile()
+         * */
+        bool loadConfigFromSnapshot()
+        {
+            File file = fileSystem().open(snapshotFileName, "r");
+            if (!file)
+                return false;
+
+            SnapshotHeader header, expected;
+            bool valid = file.read((uint8_t *)&header, sizeof(header)) == sizeof(header);
+            snapshotSchema(expected.itemCount, expected.schemaHash, expected.payloadSize);
+            valid = valid &&
+                    header.magic == snapshotMagic &&
+                    header.version == CONFIG_SNAPSHOT_VERSION &&
+                    header.itemCount == expected.itemCount &&
+                    header.schemaHash == expected.schemaHash &&
+                    header.payloadSize == file.size() - sizeof(header);
+
+            // one spare byte so that the last string can be terminated in place
+            uint8_t *payload = valid ? (uint8_t *)malloc(header.payloadSize + 1) : nullptr;
+            valid = payload != nullptr &&
+                    file.read(payload, header.payloadSize) == header.payloadSize &&
+                    header.checksum == fnv1a(payload, header.payloadSize);
+            file.close();
+
+            valid = valid && header.jsonFileHash == jsonFileHash();
+
+            uint8_t *cursor = payload;
+            const uint8_t *end = payload + header.payloadSize;
+            for (unsigned int i = 0; valid && i < configItemListsSize; i++)
+            {
+                for (ConfigItem *item = configItemLists[i]; valid && !item->typeIsEOF(); item++)
+                {
+                    if (item->typeIsLongInt())
+                    {
+                        int32_t value;
+                        valid = cursor + sizeof(value) <= end;
+                        if (!valid)
+                            break;
+                        memcpy(&value, cursor, sizeof(value));
+                        cursor += sizeof(value);
+                        item->setLongIntValue(value);
                     }
                     else if (item->typeIsBool())
                     {
-#ifdef DEBUG_RFLINK_CONFIG
-                        sprintf(tmp, "added configitem '%s' with default_value=", item->json_name);
-                        Serial.print(tmp);
-                        Serial.println(item->getBoolDefaultValue());
-#endif
+                        valid = cursor < end;
+                        if (!valid)
+                            break;
+                        item->setBoolValue(*cursor++ != 0);
                     }
-                    else
+                    else if (item->typeIsChar())
                     {
-                        Serial.print(F("unsupported configitem type="));
-                        Serial.println(item->type);
+                        uint16_t length;
+                        valid = cursor + sizeof(length) <= end;
+                        if (!valid)
+                            break;
+                        memcpy(&length, cursor, sizeof(length));
+                        cursor += sizeof(length);
+                        valid = cursor + length <= end;
+                        if (!valid)
+                            break;
+                        // terminate in place, the byte belongs to the next item and is restored right after
+                        uint8_t next = cursor[length];
+                        cursor[length] = 0;
+                        item->setCharValue((const char *)cursor);
+                        cursor[length] = next;
+                        cursor += length;
                     }
-
-                    item++;
                 }
             }
-            //sprintf(tmp, "Counted %i config items in total", countConfigItems);
-            //Serial.println(tmp);
+
+            free(payload);
+            if (!valid)
+                Serial.println(F("Config snapshot does not match, loading JSON file"));
+            return valid;
+        }
+
+        /**
+         * Copies values from the JSON file into their items
+         * @return true if the file must be rewritten (missing, extra or mistyped values)
+         * */
+        bool loadConfigFromJsonFile()
+        {
+            bool fileHasChanged = false;
 
             Serial.printf(PSTR("Now opening JSON config file '%s'\r\n"), configFileName);
 
@@ -198,27 +373,23 @@ namespace RFLink
             File file = LittleFS.open(configFileName, "r");
 #endif
 
+            DynamicJsonDocument doc(CONFIG_JSON_DOCUMENT_SIZE); // released as soon as values are copied into their items
             DeserializationError error = deserializeJson(doc, file);
             if (error)
                 Serial.println(F("Failed to read file, using default configuration"));
             file.close();
 
-            Serial.printf_P(PSTR("JSON file mem usage: %u / %u\r\n"), doc.memoryUsage(), doc.memoryPool().capacity());
-
-            bool fileHasChanged = false;
+            Serial.printf_P(PSTR("JSON file mem usage: %u / %u\r\n"), doc.memoryUsage(), doc.capacity());
 
-            // We're hunting extra configurations which dont exist in json
+            // We're hunting extra configurations which dont exist in json, they are dropped on next save
             auto root = doc.as<JsonObject>();
             for (JsonPair kv : root)
             {
-                //Serial.print("Remote has root object named: ");
-                //Serial.println(kv.key().c_str());
-
                 JsonVariant &&section_variant = kv.value();
                 if (!section_variant.is<JsonObject>())
                 {
                     Serial.printf_P(PSTR("root entry '%s'  is not an object, it will be discarded\r\n"), kv.key().c_str());
-                    root.remove(kv.key().c_str());
+                    fileHasChanged = true;
                     continue;
                 }
                 JsonObject &&sectionObject = section_variant.as<JsonObject>();
@@ -227,68 +398,158 @@ namespace RFLink
                 if (lookupSectionID == SectionId::EOF_id)
                 {
                     Serial.printf_P(PSTR("root entry '%s' is not a valid section name, it will be discarded\r\n"), kv.key().c_str());
-                    root.remove(kv.key().c_str());
+                    fileHasChanged = true;
                     continue;
                 }
 
                 // from here we have a valid section, now we go down a level in the remote object
                 for (JsonPair section_kv : sectionObject)
                 {
-                    //Serial.print("Remote section has item named: ");
-                    //Serial.println(section_kv.key().c_str());
-
                     ConfigItem *item = findConfigItem(section_kv.key().c_str(), lookupSectionID);
                     if (item == nullptr)
                     {
                         Serial.printf_P(PSTR("section '%s' has extra configuration item named '%s'  it will be dicarded\r\n"), kv.key().c_str(), section_kv.key().c_str());
-                        sectionObject.remove(section_kv.key().c_str());
                         fileHasChanged = true;
                         continue;
                     }
                 }
             }
 
-            // Let's fill missing json config with their default values
+            // Let's copy values into their items, missing ones get their default values
             for (unsigned int i = 0; i < configItemListsSize; i++)
             {
                 ConfigItem *item = configItemLists[i];
 
                 while (!item->typeIsEOF())
                 {
-                    JsonVariant sectionVariant = doc[jsonSections[item->section]];
-                    JsonObject sectionObject;
+                    JsonObject sectionObject = doc[jsonSections[item->section]];
 
-                    if (sectionVariant.isUndefined())
+                    if (item->loadFromJsonObject(sectionObject))
                     {
                         fileHasChanged = true;
-                        sectionObject = doc.createNestedObject(jsonSections[item->section]);
                     }
-                    else if (!sectionVariant.is<JsonObject>())
+
+                    item++;
+                }
+            }
+
+            return fileHasChanged;
+        }
+
+        void setup()
+        {
+            Serial.print(F("Loading persistent filesystem... "));
+
+#ifdef ESP32
+            if (!LITTLEFS.begin(true))
+            {
+                Serial.println(F(" FAILED!!"));
+                return;
+            }
+            Serial.print(F("OK. "));
+
+            Serial.printf_P(PSTR("File system usage: %u/%uKB.\r\n"), LITTLEFS.usedBytes() / 1024, LITTLEFS.totalBytes() / 1024);
+#else // this is ESP8266
+            if (!LittleFS.begin())
+            {
+                Serial.println(F(" FAILED!!"));
+                return;
+            }
+            Serial.print(F("OK. "));
+
+            FSInfo info;
+            LittleFS.info(info);
+            Serial.printf_P(PSTR("File system usage: %u/%uKB.\r\n"), info.usedBytes / 1024, info.totalBytes / 1024);
+#endif
+
+            // DEBUG ONLY? Let's iterate over all registered configItems and count them/sanitize
+            for (unsigned int i = 0; i < configItemListsSize; i++)
+            {
+                ConfigItem *item = configItemLists[i];
+
+                while (!item->typeIsEOF())
+                {
+                    if (item->typeIsChar())
                     {
-                        fileHasChanged = true;
-                        doc.remove(sectionVariant);
-                        sectionObject = doc.createNestedObject(jsonSections[item->section]);
+#ifdef DEBUG_RFLINK_CONFIG
+                        Serial.printf(PSTR("added configitem '%s' with default_value="), item->json_name);
+                        Serial.println(item->getCharDefaultValue());
+#endif
                     }
-                    else
+                    else if (item->typeIsLongInt())
                     {
-                        sectionObject = sectionVariant.as<JsonObject>();
+#ifdef DEBUG_RFLINK_CONFIG
+                        sprintf(tmp, "added configitem '%s' with default_value=", item->json_name);
+                        Serial.print(tmp);
+                        Serial.println(item->getLongIntDefaultValue());
+#endif
                     }
-
-                    if (item->checkOrCreateValueInJsonObject(sectionObject))
+                    else if (item->typeIsBool())
                     {
-                        fileHasChanged = true;
+#ifdef DEBUG_RFLINK_CONFIG
+                        sprintf(tmp, "added configitem '%s' with default_value=", item->json_name);
+                        Serial.print(tmp);
+                        Serial.println(item->getBoolDefaultValue());
+#endif
+                    }
+                    else
+                    {
+                        Serial.print(F("unsupported configitem type="));
+                        Serial.println(item->type);
                     }
 
                     item++;
                 }
             }
+            //sprintf(tmp, "Counted %i config items in total", countConfigItems);
+            //Serial.println(tmp);
+
+            unsigned long start = micros();
+            if (loadConfigFromSnapshot())
+            {
+                Serial.printf_P(PSTR("Config loaded from snapshot in %lu us\r\n"), micros() - start);
+                return; // JSON is neither parsed nor dumped
+            }
+
+            bool fileHasChanged = loadConfigFromJsonFile();
 
             if (fileHasChanged)
             {
-                saveConfigToFlash();
+                saveConfigToFlash(); // writes the snapshot as well
+            }
+            else
+            {
+                saveSnapshotToFlash();
+            }
+            Serial.printf_P(PSTR("Config loaded from JSON in %lu us\r\n"), micros() - start);
+
+            Log::refreshParametersFromConfig(false); // configured levels, Log::setup() comes later
+            if (Log::enabled(Log::Module_Config, Log::Level_Debug))
+                printFile(); // blocks until the whole file went through Serial
+        }
+
+        /**
+         * Builds the JSON view of all items, doc must be at least CONFIG_JSON_DOCUMENT_SIZE
+         * @return false if doc is too small
+         * */
+        bool buildJsonDocument(JsonDocument &doc)
+        {
+            for (unsigned int i = 0; i < configItemListsSize; i++)
+            {
+                ConfigItem *item = configItemLists[i];
+
+                while (!item->typeIsEOF())
+                {
+                    JsonObject sectionObject = doc[jsonSections[item->section]];
+                    if (sectionObject.isNull())
+                        sectionObject = doc.createNestedObject(jsonSections[item->section]);
+
+                    item->saveToJsonObject(sectionObject);
+                    item++;
+                }
             }
 
-            printFile();
+            return !doc.overflowed();
         }
 
         class CallbackManager
@@ -488,72 +749,74 @@ namespace RFLink
             return true;
         }
 
-        JsonVariant ConfigItem::createInJsonObject(JsonObject &obj)
+        bool ConfigItem::loadFromJsonObject(JsonObject &obj)
         {
+            JsonVariant value = obj[this->json_name]; // null if the section itself is missing
+
             if (this->typeIsChar())
             {
-                obj[this->json_name] = this->getCharDefaultValue();
-                this->jsonRef = obj[this->json_name];
-                return this->jsonRef;
+                if (value.is<char *>())
+                {
+                    this->setCharValue(value.as<const char *>());
+                    return false;
+                }
             }
             else if (this->typeIsLongInt())
             {
-                obj[this->json_name] = this->getLongIntDefaultValue();
-                this->jsonRef = obj[this->json_name];
-                return this->jsonRef;
+                if (value.is<signed long>())
+                {
+                    this->longIntValue = value.as<signed long>();
+                    return false;
+                }
             }
             else if (this->typeIsBool())
             {
-                obj[this->json_name] = this->getBoolDefaultValue();
-                this->jsonRef = obj[this->json_name];
-                return this->jsonRef;
+                if (value.is<bool>())
+                {
+                    this->boolValue = value.as<bool>();
+                    return false;
+                }
             }
-            return JsonVariant();
+
+            this->resetToDefault();
+            return true;
         }
 
-        bool ConfigItem::checkOrCreateValueInJsonObject(JsonObject &obj)
+        void ConfigItem::saveToJsonObject(JsonObject &obj)
         {
-
-            bool result = false;
-
-            JsonVariant value = obj[this->json_name];
-
-            if (value.isUndefined())
-            {
-                createInJsonObject(obj);
-                return true;
-            }
-
-            this->jsonRef = value;
-
+            // strings are stored as pointers: the document must not outlive the items
             if (this->typeIsChar())
-            {
-                if (!value.is<char *>())
-                {
-                    value.set((char *)this->getCharDefaultValue());
-                    return true;
-                }
-            }
+                obj[this->json_name] = this->getCharValue();
+            else if (this->typeIsLongInt())
+                obj[this->json_name] = this->longIntValue;
+            else if (this->typeIsBool())
+                obj[this->json_name] = this->boolValue;
+        }
 
-            if (this->typeIsLongInt())
+        void ConfigItem::resetToDefault()
+        {
+            if (this->charValue != nullptr)
             {
-                if (!value.is<signed long>())
-                {
-                    value.set(this->getLongIntDefaultValue());
-                    return true;
-                }
+                free(this->charValue);
+                this->charValue = nullptr;
             }
+            this->longIntValue = this->typeIsLongInt() ? this->getLongIntDefaultValue() : 0;
+            this->boolValue = this->boolDefaultValue;
+        }
+
+        void ConfigItem::setCharValue(const char *newValue)
+        {
+            if (this->charValue != nullptr && strcmp(this->charValue, newValue) == 0)
+                return;
 
-            if (this->typeIsBool())
+            char *copy = strdup(newValue);
+            if (copy == nullptr)
             {
-                if (!value.is<bool>())
-                {
-                    value.set(this->getBoolDefaultValue());
-                    return true;
-                }
+                Serial.printf_P(PSTR("Config: no memory left to store '%s'\r\n"), this->json_name);
+                return;
             }
-
-            return result;
+            free(this->charValue);
+            this->charValue = copy;
         }
 
         ConfigItem::ConfigItem(const char *name,
@@ -569,6 +832,10 @@ namespace RFLink
 
             static_assert(sizeof(this->defaultValue) <= sizeof(char *), "variable size is too small");
             this->defaultValue = (void *)default_value;
+            this->boolDefaultValue = false;
+            this->longIntValue = 0;
+            this->boolValue = false;
+            this->charValue = nullptr;
         }
 
         ConfigItem::ConfigItem(const char *name,
@@ -583,6 +850,10 @@ namespace RFLink
 
             static_assert(sizeof(this->defaultValue) <= sizeof(long int), "variable size is too small");
             this->defaultValue = (void *)default_value;
+            this->boolDefaultValue = false;
+            this->longIntValue = default_value;
+            this->boolValue = false;
+            this->charValue = nullptr;
         }
 
         ConfigItem::ConfigItem(const char *name,
@@ -595,7 +866,11 @@ namespace RFLink
             this->type = ConfigItemType::BOOLEAN_t;
             this->update_callback = update_callback;
 
+            this->defaultValue = nullptr;
             this->boolDefaultValue = default_value;
+            this->longIntValue = 0;
+            this->boolValue = default_value;
+            this->charValue = nullptr;
         }
 
         ConfigItem::ConfigItem()
@@ -604,16 +879,24 @@ namespace RFLink
             this->section = SectionId::EOF_id;
             this->type = ConfigItemType::EOF_t;
             this->update_callback = nullptr;
+            this->defaultValue = nullptr;
+            this->boolDefaultValue = false;
+            this->longIntValue = 0;
+            this->boolValue = false;
+            this->charValue = nullptr;
         }
 
         void dumpConfigToString(String &destination)
         {
-            //serializeJson(doc, destination);
+            DynamicJsonDocument doc(CONFIG_JSON_DOCUMENT_SIZE);
+            buildJsonDocument(doc);
             serializeJsonPretty(doc, destination);
         }
 
         void dumpConfigToSerial()
         {
+            DynamicJsonDocument doc(CONFIG_JSON_DOCUMENT_SIZE);
+            buildJsonDocument(doc);
             serializeJson(doc, Serial);
             Serial.println();
         }
@@ -646,7 +929,12 @@ namespace RFLink
             File file = LittleFS.open(F("/tmp.json"), "w");
 #endif
 
-            auto bytes_written = serializeJson(doc, file);
+            DynamicJsonDocument doc(CONFIG_JSON_DOCUMENT_SIZE);
+            size_t bytes_written = 0;
+            if (buildJsonDocument(doc))
+                bytes_written = serializeJson(doc, file);
+            else
+                Serial.print(F("CONFIG_JSON_DOCUMENT_SIZE is too small, "));
             file.close();
 
             if (bytes_written == 0)
@@ -667,6 +955,7 @@ namespace RFLink
                 LittleFS.rename(F("/tmp.json"), configFileName);
 #endif
                 Serial.println(F("OK"));
+                saveSnapshotToFlash();
             }
 
             Signal::AsyncSignalScanner::startScanning();
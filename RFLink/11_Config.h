@@ -4,6 +4,12 @@
 #include "RFLink.h"
 #include <ArduinoJson.h>
 
+#ifndef CONFIG_JSON_DOCUMENT_SIZE
+#define CONFIG_JSON_DOCUMENT_SIZE 4096 // only allocated while the file is loaded or saved, or the API is served
+#endif
+
+#define CONFIG_SNAPSHOT_VERSION 2 // bump whenever the layout of /config.bin changes
+
 namespace RFLink
 {
     namespace Config
@@ -29,14 +35,26 @@ namespace RFLink
             Signal_id,
             Radio_id,
             Serial2Net_id,
+            Multicast_id,
+            Devices_id,
+            Filter_id,
+            Log_id,
+            Serial_id,
             EOF_id // must always be the last!
         };
 
+        /**
+         * Values live in the item itself, in their native type: modules read them directly through the handle
+         * &configItems[ConfigItem_xxx] (their own index enum) and JSON is only used to load, save and serve the API.
+         * */
         class ConfigItem
         {
 
         private:
             bool boolDefaultValue;
+            long int longIntValue;
+            bool boolValue;
+            char *charValue; // owned copy, nullptr until a value is set
 
         public:
             ConfigItemType type;
@@ -44,7 +62,6 @@ namespace RFLink
             SectionId section;
             void (*update_callback)();
             void *defaultValue;
-            JsonVariant jsonRef;
 
             ConfigItem(const char *name, SectionId section, const char *default_value, void (*update_callback)());
             ConfigItem(const char *name, SectionId section, long int default_value, void (*update_callback)());
@@ -52,8 +69,12 @@ namespace RFLink
             ConfigItem(const char *name, SectionId section, bool default_value, void (*update_callback)());
             ConfigItem();
 
-            JsonVariant createInJsonObject(JsonObject &object);
-            bool checkOrCreateValueInJsonObject(JsonObject &object);
+            /**
+             * @return true if the value was missing or had the wrong type and the default is used instead
+             * */
+            bool loadFromJsonObject(JsonObject &object);
+            void saveToJsonObject(JsonObject &object);
+            void resetToDefault();
 
             inline bool typeIsChar() { return this->type == ConfigItemType::STRING_t; }
             inline bool typeIsLongInt() { return this->type == ConfigItemType::LONG_INT_t; }
@@ -77,38 +98,38 @@ namespace RFLink
 
             inline const char *getCharValue()
             {
-                return (const char *)this->jsonRef.as<const char *>();
+                return this->charValue != nullptr ? this->charValue : this->getCharDefaultValue();
             }
 
             /**
-                 * does not make a copy of the char!!
-                 */
-            inline void setCharValue(const char *newValue)
-            {
-                this->jsonRef.set((char *)newValue);
-            }
+             * makes a copy, newValue can be discarded afterwards
+             */
+            void setCharValue(const char *newValue);
 
             inline long int getLongIntValue()
             {
-                return (long int)this->jsonRef.as<signed long>();
+                return this->longIntValue;
             }
 
             inline void setLongIntValue(long int newValue)
             {
-                this->jsonRef.set(newValue);
+                this->longIntValue = newValue;
             }
 
             inline bool getBoolValue()
             {
-                return this->jsonRef.as<bool>();
+                return this->boolValue;
             }
 
             inline void setBoolValue(bool newValue)
             {
-                this->jsonRef.set(newValue);
+                this->boolValue = newValue;
             }
         };
 
+        /**
+         * Lookup by name, for JSON and the API. Modules use their own handles instead.
+         * */
         ConfigItem *findConfigItem(const char *name, SectionId section);
         void dumpConfigToString(String &destination);
         void dumpConfigToSerial();
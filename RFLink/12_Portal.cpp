@@ -1,5 +1,6 @@
 #include <ESPAsyncWebServer.h>
 #include <AsyncJson.h>
+#include <memory>
 #include "index.html.gz.h"
 
 #include "RFLink.h"
@@ -8,7 +9,20 @@
 #include "9_Serial2Net.h"
 #include "11_Config.h"
 #include "10_Wifi.h"
+#include "12_Portal.h"
 #include "13_OTA.h"
+#include "14_Transmit.h"
+#include "16_Batch.h"
+#include "17_Output.h"
+#include "18_Multicast.h"
+#include "20_Devices.h"
+#include "21_Filter.h"
+#include "22_Metrics.h"
+#include "23_Profiler.h"
+#include "24_Scheduler.h"
+#include "25_Log.h"
+#include "26_SerialTx.h"
+#include "27_Command.h"
 
 #if defined(ESP8266)
 #include "ESP8266WiFi.h"
@@ -26,16 +40,148 @@ namespace RFLink { namespace Portal {
         const char json_name_auth_enabled[] = "auth_enabled";
         const char json_name_auth_user[] = "auth_user";
         const char json_name_auth_password[] = "auth_password";
+        const char json_name_ws_enabled[] = "ws_enabled";
+        const char json_name_ws_raw_enabled[] = "ws_raw_enabled";
+
+        enum ConfigItemIndex {
+            ConfigItem_Enabled,
+            ConfigItem_AuthEnabled,
+            ConfigItem_AuthUser,
+            ConfigItem_AuthPassword,
+            ConfigItem_WsEnabled,
+            ConfigItem_WsRawEnabled,
+            ConfigItem_EOF,
+        };
 
         Config::ConfigItem configItems[] =  {
                 Config::ConfigItem(json_name_enabled,      Config::SectionId::Portal_id, true, nullptr),
                 Config::ConfigItem(json_name_auth_enabled, Config::SectionId::Portal_id, false, nullptr),
                 Config::ConfigItem(json_name_auth_user,    Config::SectionId::Portal_id, "", nullptr),
                 Config::ConfigItem(json_name_auth_password,Config::SectionId::Portal_id, "", nullptr),
+                Config::ConfigItem(json_name_ws_enabled,   Config::SectionId::Portal_id, true, paramsUpdatedCallback),
+                Config::ConfigItem(json_name_ws_raw_enabled,Config::SectionId::Portal_id, false, paramsUpdatedCallback),
                 Config::ConfigItem(), // dont remove it!
         };
+        static_assert(sizeof(configItems) / sizeof(Config::ConfigItem) == ConfigItem_EOF + 1, "configItems has missing/extra items, please compare with ConfigItemIndex enum declarations");
 
         AsyncWebServer server(80);
+        AsyncWebSocket ws("/ws");
+
+        namespace params {
+            bool wsEnabled = true;
+        }
+
+        namespace counters {
+            unsigned long int wsFrames = 0;
+            unsigned long int wsMessages = 0;
+            unsigned long int wsDroppedFrames = 0;   // client was too slow to take the frame
+            unsigned long int wsTruncatedFrames = 0; // message did not fit in an empty frame
+            unsigned long int wsCommands = 0;
+            unsigned long int wsRejectedCommands = 0;
+        }
+
+        // written by web server task on connect/disconnect, read by main loop
+        volatile uint32_t wsClientIds[PORTAL_WS_MAX_CLIENTS]; // 0 means slot is free
+        volatile uint8_t wsClientsCount = 0;
+        unsigned long wsClientDrops[PORTAL_WS_MAX_CLIENTS];
+
+        char wsFrame[PORTAL_WS_FRAME_SIZE];
+        size_t wsFrameLength = 0;
+
+        char wsCommand[RETRIEVE_BUFFER_SIZE];
+        const Command::Context wsCommandContext = {Command::Source_WebSocket, "websocket", nullptr, nullptr};
+        volatile bool wsCommandPending = false;
+        unsigned long wsLastCleanup = 0;
+
+        void flushWsFrame() {
+          if (wsFrameLength == 0)
+            return;
+          wsFrame[wsFrameLength] = 0;
+
+          for (uint8_t i = 0; i < PORTAL_WS_MAX_CLIENTS; i++) {
+            uint32_t id = wsClientIds[i];
+            if (id == 0)
+              continue;
+            // never wait for a browser, a slow one just misses this frame
+            if (!ws.availableForWrite(id)) {
+              wsClientDrops[i]++;
+              counters::wsDroppedFrames++;
+              continue;
+            }
+            ws.text(id, wsFrame);
+          }
+
+          counters::wsFrames++;
+          wsFrameLength = 0;
+        }
+
+        bool wsSinkIsEnabled() {
+          return params::wsEnabled && wsClientsCount > 0;
+        }
+
+        bool wsSinkWrite(const char *msg, size_t length) {
+          if (wsFrameLength + length > sizeof(wsFrame) - 1)
+            flushWsFrame();
+
+          if (length > sizeof(wsFrame) - 1) {
+            length = sizeof(wsFrame) - 1;
+            counters::wsTruncatedFrames++;
+          }
+
+          memcpy(wsFrame + wsFrameLength, msg, length);
+          wsFrameLength += length;
+          counters::wsMessages++;
+          return true;
+        }
+
+        // frames are built in RAM so sink is always ready, flushing happens from mainLoop()
+        Output::Sink wsSink("websocket", Output::Format_Line, Output::Drop_Oldest, PORTAL_WS_QUEUE_SIZE,
+                            wsSinkIsEnabled, nullptr, wsSinkWrite);
+
+        void setWsClient(uint32_t oldId, uint32_t newId) {
+          for (uint8_t i = 0; i < PORTAL_WS_MAX_CLIENTS; i++) {
+            if (wsClientIds[i] == oldId) {
+              wsClientDrops[i] = 0;
+              wsClientIds[i] = newId;
+              wsClientsCount += newId != 0 ? 1 : -1;
+              return;
+            }
+          }
+        }
+
+        void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len) {
+          if (type == WS_EVT_CONNECT) {
+            if (!params::wsEnabled || wsClientsCount >= PORTAL_WS_MAX_CLIENTS) {
+              client->close(1013, "Too many clients");
+              return;
+            }
+            setWsClient(0, client->id());
+          } else if (type == WS_EVT_DISCONNECT) {
+            setWsClient(client->id(), 0);
+          } else if (type == WS_EVT_DATA) {
+            AwsFrameInfo *info = (AwsFrameInfo *) arg;
+
+            // commands are short, we only take them in a single text frame
+            if (!info->final || info->index != 0 || info->len != len || info->opcode != WS_TEXT)
+              return;
+
+            if (len < 3 || strncmp((const char *) data, "10;", 3) != 0)
+              return;
+
+            if (wsCommandPending || len > sizeof(wsCommand) - 1) {
+              counters::wsRejectedCommands++;
+              client->text(F("20;XX;BUSY;\r\n"));
+              return;
+            }
+
+            memcpy(wsCommand, data, len);
+            wsCommand[len] = 0;
+            // strip end of line, RFLink commands end with ';'
+            while (len > 0 && (wsCommand[len - 1] == '\r' || wsCommand[len - 1] == '\n'))
+              wsCommand[--len] = 0;
+            wsCommandPending = true;
+          }
+        }
 
         void notFound(AsyncWebServerRequest *request) {
           request->send(404, F("text/plain"), F("Not found"));
@@ -47,22 +193,132 @@ namespace RFLink { namespace Portal {
           request->send(200, F("application/json"), dump);
         }
 
-        void serveApiStatusGet(AsyncWebServerRequest *request) {
-          DynamicJsonDocument output(10000);
+        /**
+         * Body of a chunked response produced one part at a time, so all of it never sits in memory.
+         * nextPart prints a part and returns false once it printed the last one
+         * */
+        class PartsFiller : public Print {
+        public:
+          explicit PartsFiller(std::function<bool(Print &)> nextPart) : nextPart(nextPart), offset(0), done(false) {}
+
+          size_t write(uint8_t c) override {
+            pending += (char) c;
+            return 1;
+          }
+
+          size_t fill(uint8_t *buffer, size_t maxLength) {
+            while (offset >= pending.length() && !done) {
+              pending = "";
+              offset = 0;
+              done = !nextPart(*this);
+            }
+            size_t length = pending.length() - offset;
+            if (length > maxLength)
+              length = maxLength;
+            memcpy(buffer, pending.c_str() + offset, length);
+            offset += length;
+            return length; // 0 ends the response
+          }
+
+        private:
+          std::function<bool(Print &)> nextPart;
+          String pending;
+          size_t offset;
+          bool done;
+        };
+
+        void sendParts(AsyncWebServerRequest *request, const __FlashStringHelper *contentType, std::function<bool(Print &)> nextPart) {
+          std::shared_ptr<PartsFiller> filler = std::make_shared<PartsFiller>(nextPart); // lives as long as the response
+          request->send(request->beginChunkedResponse(String(contentType), [filler](uint8_t *buffer, size_t maxLength, size_t index) -> size_t {
+            return filler->fill(buffer, maxLength);
+          }));
+        }
+
+        typedef void (*StatusSection)(JsonObject &output);
+
+        const StatusSection statusSections[] = {
+                RFLink::getStatusJsonString,
+                RFLink::Wifi::getStatusJsonString,
+                RFLink::Mqtt::getStatusJsonString,
+                RFLink::Signal::getStatusJsonString,
+                RFLink::Transmit::getStatusJsonString,
+                RFLink::Batch::getStatusJsonString,
+                RFLink::Serial2Net::getStatusJsonString,
+                RFLink::Multicast::getStatusJsonString,
+                RFLink::Devices::getStatusJsonString,
+                RFLink::Filter::getStatusJsonString,
+                RFLink::Profiler::getStatusJsonString,
+                RFLink::Scheduler::getStatusJsonString,
+                RFLink::Log::getStatusJsonString,
+                RFLink::SerialTx::getStatusJsonString,
+                RFLink::Command::getStatusJsonString,
+                RFLink::Output::getStatusJsonString,
+                RFLink::Portal::getStatusJsonString,
+        };
+        const uint8_t statusSectionsCount = sizeof(statusSections) / sizeof(statusSections[0]);
+
+        /**
+         * Members of a module, without the braces of its own document
+         * @param first false if a comma must separate them from previous ones
+         * @return false if the module has nothing to say
+         * */
+        bool printStatusSection(Print &output, uint8_t index, bool first) {
+          DynamicJsonDocument document(PORTAL_STATUS_SECTION_SIZE);
+          auto && obj = document.to<JsonObject>();
+          statusSections[index](obj);
+
+          if (document.overflowed())
+            Log::printf(Log::Module_Portal, Log::Level_Warning, PSTR("Status: section %u is truncated, PORTAL_STATUS_SECTION_SIZE is too small"), index);
+          if (obj.size() == 0)
+            return false;
+
+          String members;
+          serializeJson(obj, members);
+          if (!first)
+            output.print(',');
+          output.write((const uint8_t *) members.c_str() + 1, members.length() - 2);
+          return true;
+        }
 
-          auto && obj = output.to<JsonObject>();
+        void serveApiStatusGet(AsyncWebServerRequest *request) {
+          uint8_t next = 0;
+          bool first = true;
+
+          // one module per part, the whole document would not fit in ESP8266 heap
+          sendParts(request, F("application/json"), [next, first](Print &output) mutable {
+            if (next == 0)
+              output.print('{');
+            if (next < statusSectionsCount) {
+              if (printStatusSection(output, next++, first))
+                first = false;
+              return true;
+            }
+            output.print('}');
+            return false;
+          });
+        }
 
-          RFLink::getStatusJsonString(obj);
+        void serveApiDevicesGet(AsyncWebServerRequest *request) {
+          AsyncResponseStream *response = request->beginResponseStream(F("application/json"));
+          RFLink::Devices::printDevicesJson(*response);
+          request->send(response);
+        }
 
-          RFLink::Wifi::getStatusJsonString(obj);
-          RFLink::Mqtt::getStatusJsonString(obj);
-          RFLink::Signal::getStatusJsonString(obj);
-          RFLink::Serial2Net::getStatusJsonString(obj);
+        void serveApiLogGet(AsyncWebServerRequest *request) {
+          unsigned long since = 0;
+          if (request->hasParam(F("since")))
+            since = strtoul(request->getParam(F("since"))->value().c_str(), nullptr, 10);
 
-          String buffer;
-          serializeJson(output, buffer);
+          AsyncResponseStream *response = request->beginResponseStream(F("application/json"));
+          RFLink::Log::printLogJson(*response, since);
+          request->send(response);
+        }
 
-          request->send(200, "application/json", buffer);
+        void serveMetricsGet(AsyncWebServerRequest *request) {
+          RFLink::Metrics::PartPrinter printer;
+          sendParts(request, F("text/plain; version=0.0.4"), [printer](Print &output) mutable {
+            return printer.printNext(output);
+          });
         }
 
         void serveApiReboot(AsyncWebServerRequest *request) {
@@ -102,9 +358,31 @@ namespace RFLink { namespace Portal {
 
         }
 
+        void serveApiSendPost(AsyncWebServerRequest *request, JsonVariant &json) {
+          if (not json.is<JsonObject>()) {
+            request->send(400, F("text/plain"), F("Not an object"));
+            return;
+          }
+
+          JsonVariant commands = json["commands"];
+
+          if(!commands.is<JsonArray>()) {
+            request->send(400, F("text/plain"), F("malformed request data"));
+            return;
+          }
+
+          if(!RFLink::Batch::scheduleFromJson(commands.as<JsonArray>())) {
+            request->send(503, F("text/plain"), F("Busy or batch too large, try again later"));
+            return;
+          }
+
+          // results are reported as 20;XX;BATCH;... messages on Serial/MQTT/Serial2Net
+          request->send(202, F("application/json"), F("{ \"success\": true }"));
+        }
+
         void serverApiConfigPush(AsyncWebServerRequest *request, JsonVariant &json) {
           if (not json.is<JsonObject>()) {
-            Serial.println(F("API Config push requested but invalid JSON was received!"));
+            Log::printf(Log::Module_Portal, Log::Level_Warning, PSTR("API Config push requested but invalid JSON was received!"));
             request->send(400, F("text/plain"), F("Not an object"));
             return;
           }
@@ -154,7 +432,7 @@ namespace RFLink { namespace Portal {
           //Upload handler chunks in data
 
           if (!index) {
-            Serial.println(F("OTA via Portal Requested"));
+            Log::printf(Log::Module_Ota, Log::Level_Info, PSTR("OTA via Portal Requested"));
 
             //if(!request->hasParam("MD5", true)) {
             //    return request->send(400, "text/plain", "MD5 parameter missing");
@@ -174,7 +452,7 @@ namespace RFLink { namespace Portal {
               int cmd = (filename == "filesystem") ? U_SPIFFS : U_FLASH;
         if (!Update.begin(UPDATE_SIZE_UNKNOWN, cmd)) { // Start with max available size
 #endif
-              Update.printError(Serial);
+              Log::printf(Log::Module_Ota, Log::Level_Error, PSTR("OTA via Portal could not begin, error %u"), Update.getError());
               return request->send(400, F("text/plain"), F("OTA could not begin"));
             }
           }
@@ -188,10 +466,10 @@ namespace RFLink { namespace Portal {
 
           if (final) { // if the final flag is set then this is the last frame of data
             if (!Update.end(true)) { //true to set the size to the current progress
-              Update.printError(Serial);
+              Log::printf(Log::Module_Ota, Log::Level_Error, PSTR("OTA via Portal could not end, error %u"), Update.getError());
               return request->send(400, F("text/plain"), F("Could not end OTA"));
             }
-            Serial.println(F("OTA via Portal is a success. You are one reboot away your new shiny release! See you in 5 seconds..."));
+            Log::printf(Log::Module_Ota, Log::Level_Info, PSTR("OTA via Portal is a success. You are one reboot away your new shiny release! See you in 5 seconds..."));
             RFLink::scheduleReboot(5);
           }else{
 
@@ -221,6 +499,9 @@ namespace RFLink { namespace Portal {
 
           server.on(PSTR("/api/config"), HTTP_GET, serverApiConfigGet);
           server.on(PSTR("/api/status"), HTTP_GET, serveApiStatusGet);
+          server.on(PSTR("/api/devices"), HTTP_GET, serveApiDevicesGet);
+          server.on(PSTR("/api/log"), HTTP_GET, serveApiLogGet);
+          server.on(PSTR("/metrics"), HTTP_GET, serveMetricsGet);
 
           server.on(PSTR("/api/reboot"), HTTP_GET, serveApiReboot);
 
@@ -232,12 +513,66 @@ namespace RFLink { namespace Portal {
           handler = new AsyncCallbackJsonWebHandler(PSTR("/api/firmware/update_from_url"), serveApiFirmwareUpdateFromUrl, 1000);
           server.addHandler(handler);
 
+          handler = new AsyncCallbackJsonWebHandler(PSTR("/api/send"), serveApiSendPost, BATCH_HTTP_BUFFER_SIZE * 2);
+          server.addHandler(handler);
+
+          refreshParametersFromConfig(false);
+          ws.onEvent(onWsEvent);
+          server.addHandler(&ws);
+          Output::registerSink(&wsSink);
         }
 
         void start() {
-          Serial.print(F("Starting WebServer... "));
           server.begin();
-          Serial.println(F("OK"));
+          Log::printf(Log::Module_Portal, Log::Level_Info, PSTR("WebServer started")); // receiver is running already, keep it off the UART
+        }
+
+        void mainLoop() {
+          if (wsCommandPending) {
+            counters::wsCommands++;
+            RFLink::sendRawPrint(PSTR("Message arrived [WebSocket]:"));
+            RFLink::sendRawPrint(wsCommand);
+            RFLink::sendRawPrint(PSTR("\r\n"));
+            RFLink::Command::execute(wsCommand, wsCommandContext);
+            wsCommandPending = false;
+          }
+
+          flushWsFrame(); // everything received during this loop goes in a single frame
+
+          if (millis() - wsLastCleanup > 1000) {
+            wsLastCleanup = millis();
+            ws.cleanupClients(PORTAL_WS_MAX_CLIENTS);
+          }
+        }
+
+        void paramsUpdatedCallback() {
+          refreshParametersFromConfig();
+        }
+
+        void refreshParametersFromConfig(bool triggerChanges) {
+          Config::ConfigItem *item;
+
+          item = &configItems[ConfigItem_WsEnabled];
+          params::wsEnabled = item->getBoolValue();
+
+          item = &configItems[ConfigItem_WsRawEnabled];
+          wsSink.acceptsRaw = item->getBoolValue();
+
+          if (triggerChanges && !params::wsEnabled)
+            ws.closeAll();
+        }
+
+        void getStatusJsonString(JsonObject &output) {
+          auto &&websocket = output.createNestedObject("websocket");
+          websocket[F("enabled")] = params::wsEnabled;
+          websocket[F("raw_enabled")] = wsSink.acceptsRaw;
+          websocket[F("clients")] = wsClientsCount;
+          websocket[F("frames")] = counters::wsFrames;
+          websocket[F("messages")] = counters::wsMessages;
+          websocket[F("dropped_frames")] = counters::wsDroppedFrames;
+          websocket[F("truncated_frames")] = counters::wsTruncatedFrames;
+          websocket[F("commands")] = counters::wsCommands;
+          websocket[F("rejected_commands")] = counters::wsRejectedCommands;
         }
 
 
@@ -4,6 +4,26 @@
 #include "RFLink.h"
 #include "11_Config.h"
 
+#ifndef PORTAL_WS_MAX_CLIENTS
+#define PORTAL_WS_MAX_CLIENTS 4 // browsers connected to /ws at the same time
+#endif
+
+#ifndef PORTAL_WS_FRAME_SIZE
+#if defined(ESP32)
+#define PORTAL_WS_FRAME_SIZE 1024 // messages received during one loop are sent as a single frame
+#else
+#define PORTAL_WS_FRAME_SIZE 512
+#endif
+#endif
+
+#ifndef PORTAL_STATUS_SECTION_SIZE
+#define PORTAL_STATUS_SECTION_SIZE 4096 // JSON document for one module of /api/status, the largest is profiler
+#endif
+
+#ifndef PORTAL_WS_QUEUE_SIZE
+#define PORTAL_WS_QUEUE_SIZE 8 // Output bus queue for the websocket sink
+#endif
+
 namespace RFLink {
     namespace Portal {
 
@@ -13,8 +33,15 @@ namespace RFLink {
          * */
         void init();
         void start();
+        /**
+         * Include in your main loop, it pushes pending events to /ws clients and runs commands they sent
+         * */
+        void mainLoop();
 
         void paramsUpdatedCallback();
+        void refreshParametersFromConfig(bool triggerChanges = true);
+
+        void getStatusJsonString(JsonObject &output);
     }
 }
 
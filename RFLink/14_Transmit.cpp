@@ -0,0 +1,532 @@
+#include <Arduino.h>
+#include "RFLink.h"
+#include "1_Radio.h"
+#include "2_Signal.h"
+#include "14_Transmit.h"
+#include "25_Log.h"
+#include "27_Command.h"
+
+#if defined(ESP32)
+#include <driver/rmt.h>
+#define TX_RMT_MAX_DURATION 32767                 // 15 bits per RMT half-item, in ticks of 1us
+#define TX_RMT_ITEMS_MAX (RAW_BUFFER_SIZE * 2)    // room for a few back-to-back repeats of a full frame
+#elif defined(ESP8266)
+#define TX_TIMER1_TICKS_PER_US 5                  // TIM_DIV16 => 80MHz/16
+#define TX_TIMER1_MIN_TICKS 10
+#define TX_TIMER1_MAX_TICKS 8388607UL             // timer1 is 23 bits wide
+#endif
+
+namespace RFLink {
+    namespace Transmit {
+
+        namespace counters {
+            unsigned long int submittedJobs = 0;
+            unsigned long int completedJobs = 0;
+            unsigned long int rejectedJobs = 0;
+            unsigned long int queueFullRejects = 0;
+            unsigned long int framesSent = 0;
+            unsigned long int maxQueueDepth = 0;
+            unsigned long int lastJobDuration_ms = 0;
+            unsigned long int maxJobDuration_ms = 0;
+            unsigned long int lastQueueLatency_ms = 0;
+            unsigned long int maxQueueLatency_ms = 0;
+            unsigned long long totalAirTime_us = 0;
+            unsigned long int rxWindows = 0;
+            unsigned long int rxWindowsTime_ms = 0;
+            unsigned long int rxWindowsDecodedSignals = 0;
+            unsigned long int rxWindowsUndecoded = 0;
+        }
+
+        struct TxJob {
+            unsigned long id;
+            unsigned long tag;
+            unsigned long submitTime_ms;
+            RawSignalStruct signal;
+        };
+
+        enum EngineState {
+            Engine_Idle,    // nothing in flight, radio is (or goes back) in RX
+            Engine_Playing, // hardware is playing one or more frames
+            Engine_RxGap,   // radio is listening during signal.Delay, until rxWindowEnd_ms
+            Engine_Gap,     // waiting for signal.Delay to elapse before next repeat
+        };
+
+        TxJob queue[TX_QUEUE_SIZE];
+        unsigned int queueHead = 0;   // job currently being transmitted
+        unsigned int queueCount = 0;
+        unsigned long nextJobId = 1;
+        unsigned long submitTag = 0;
+        JobCompletedCallback jobCompletedCallback = nullptr;
+
+        EngineState state = Engine_Idle;
+        unsigned int currentRepeat = 0;
+        unsigned long gapEnd_ms;
+        unsigned long rxWindowStart_ms;
+        unsigned long rxWindowEnd_ms;
+        unsigned long rxWindowDecodedBefore;
+        bool jobFailed;
+        unsigned long jobStart_ms;
+        unsigned long frameDuration_us; // duration of what the hardware is currently playing
+        uint8_t callerDepth = 0;        // > 0 while serviced from submit() or flush(), ie in the middle of a plugin TX call
+
+        /**
+         * Number of pulses actually played out of a RawSignalStruct, pulses go by HIGH/LOW pairs
+         * */
+        inline int pulsesToSend(const RawSignalStruct &signal) {
+            return signal.Number & ~1;
+        }
+
+        inline unsigned long pulseDuration_us(const RawSignalStruct &signal, int index) {
+            unsigned long duration = (unsigned long)signal.Pulses[index] * signal.Multiply;
+            return duration > 0 ? duration : 1;
+        }
+
+        /**
+         * Synchronous playback, used when no hardware timer is available
+         * */
+        unsigned int playFramesBlocking(const RawSignalStruct &signal, unsigned int copies) {
+            for (unsigned int y = 0; y < copies; y++) {
+                int x = 1;
+                noInterrupts();
+                while (x < signal.Number) {
+                    digitalWrite(Radio::pins::TX_DATA, HIGH);
+                    delayMicroseconds(signal.Pulses[x++] * signal.Multiply);
+                    digitalWrite(Radio::pins::TX_DATA, LOW);
+                    delayMicroseconds(signal.Pulses[x++] * signal.Multiply);
+                }
+                interrupts();
+            }
+            return copies;
+        }
+
+#if defined(ESP32)
+
+        rmt_item32_t rmtItems[TX_RMT_ITEMS_MAX];
+        bool rmtInstalled = false;
+
+        void hwSetup() {
+            if (Radio::pins::TX_DATA == (uint8_t)NOT_A_PIN)
+                return;
+
+            rmt_config_t config;
+            memset(&config, 0, sizeof(config));
+            config.rmt_mode = RMT_MODE_TX;
+            config.channel = TX_RMT_CHANNEL;
+            config.gpio_num = (gpio_num_t)Radio::pins::TX_DATA;
+            config.mem_block_num = 1;
+            config.clk_div = 80; // 1 tick = 1us
+            config.tx_config.loop_en = false;
+            config.tx_config.carrier_en = false;
+            config.tx_config.idle_output_en = true;
+            config.tx_config.idle_level = RMT_IDLE_LEVEL_LOW;
+
+            if (rmt_config(&config) != ESP_OK || rmt_driver_install(TX_RMT_CHANNEL, 0, 0) != ESP_OK) {
+                Log::printf(Log::Module_Radio, Log::Level_Error, PSTR("Transmit: failed to initialize RMT, falling back to blocking transmission"));
+                return;
+            }
+            rmtInstalled = true;
+        }
+
+        /**
+         * Radio::set_Radio_mode() changes TX_DATA with pinMode() which detaches it from RMT
+         * */
+        void hwAttachPin() {
+            if (rmtInstalled)
+                rmt_set_pin(TX_RMT_CHANNEL, RMT_MODE_TX, (gpio_num_t)Radio::pins::TX_DATA);
+        }
+
+        /**
+         * @return number of rmt items needed or 0 if it doesn't fit
+         * */
+        size_t renderFrame(const RawSignalStruct &signal, size_t offset) {
+            size_t index = offset;
+            bool secondHalf = false;
+            int count = pulsesToSend(signal);
+
+            for (int x = 1; x <= count; x++) {
+                bool level = (x & 1) != 0; // odd pulses are marks
+                unsigned long duration = pulseDuration_us(signal, x);
+
+                while (duration > 0) {
+                    uint32_t chunk = duration > TX_RMT_MAX_DURATION ? TX_RMT_MAX_DURATION : duration;
+                    duration -= chunk;
+
+                    if (index >= TX_RMT_ITEMS_MAX - 1)
+                        return 0;
+
+                    if (!secondHalf) {
+                        rmtItems[index].level0 = level;
+                        rmtItems[index].duration0 = chunk;
+                    } else {
+                        rmtItems[index].level1 = level;
+                        rmtItems[index].duration1 = chunk;
+                        index++;
+                    }
+                    secondHalf = !secondHalf;
+                }
+            }
+
+            if (secondHalf) { // pad to a full item with a tiny LOW, we're already LOW
+                rmtItems[index].level1 = 0;
+                rmtItems[index].duration1 = 1;
+                index++;
+            }
+
+            return index - offset;
+        }
+
+        unsigned int hwStartFrames(const RawSignalStruct &signal, unsigned int copies) {
+            if (!rmtInstalled)
+                return playFramesBlocking(signal, copies);
+
+            size_t itemsCount = 0;
+            unsigned int renderedCopies = 0;
+
+            while (renderedCopies < copies) {
+                size_t frameItems = renderFrame(signal, itemsCount);
+                if (frameItems == 0)
+                    break;
+                itemsCount += frameItems;
+                renderedCopies++;
+            }
+
+            if (renderedCopies == 0)
+                return 0;
+
+            rmtItems[itemsCount].val = 0; // end marker
+            itemsCount++;
+
+            if (rmt_write_items(TX_RMT_CHANNEL, rmtItems, itemsCount, false) != ESP_OK)
+                return 0;
+
+            return renderedCopies;
+        }
+
+        bool hwFramesDone() {
+            return !rmtInstalled || rmt_wait_tx_done(TX_RMT_CHANNEL, 0) == ESP_OK;
+        }
+
+#elif defined(ESP8266)
+
+        uint32_t timerTicks[RAW_BUFFER_SIZE + 1];
+        uint16_t timerTicksCount;
+        volatile uint16_t timerIndex;
+        volatile uint16_t timerCopiesLeft;
+        volatile bool timerDone = true;
+        uint8_t timerPin;
+
+        void hwSetup() {}
+
+        void hwAttachPin() {}
+
+        void IRAM_ATTR onTimer1() {
+            if (timerIndex >= timerTicksCount) {
+                if (--timerCopiesLeft == 0) {
+                    digitalWrite(timerPin, LOW);
+                    timer1_disable();
+                    timerDone = true;
+                    return;
+                }
+                timerIndex = 0;
+            }
+            digitalWrite(timerPin, (timerIndex & 1) ? LOW : HIGH); // even index => odd pulse => mark
+            timer1_write(timerTicks[timerIndex++]);
+        }
+
+        unsigned int hwStartFrames(const RawSignalStruct &signal, unsigned int copies) {
+            int count = pulsesToSend(signal);
+
+            for (int x = 1; x <= count; x++) {
+                unsigned long ticks = pulseDuration_us(signal, x) * TX_TIMER1_TICKS_PER_US;
+                if (ticks < TX_TIMER1_MIN_TICKS)
+                    ticks = TX_TIMER1_MIN_TICKS;
+                else if (ticks > TX_TIMER1_MAX_TICKS)
+                    ticks = TX_TIMER1_MAX_TICKS;
+                timerTicks[x - 1] = ticks;
+            }
+
+            timerPin = Radio::pins::TX_DATA;
+            timerTicksCount = count;
+            timerIndex = 0;
+            timerCopiesLeft = copies;
+            timerDone = false;
+
+            timer1_attachInterrupt(onTimer1);
+            timer1_enable(TIM_DIV16, TIM_EDGE, TIM_SINGLE);
+            onTimer1(); // first edge now, the rest is driven by the timer
+
+            return copies;
+        }
+
+        bool hwFramesDone() {
+            return timerDone;
+        }
+
+#else
+
+        void hwSetup() {}
+
+        void hwAttachPin() {}
+
+        unsigned int hwStartFrames(const RawSignalStruct &signal, unsigned int copies) {
+            return playFramesBlocking(signal, copies);
+        }
+
+        bool hwFramesDone() {
+            return true;
+        }
+
+#endif
+
+        unsigned long frameAirTime_us(const RawSignalStruct &signal) {
+            unsigned long total = 0;
+            int count = pulsesToSend(signal);
+            for (int x = 1; x <= count; x++)
+                total += pulseDuration_us(signal, x);
+            return total;
+        }
+
+        void finishJob();
+
+        void takeRadio() {
+            if (Radio::current_State != Radio::States::Radio_TX) {
+                Radio::set_Radio_mode(Radio::States::Radio_TX);
+                hwAttachPin();
+            }
+        }
+
+        void startFrames() {
+            const RawSignalStruct &signal = queue[queueHead].signal;
+
+            takeRadio();
+
+            // without a delay between repeats, we let the hardware chain as many as it can
+            unsigned int copies = signal.Delay == 0 ? signal.Repeats - currentRepeat : 1;
+
+            unsigned int started = hwStartFrames(signal, copies);
+
+            if (started == 0) {
+                Log::printf(Log::Module_Radio, Log::Level_Error, PSTR("Transmit: failed to start RF frame, job aborted"));
+                counters::rejectedJobs++;
+                currentRepeat = signal.Repeats;
+                jobFailed = true;
+                finishJob();
+                return;
+            }
+
+            currentRepeat += started;
+            counters::framesSent += started;
+            frameDuration_us = frameAirTime_us(signal) * started;
+            counters::totalAirTime_us += frameDuration_us;
+            state = Engine_Playing;
+        }
+
+        void startJob() {
+            TxJob &job = queue[queueHead];
+
+            jobStart_ms = millis();
+            counters::lastQueueLatency_ms = jobStart_ms - job.submitTime_ms;
+            if (counters::lastQueueLatency_ms > counters::maxQueueLatency_ms)
+                counters::maxQueueLatency_ms = counters::lastQueueLatency_ms;
+
+            currentRepeat = 0;
+            jobFailed = false;
+
+            if (job.signal.Repeats == 0) {
+                finishJob();
+                return;
+            }
+
+            startFrames();
+        }
+
+        void finishJob() {
+            counters::lastJobDuration_ms = millis() - jobStart_ms;
+            if (counters::lastJobDuration_ms > counters::maxJobDuration_ms)
+                counters::maxJobDuration_ms = counters::lastJobDuration_ms;
+            counters::completedJobs++;
+
+            const TxJob &job = queue[queueHead];
+            if (job.tag != 0 && jobCompletedCallback != nullptr)
+                jobCompletedCallback(job.id, job.tag, !jobFailed);
+
+            queueHead = (queueHead + 1) % TX_QUEUE_SIZE;
+            queueCount--;
+            state = Engine_Idle;
+
+            if (queueCount > 0)
+                startJob(); // radio stays in TX for the next one
+            else if (Radio::current_State == Radio::States::Radio_TX)
+                Radio::set_Radio_mode(Radio::States::Radio_RX);
+        }
+
+        /**
+         * Gives the radio back to the receiver if the gap before next repeat is worth it
+         * */
+        void startGap() {
+            unsigned long now = millis();
+            unsigned long delay_ms = queue[queueHead].signal.Delay;
+            unsigned long turnaround_us = Radio::getTurnaroundTime_us();
+
+            gapEnd_ms = now + delay_ms;
+
+            // decoding would overwrite pbuffer while our caller may still be building its answer
+            if (callerDepth > 0 || delay_ms * 1000 < 2 * turnaround_us + TX_RX_MIN_WINDOW_MS * 1000UL) {
+                state = Engine_Gap;
+                return;
+            }
+
+            rxWindowStart_ms = now;
+            rxWindowEnd_ms = gapEnd_ms - (turnaround_us + 999) / 1000;
+            rxWindowDecodedBefore = Signal::counters::successfullyDecodedSignalsCount;
+            counters::rxWindows++;
+
+            Radio::set_Radio_mode(Radio::States::Radio_RX);
+            state = Engine_RxGap;
+        }
+
+        void endRxWindow() {
+            // a signal captured by the async scanner must be decoded before TX mode resets it,
+            // which can only be done from the main loop: a caller waiting for the queue or a flush gives it up
+            if (callerDepth > 0)
+                counters::rxWindowsUndecoded++;
+            else if (Signal::AsyncSignalScanner::isEnabled()) {
+                Command::EventScope event;
+                if (Signal::ScanEvent())
+                    RFLink::sendMsgFromBuffer();
+            }
+
+            counters::rxWindowsTime_ms += millis() - rxWindowStart_ms;
+            counters::rxWindowsDecodedSignals += Signal::counters::successfullyDecodedSignalsCount - rxWindowDecodedBefore;
+
+            takeRadio();
+            state = Engine_Gap;
+        }
+
+        void setup() {
+            hwSetup();
+        }
+
+        void mainLoop() {
+            switch (state) {
+                case Engine_Idle:
+                    if (queueCount > 0)
+                        startJob();
+                    break;
+
+                case Engine_Playing:
+                    if (!hwFramesDone())
+                        break;
+                    if (currentRepeat >= queue[queueHead].signal.Repeats) {
+                        finishJob();
+                    } else {
+                        startGap();
+                    }
+                    break;
+
+                case Engine_RxGap:
+                    if ((long)(millis() - rxWindowEnd_ms) >= 0)
+                        endRxWindow();
+                    break;
+
+                case Engine_Gap:
+                    if ((long)(millis() - gapEnd_ms) >= 0)
+                        startFrames();
+                    break;
+            }
+        }
+
+        void serviceFromCaller() {
+            callerDepth++;
+            mainLoop();
+            callerDepth--;
+        }
+
+        unsigned long submit(const RawSignalStruct *signal) {
+            if (signal->Number < 2 || signal->Number > RAW_BUFFER_SIZE || Radio::pins::TX_DATA == (uint8_t)NOT_A_PIN) {
+                counters::rejectedJobs++;
+                return 0;
+            }
+
+            if (!hasRoom()) {
+                counters::queueFullRejects++;
+                return 0;
+            }
+
+            TxJob &job = queue[(queueHead + queueCount) % TX_QUEUE_SIZE];
+            job.id = nextJobId++;
+            if (nextJobId == 0)
+                nextJobId = 1;
+            job.tag = submitTag;
+            job.submitTime_ms = millis();
+            memcpy(&job.signal, signal, sizeof(RawSignalStruct));
+
+            queueCount++;
+            counters::submittedJobs++;
+            if (queueCount > counters::maxQueueDepth)
+                counters::maxQueueDepth = queueCount;
+
+            if (state == Engine_Idle)
+                serviceFromCaller(); // no need to wait for next loop to start the transmitter
+
+            return job.id;
+        }
+
+        bool hasRoom() {
+            return queueCount < TX_QUEUE_SIZE;
+        }
+
+        void setSubmitTag(unsigned long tag) {
+            submitTag = tag;
+        }
+
+        void setJobCompletedCallback(JobCompletedCallback callback) {
+            jobCompletedCallback = callback;
+        }
+
+        bool isIdle() {
+            return state == Engine_Idle && queueCount == 0;
+        }
+
+        unsigned int queueDepth() {
+            return queueCount;
+        }
+
+        bool isInRxWindow() {
+            return state == Engine_RxGap;
+        }
+
+        unsigned long getRxWindowEnd() {
+            return rxWindowEnd_ms;
+        }
+
+        void flush() {
+            while (!isIdle()) {
+                serviceFromCaller();
+                yield();
+            }
+        }
+
+        void getStatusJsonString(JsonObject &output) {
+            auto &&transmit = output.createNestedObject("transmit");
+            transmit[F("queue_depth")] = queueCount;
+            transmit[F("queue_size")] = TX_QUEUE_SIZE;
+            transmit[F("submitted_jobs")] = counters::submittedJobs;
+            transmit[F("completed_jobs")] = counters::completedJobs;
+            transmit[F("rejected_jobs")] = counters::rejectedJobs;
+            transmit[F("queue_full_rejects")] = counters::queueFullRejects;
+            transmit[F("max_queue_depth")] = counters::maxQueueDepth;
+            transmit[F("frames_sent")] = counters::framesSent;
+            transmit[F("last_job_duration_ms")] = counters::lastJobDuration_ms;
+            transmit[F("max_job_duration_ms")] = counters::maxJobDuration_ms;
+            transmit[F("last_queue_latency_ms")] = counters::lastQueueLatency_ms;
+            transmit[F("max_queue_latency_ms")] = counters::maxQueueLatency_ms;
+            transmit[F("total_air_time_ms")] = (unsigned long)(counters::totalAirTime_us / 1000);
+            transmit[F("rx_windows")] = counters::rxWindows;
+            transmit[F("rx_windows_time_ms")] = counters::rxWindowsTime_ms;
+            transmit[F("rx_windows_decoded_signals")] = counters::rxWindowsDecodedSignals;
+            transmit[F("rx_windows_undecoded")] = counters::rxWindowsUndecoded;
+        }
+
+    }
+}
@@ -0,0 +1,100 @@
+#ifndef _14_Transmit_H_
+#define _14_Transmit_H_
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "2_Signal.h"
+
+#ifndef TX_QUEUE_SIZE
+#if defined(ESP32)
+#define TX_QUEUE_SIZE 16 // number of RF frames waiting for the transmitter, each one holds a full RawSignalStruct
+#else
+#define TX_QUEUE_SIZE 4
+#endif
+#endif
+
+#ifndef TX_RX_MIN_WINDOW_MS
+#define TX_RX_MIN_WINDOW_MS 5 // radio goes back to RX between repeats only if it can listen at least this long
+#endif
+
+#ifndef TX_RMT_CHANNEL
+#define TX_RMT_CHANNEL RMT_CHANNEL_0 // ESP32 only: RMT channel dedicated to the transmitter
+#endif
+
+namespace RFLink {
+    namespace Transmit {
+
+        namespace counters {
+            extern unsigned long int submittedJobs;
+            extern unsigned long int completedJobs;
+            extern unsigned long int rejectedJobs;     // invalid signal or no TX pin
+            extern unsigned long int queueFullRejects; // submission refused, no free slot
+            extern unsigned long int framesSent;
+            extern unsigned long int maxQueueDepth;
+            extern unsigned long int lastJobDuration_ms;  // from first pulse of first repeat to end of last repeat
+            extern unsigned long int maxJobDuration_ms;
+            extern unsigned long int lastQueueLatency_ms; // from submission to first pulse
+            extern unsigned long int maxQueueLatency_ms;
+            extern unsigned long long totalAirTime_us;
+            extern unsigned long int rxWindows;          // times radio was switched back to RX between repeats
+            extern unsigned long int rxWindowsTime_ms;
+            extern unsigned long int rxWindowsDecodedSignals;
+            extern unsigned long int rxWindowsUndecoded; // ended from submit() or flush(), where decoding is not allowed
+        }
+
+        /**
+         * Called when a job leaves the queue, success is false if the hardware could not play it
+         * */
+        typedef void (*JobCompletedCallback)(unsigned long jobId, unsigned long tag, bool success);
+
+        /**
+         * Include in your setup after Radio has been initialized
+         * */
+        void setup();
+        /**
+         * Include in your main loop, it drives repeats, gaps and job completion
+         * */
+        void mainLoop();
+
+        /**
+         * Copies the signal into the TX queue and returns immediately, it never waits for a free slot
+         * @return job id (>0) or 0 if the signal was rejected or the queue is full
+         * */
+        unsigned long submit(const RawSignalStruct *signal);
+        /**
+         * @return true if submit() has a free slot, callers holding more frames should feed them from the main loop
+         * */
+        bool hasRoom();
+
+        /**
+         * Jobs submitted until the tag is reset to 0 will carry it, so a caller can track
+         * frames queued on its behalf by plugins. Completion of tagged jobs is reported to the callback.
+         * */
+        void setSubmitTag(unsigned long tag);
+        void setJobCompletedCallback(JobCompletedCallback callback);
+
+        /**
+         * @return true when nothing is being transmitted nor waiting in queue
+         * */
+        bool isIdle();
+        unsigned int queueDepth();
+
+        /**
+         * @return true while radio has been put back in RX between two repeats of a job
+         * */
+        bool isInRxWindow();
+        /**
+         * @return millis() at which the radio will be taken back for the next repeat, only valid if isInRxWindow()
+         * */
+        unsigned long getRxWindowEnd();
+
+        /**
+         * Blocks until all pending jobs have been transmitted, only meant to be used before a reboot
+         * */
+        void flush();
+
+        void getStatusJsonString(JsonObject &output);
+    }
+}
+
+#endif // _14_Transmit_H_
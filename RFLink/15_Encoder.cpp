@@ -0,0 +1,74 @@
+#include <Arduino.h>
+#include "2_Signal.h"
+#include "15_Encoder.h"
+
+namespace RFLink {
+    namespace Encoder {
+
+        bool begin(RawSignalStruct &signal, const Protocol &protocol) {
+            signal.Number = 0;
+            signal.Multiply = 1;
+            signal.Repeats = protocol.repeats;
+            signal.Delay = protocol.delay_ms;
+            signal.Time = 0UL;
+            signal.readyForDecoder = false;
+
+            return appendSymbol(signal, protocol.preamble);
+        }
+
+        bool appendPulse(RawSignalStruct &signal, bool level, unsigned long duration_us) {
+            bool lastLevel = (signal.Number & 1) != 0; // pulses alternate from a mark at index 1
+
+            if (signal.Number == 0 && level == LOW)
+                return true; // leading silence is meaningless
+
+            if (signal.Number > 0 && level == lastLevel) {
+                duration_us += signal.Pulses[signal.Number];
+                if (duration_us > UINT16_MAX)
+                    return false;
+                signal.Pulses[signal.Number] = duration_us;
+                return true;
+            }
+
+            if (signal.Number >= RAW_BUFFER_SIZE || duration_us > UINT16_MAX)
+                return false;
+
+            signal.Pulses[++signal.Number] = duration_us;
+            return true;
+        }
+
+        bool appendSymbol(RawSignalStruct &signal, const Symbol &symbol) {
+            bool level = symbol.firstLevel;
+
+            for (uint8_t i = 0; i < symbol.count; i++) {
+                if (!appendPulse(signal, level, symbol.pulses[i]))
+                    return false;
+                level = !level;
+            }
+            return true;
+        }
+
+        bool appendBits(RawSignalStruct &signal, const Protocol &protocol, unsigned long bits, uint8_t count) {
+            while (count > 0) {
+                count--;
+                if (!appendSymbol(signal, ((bits >> count) & 1) ? protocol.one : protocol.zero))
+                    return false;
+            }
+            return true;
+        }
+
+        bool end(RawSignalStruct &signal, const Protocol &protocol) {
+            if (!appendSymbol(signal, protocol.footer))
+                return false;
+
+            if (signal.Number & 1)
+                return appendPulse(signal, LOW, ENCODER_END_SPACE_US);
+
+            return true;
+        }
+
+        bool encode(RawSignalStruct &signal, const Protocol &protocol, unsigned long bits, uint8_t count) {
+            return begin(signal, protocol) && appendBits(signal, protocol, bits, count) && end(signal, protocol);
+        }
+    }
+}
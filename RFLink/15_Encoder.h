@@ -0,0 +1,64 @@
+#ifndef _15_Encoder_H_
+#define _15_Encoder_H_
+
+#include <Arduino.h>
+#include "2_Signal.h"
+
+#define ENCODER_SYMBOL_MAX_PULSES 4
+#define ENCODER_END_SPACE_US 100 // appended when a frame would otherwise end with a mark
+
+/**
+ * Helpers to render protocol bitstreams into a RawSignalStruct that can be handed over to Transmit.
+ *
+ * A protocol is described by symbol tables, each symbol being a short list of pulse durations
+ * with alternating levels:
+ *  - PWM/PPM: symbols start with a mark, ie {HIGH, {T, 3T}} for a '0' and {HIGH, {3T, T}} for a '1'
+ *  - Manchester: half-bit symbols, ie {LOW, {T, T}} for a '0' and {HIGH, {T, T}} for a '1' (G.E. Thomas)
+ * Consecutive pulses with the same level are merged so Manchester needs no special treatment.
+ * */
+namespace RFLink {
+    namespace Encoder {
+
+        struct Symbol {
+            uint8_t count;      // number of pulses, 0 means no symbol
+            bool firstLevel;    // level of first pulse, next ones alternate
+            uint16_t pulses[ENCODER_SYMBOL_MAX_PULSES]; // microseconds
+        };
+
+        struct Protocol {
+            Symbol preamble;    // sent once before data
+            Symbol zero;
+            Symbol one;
+            Symbol footer;      // sync/gap sent once after data
+            uint8_t repeats;    // number of times the frame is sent
+            uint8_t delay_ms;   // silence between two repeats, on top of the footer
+        };
+
+        /**
+         * Resets the signal from protocol repeat policy and appends its preamble
+         * */
+        bool begin(RawSignalStruct &signal, const Protocol &protocol);
+
+        /**
+         * @return false if signal buffer is full or pulse too long
+         * */
+        bool appendPulse(RawSignalStruct &signal, bool level, unsigned long duration_us);
+        bool appendSymbol(RawSignalStruct &signal, const Symbol &symbol);
+        /**
+         * Appends the 'count' lowest bits of 'bits', MSB first
+         * */
+        bool appendBits(RawSignalStruct &signal, const Protocol &protocol, unsigned long bits, uint8_t count);
+
+        /**
+         * Appends protocol footer and makes sure the frame ends with a space
+         * */
+        bool end(RawSignalStruct &signal, const Protocol &protocol);
+
+        /**
+         * Shortcut for begin() + appendBits() + end()
+         * */
+        bool encode(RawSignalStruct &signal, const Protocol &protocol, unsigned long bits, uint8_t count);
+    }
+}
+
+#endif // _15_Encoder_H_
@@ -0,0 +1,374 @@
+#include <Arduino.h>
+#include "RFLink.h"
+#include "4_Display.h"
+#include "5_Plugin.h"
+#include "14_Transmit.h"
+#include "16_Batch.h"
+#include "27_Command.h"
+
+namespace RFLink {
+    namespace Batch {
+
+        namespace counters {
+            unsigned long int batches = 0;
+            unsigned long int queuedCommands = 0;
+            unsigned long int coalescedCommands = 0;
+            unsigned long int unknownCommands = 0;
+            unsigned long int failedCommands = 0;
+            unsigned long int untrackedBatches = 0;
+        }
+
+        enum CommandState {
+            Cmd_Idle,     // coalesced, unknown or already reported
+            Cmd_Waiting,  // not handed to its plugin yet, the transmitter queue is full
+            Cmd_Pending,  // waiting for its frames to leave the transmitter
+        };
+
+        struct TrackedCommand {
+            uint8_t state;
+            bool failed;
+            int16_t pendingJobs; // may go negative while plugin is still submitting
+        };
+
+        struct TrackedBatch {
+            unsigned long id;    // 0 means slot is free
+            uint8_t commandCount;
+            TrackedCommand commands[BATCH_MAX_COMMANDS];
+        };
+
+        TrackedBatch tracked[BATCH_MAX_TRACKED];
+        unsigned long nextBatchId = 1;
+
+        /**
+         * Batch whose commands are handed to plugins as the transmitter frees up
+         * */
+        struct Feed {
+            unsigned long id;        // 0 means no batch is being fed
+            TrackedBatch *batch;     // nullptr if untracked
+            char buffer[BATCH_FEED_BUFFER_SIZE]; // each command as its index (1 byte), text and terminator
+            size_t used;
+            size_t next;
+            unsigned int queued;
+            unsigned int coalesced;
+            unsigned int unknown;
+        };
+
+        Feed feed;
+
+#ifdef RFLINK_WIFI_ENABLED
+        char httpBuffer[BATCH_HTTP_BUFFER_SIZE]; // "10;batch;" followed by the commands, to go through the command router
+        const char httpBufferPrefix[] = "10;batch;";
+        const Command::Context httpContext = {Command::Source_Http, nullptr, nullptr, nullptr}; // the HTTP reply is sent right away, results go everywhere
+        volatile bool httpBatchPending = false;
+#endif
+
+        // ids are kept on 24 bits so the command index fits in the low byte of a Transmit tag
+        inline unsigned long makeTag(unsigned long batchId, unsigned int index) {
+            return (batchId << 8) | index;
+        }
+
+        TrackedBatch *findTracked(unsigned long id) {
+            for (auto &batch : tracked) {
+                if (batch.id == id)
+                    return &batch;
+            }
+            return nullptr;
+        }
+
+        void onJobCompleted(unsigned long jobId, unsigned long tag, bool success) {
+            TrackedBatch *batch = findTracked(tag >> 8);
+            unsigned int index = tag & 0xff;
+
+            if (batch == nullptr || index == 0 || index > batch->commandCount)
+                return;
+
+            TrackedCommand &command = batch->commands[index - 1];
+            command.pendingJobs--;
+            if (!success)
+                command.failed = true;
+        }
+
+        /**
+         * Starts a "20;XX;BATCH;ID=n" message in pbuffer, caller must append and call display_Footer()
+         * */
+        void displayBatchHeader(unsigned long id) {
+            sendMsgFromBuffer(); // pbuffer holds a single message
+            display_Header();
+            display_Name(PSTR("BATCH"));
+            sprintf_P(pbuffer + strlen(pbuffer), PSTR(";ID=%lu"), id);
+        }
+
+        void displayCommandStatus(unsigned long id, unsigned int index, const char *status) {
+            displayBatchHeader(id);
+            sprintf_P(pbuffer + strlen(pbuffer), PSTR(";CMD=%u"), index);
+            display_Name(status);
+            display_Footer();
+            sendMsgFromBuffer();
+        }
+
+        /**
+         * @return length of the "Protocol;ID;SWITCH;" part which identifies the target device
+         * */
+        size_t deviceKeyLength(const char *entry) {
+            const char *p = entry;
+            for (int fields = 0; fields < 3; fields++) {
+                p = strchr(p, ';');
+                if (p == nullptr)
+                    return strlen(entry);
+                p++;
+            }
+            return p - entry;
+        }
+
+        bool isCoalesced(char **entries, unsigned int count, unsigned int index) {
+            size_t keyLength = deviceKeyLength(entries[index]);
+
+            for (unsigned int i = index + 1; i < count; i++) {
+                if (deviceKeyLength(entries[i]) == keyLength && strncasecmp(entries[i], entries[index], keyLength) == 0)
+                    return true;
+            }
+            return false;
+        }
+
+        void setup() {
+            for (auto &batch : tracked)
+                batch.id = 0;
+            feed.id = 0;
+            Transmit::setJobCompletedCallback(onJobCompleted);
+        }
+
+        /**
+         * Hands waiting commands to their plugin while the transmitter has room,
+         * then sends the batch summary once the last one is gone
+         * */
+        void feedCommands() {
+            while (feed.id != 0 && feed.next < feed.used && Transmit::hasRoom()) {
+                unsigned int index = (uint8_t) feed.buffer[feed.next];
+                const char *entry = feed.buffer + feed.next + 1;
+                size_t length = strlen(entry);
+                feed.next += length + 2;
+
+                char command[RETRIEVE_BUFFER_SIZE]; // length was checked when the batch was received
+                strcpy_P(command, PSTR("10;"));
+                strcat(command, entry);
+                if (entry[length - 1] != ';')
+                    strcat(command, ";");
+
+                unsigned long submittedBefore = Transmit::counters::submittedJobs;
+                if (feed.batch != nullptr)
+                    Transmit::setSubmitTag(makeTag(feed.id, index));
+                bool accepted = PluginTXCall(0, command);
+                Transmit::setSubmitTag(0);
+
+                TrackedCommand *trackedCommand = feed.batch != nullptr ? &feed.batch->commands[index - 1] : nullptr;
+                if (!accepted) {
+                    feed.unknown++;
+                    if (trackedCommand != nullptr)
+                        trackedCommand->state = Cmd_Idle;
+                    displayCommandStatus(feed.id, index, PSTR("CMD UNKNOWN"));
+                    continue;
+                }
+
+                feed.queued++;
+                if (trackedCommand != nullptr) {
+                    trackedCommand->pendingJobs += Transmit::counters::submittedJobs - submittedBefore;
+                    trackedCommand->state = Cmd_Pending;
+                }
+            }
+
+            if (feed.id == 0 || feed.next < feed.used)
+                return;
+
+            counters::queuedCommands += feed.queued;
+            counters::coalescedCommands += feed.coalesced;
+            counters::unknownCommands += feed.unknown;
+
+            displayBatchHeader(feed.id);
+            sprintf_P(pbuffer + strlen(pbuffer), PSTR(";QUEUED=%u;COALESCED=%u;UNKNOWN=%u"), feed.queued, feed.coalesced, feed.unknown);
+            display_Footer();
+            sendMsgFromBuffer();
+            feed.id = 0;
+        }
+
+        void displayBatchError(PGM_P error) {
+            sendMsgFromBuffer();
+            display_Header();
+            display_Name(PSTR("BATCH"));
+            display_Name(error);
+            display_Footer();
+        }
+
+        void executeCliCommand(char *commands) {
+            char *entries[BATCH_MAX_COMMANDS];
+            unsigned int count = 0;
+            char *next = commands;
+
+            if (feed.id != 0) {
+                displayBatchError(PSTR("BUSY"));
+                return;
+            }
+
+            while (next != nullptr) {
+                char *entry = next;
+                next = strchr(entry, '|');
+                if (next != nullptr)
+                    *next++ = 0;
+
+                while (*entry == ' ')
+                    entry++;
+                if (strncmp(entry, "10;", 3) == 0)
+                    entry += 3;
+                if (*entry == 0 || strcmp(entry, ";") == 0)
+                    continue;
+
+                if (count >= BATCH_MAX_COMMANDS) {
+                    displayBatchError(PSTR("TOO MANY COMMANDS"));
+                    return;
+                }
+                entries[count++] = entry;
+            }
+
+            // copied first: the batch is refused as a whole if it does not fit
+            enum EntryKind : uint8_t { Entry_Fed, Entry_Coalesced, Entry_TooLong };
+            EntryKind kinds[BATCH_MAX_COMMANDS];
+            feed.used = 0;
+            for (unsigned int i = 0; i < count; i++) {
+                size_t length = strlen(entries[i]);
+                if (isCoalesced(entries, count, i)) {
+                    kinds[i] = Entry_Coalesced;
+                } else if (length + 5 > RETRIEVE_BUFFER_SIZE) { // "10;" + entry + ";" + terminator
+                    kinds[i] = Entry_TooLong;
+                } else if (feed.used + length + 2 > sizeof(feed.buffer)) {
+                    displayBatchError(PSTR("TOO LONG"));
+                    return;
+                } else {
+                    kinds[i] = Entry_Fed;
+                    feed.buffer[feed.used] = i + 1;
+                    memcpy(feed.buffer + feed.used + 1, entries[i], length + 1);
+                    feed.used += length + 2;
+                }
+            }
+
+            unsigned long id = nextBatchId++;
+            if (nextBatchId > 0xffffffUL)
+                nextBatchId = 1;
+            counters::batches++;
+
+            TrackedBatch *batch = findTracked(0);
+            if (batch != nullptr) {
+                batch->id = id;
+                batch->commandCount = count;
+                for (unsigned int i = 0; i < count; i++) {
+                    batch->commands[i].state = kinds[i] == Entry_Fed ? Cmd_Waiting : Cmd_Idle;
+                    batch->commands[i].failed = false;
+                    batch->commands[i].pendingJobs = 0;
+                }
+            } else {
+                counters::untrackedBatches++;
+            }
+
+            feed.id = id;
+            feed.batch = batch;
+            feed.next = 0;
+            feed.queued = 0;
+            feed.coalesced = 0;
+            feed.unknown = 0;
+
+            for (unsigned int i = 0; i < count; i++) {
+                if (kinds[i] == Entry_Coalesced) {
+                    feed.coalesced++;
+                    displayCommandStatus(id, i + 1, PSTR("COALESCED"));
+                } else if (kinds[i] == Entry_TooLong) {
+                    feed.unknown++;
+                    displayCommandStatus(id, i + 1, PSTR("CMD UNKNOWN"));
+                }
+            }
+
+            feedCommands(); // as much as the transmitter takes right now, main loop does the rest
+        }
+
+        void reportCompletions() {
+            Command::EventScope event; // completions are not answers to whatever command is running
+
+            for (auto &batch : tracked) {
+                if (batch.id == 0)
+                    continue;
+
+                bool done = true;
+                for (unsigned int i = 0; i < batch.commandCount; i++) {
+                    TrackedCommand &command = batch.commands[i];
+                    if (command.state == Cmd_Waiting)
+                        done = false;
+                    if (command.state != Cmd_Pending)
+                        continue;
+                    if (command.pendingJobs > 0) {
+                        done = false;
+                        continue;
+                    }
+                    command.state = Cmd_Idle;
+                    if (command.failed)
+                        counters::failedCommands++;
+                    displayCommandStatus(batch.id, i + 1, command.failed ? PSTR("FAILED") : PSTR("SENT"));
+                }
+
+                if (done) {
+                    displayBatchHeader(batch.id);
+                    display_Name(PSTR("DONE"));
+                    display_Footer();
+                    sendMsgFromBuffer();
+                    batch.id = 0;
+                }
+            }
+        }
+
+        void mainLoop() {
+            feedCommands();
+#ifdef RFLINK_WIFI_ENABLED
+            if (httpBatchPending && feed.id == 0) { // would be answered BUSY
+                Command::execute(httpBuffer, httpContext);
+                httpBatchPending = false;
+            }
+#endif
+            reportCompletions();
+        }
+
+#ifdef RFLINK_WIFI_ENABLED
+        bool scheduleFromJson(const JsonArray &commands) {
+            if (httpBatchPending)
+                return false;
+
+            size_t used = sizeof(httpBufferPrefix) - 1;
+            memcpy(httpBuffer, httpBufferPrefix, sizeof(httpBufferPrefix));
+
+            for (JsonVariant command : commands) {
+                const char *str = command.as<const char *>();
+                if (str == nullptr)
+                    return false;
+
+                size_t length = strlen(str);
+                if (used + length + 2 > sizeof(httpBuffer))
+                    return false;
+
+                if (used > sizeof(httpBufferPrefix) - 1)
+                    httpBuffer[used++] = '|';
+                memcpy(httpBuffer + used, str, length + 1);
+                used += length;
+            }
+
+            httpBatchPending = true;
+            return true;
+        }
+#endif
+
+        void getStatusJsonString(JsonObject &output) {
+            auto &&batch = output.createNestedObject("batch");
+            batch[F("batches")] = counters::batches;
+            batch[F("queued_commands")] = counters::queuedCommands;
+            batch[F("coalesced_commands")] = counters::coalescedCommands;
+            batch[F("unknown_commands")] = counters::unknownCommands;
+            batch[F("failed_commands")] = counters::failedCommands;
+            batch[F("untracked_batches")] = counters::untrackedBatches;
+        }
+
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef _16_Batch_H_
+#define _16_Batch_H_
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#ifndef BATCH_MAX_COMMANDS
+#define BATCH_MAX_COMMANDS 32 // device commands accepted in a single batch
+#endif
+
+#ifndef BATCH_MAX_TRACKED
+#define BATCH_MAX_TRACKED 4 // batches whose per-command completion is reported at the same time
+#endif
+
+#ifndef BATCH_FEED_BUFFER_SIZE
+#if defined(ESP32)
+#define BATCH_FEED_BUFFER_SIZE 2048 // commands of the batch still waiting for room in the transmitter queue
+#else
+#define BATCH_FEED_BUFFER_SIZE 512
+#endif
+#endif
+
+#ifndef BATCH_HTTP_BUFFER_SIZE
+#if defined(ESP32)
+#define BATCH_HTTP_BUFFER_SIZE 1024 // room for a batch received through the web API, waiting for main loop
+#else
+#define BATCH_HTTP_BUFFER_SIZE 512
+#endif
+#endif
+
+/**
+ * Executes many TX commands in one request: 10;batch;<cmd>|<cmd>|...;
+ * where each <cmd> is a regular TX command with or without its "10;" prefix, ie:
+ *   10;batch;NewKaku;00c142;1;ON|NewKaku;00c142;2;OFF|NewKaku;00c142;1;OFF;
+ * Commands targeting the same Protocol;ID;SWITCH are coalesced, only the last one is sent.
+ * Commands are handed to their plugin from the main loop whenever the transmitter queue has room, so a batch
+ * never waits for the radio, and their completion is reported asynchronously.
+ * Only one batch is fed at a time, another one is answered BUSY until it is done.
+ * */
+namespace RFLink {
+    namespace Batch {
+
+        namespace counters {
+            extern unsigned long int batches;
+            extern unsigned long int queuedCommands;
+            extern unsigned long int coalescedCommands;
+            extern unsigned long int unknownCommands;
+            extern unsigned long int failedCommands;   // accepted by a plugin but transmitter could not play it
+            extern unsigned long int untrackedBatches; // too many batches in flight, completion was not reported
+        }
+
+        /**
+         * Include in your setup after Transmit has been initialized
+         * */
+        void setup();
+        /**
+         * Include in your main loop, it feeds the transmitter, reports completions and runs batches received from the web API
+         * */
+        void mainLoop();
+
+        /**
+         * @param commands the part following "10;batch;", it is modified in place
+         * */
+        void executeCliCommand(char *commands);
+
+#ifdef RFLINK_WIFI_ENABLED
+        /**
+         * Safe to call from web server task, the batch will run from main loop.
+         * @return false if a previous batch is still waiting or this one does not fit
+         * */
+        bool scheduleFromJson(const JsonArray &commands);
+#endif
+
+        void getStatusJsonString(JsonObject &output);
+    }
+}
+
+#endif // _16_Batch_H_
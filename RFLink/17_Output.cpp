@@ -0,0 +1,369 @@
+#include <Arduino.h>
+#include "RFLink.h"
+#include "17_Output.h"
+#include "25_Log.h"
+
+namespace RFLink {
+    namespace Output {
+
+        struct Message {
+            unsigned long publishTime_us;
+            uint8_t sinkMask;     // sinks which still have to receive it
+            bool raw;
+            uint8_t length;
+            char text[PRINT_BUFFER_SIZE];
+        };
+
+        static_assert(OUTPUT_MAX_SINKS <= 8, "sinkMask is 8 bits wide");
+        static_assert(PRINT_BUFFER_SIZE <= 255, "Message length is 8 bits wide");
+
+        Message pool[OUTPUT_POOL_SIZE];
+        unsigned long nextSeq = 0;
+
+        Sink *sinks[OUTPUT_MAX_SINKS];
+        uint8_t sinksCount = 0;
+        unsigned int pending[OUTPUT_MAX_SINKS]; // messages flagged for each sink between its readSeq and nextSeq
+
+        char rawChunk[PRINT_BUFFER_SIZE];
+        size_t rawLength = 0;
+        bool rawTruncating = false; // skipping the rest of a line after one of its chunks was dropped
+        unsigned long rawChunks = 0;
+        unsigned long rawBytes = 0;
+        unsigned long rawOverflowChunks = 0; // dropped because their pool slot was still in use
+        unsigned long rawTruncatedLines = 0;
+
+        Sink::Sink(const char *name, Format format, DropPolicy dropPolicy, uint8_t queueSize,
+                   bool (*isEnabled)(), bool (*isReady)(size_t), bool (*write)(const char *, size_t),
+                   bool acceptsRaw, bool (*writeRaw)(const char *, size_t)) :
+                name(name), format(format), dropPolicy(dropPolicy),
+                queueSize(queueSize > OUTPUT_POOL_SIZE ? OUTPUT_POOL_SIZE : (queueSize == 0 ? 1 : queueSize)),
+                isEnabled(isEnabled), isReady(isReady), write(write), acceptsRaw(acceptsRaw), writeRaw(writeRaw),
+                readSeq(0), published(0), delivered(0), dropped(0), writeFailures(0), rawDropped(0), maxDepth(0),
+                lastLatency_us(0), maxLatency_us(0) {}
+
+        inline bool isEnabled(const Sink *sink) {
+            return sink->isEnabled == nullptr || sink->isEnabled();
+        }
+
+        /**
+         * Moves the sink cursor one message forward, counting it as dropped if it was meant for the sink
+         * */
+        void skipOne(uint8_t index) {
+            Sink *sink = sinks[index];
+            Message &msg = pool[sink->readSeq % OUTPUT_POOL_SIZE];
+
+            if (msg.sinkMask & (1 << index)) {
+                msg.sinkMask &= ~(1 << index);
+                pending[index]--;
+                if (msg.raw)
+                    sink->rawDropped++;
+                else
+                    sink->dropped++;
+            }
+            sink->readSeq++;
+        }
+
+        void dropOldest(uint8_t index) {
+            unsigned int before = pending[index];
+            while (pending[index] == before)
+                skipOne(index);
+        }
+
+        void writeMessage(uint8_t index, Message &msg) {
+            Sink *sink = sinks[index];
+            char bare[PRINT_BUFFER_SIZE];
+            const char *text = msg.text;
+            size_t length = msg.length;
+
+            if (sink->format == Format_Bare && !msg.raw) {
+                while (length > 0 && (text[length - 1] == '\r' || text[length - 1] == '\n'))
+                    length--;
+                memcpy(bare, text, length);
+                bare[length] = 0;
+                text = bare;
+            }
+
+            bool (*write)(const char *, size_t) = msg.raw && sink->writeRaw != nullptr ? sink->writeRaw : sink->write;
+            if (!write(text, length))
+                sink->writeFailures++;
+            else if (!msg.raw)
+                sink->delivered++;
+
+            if (msg.raw)
+                return;
+
+            sink->lastLatency_us = micros() - msg.publishTime_us;
+            if (sink->lastLatency_us > sink->maxLatency_us)
+                sink->maxLatency_us = sink->lastLatency_us;
+        }
+
+        /**
+         * @param force write even if the sink says it is not ready
+         * */
+        void service(uint8_t index, unsigned int maxWrites, bool force) {
+            Sink *sink = sinks[index];
+            bool enabled = isEnabled(sink);
+
+            while (sink->readSeq != nextSeq && maxWrites > 0) {
+                Message &msg = pool[sink->readSeq % OUTPUT_POOL_SIZE];
+
+                if (!(msg.sinkMask & (1 << index)) || !enabled) { // not for us, or sink got disabled meanwhile
+                    skipOne(index);
+                    continue;
+                }
+
+                if (!force && sink->isReady != nullptr && !sink->isReady(msg.length))
+                    break;
+
+                msg.sinkMask &= ~(1 << index);
+                pending[index]--;
+                sink->readSeq++;
+                maxWrites--;
+                writeMessage(index, msg);
+            }
+        }
+
+        void serviceBlocking(uint8_t index) {
+            unsigned long start = millis();
+            while (pending[index] >= sinks[index]->queueSize && millis() - start < OUTPUT_BLOCK_TIMEOUT_MS) {
+                service(index, 1, false);
+                if (pending[index] >= sinks[index]->queueSize)
+                    yield();
+            }
+        }
+
+        /**
+         * Drop_Block sink still owning the slot about to be reused: give it a chance to take its message first
+         * */
+        void serviceOldestBlocking(uint8_t index) {
+            Sink *sink = sinks[index];
+            unsigned long readSeq = sink->readSeq;
+            unsigned long start = millis();
+            while (sink->readSeq == readSeq && millis() - start < OUTPUT_BLOCK_TIMEOUT_MS) {
+                service(index, 1, false);
+                if (sink->readSeq == readSeq)
+                    yield();
+            }
+        }
+
+        void setup() {
+            sinksCount = 0;
+            nextSeq = 0;
+        }
+
+        bool registerSink(Sink *sink) {
+            for (uint8_t i = 0; i < sinksCount; i++) {
+                if (sinks[i] == sink)
+                    return true;
+            }
+
+            if (sinksCount >= OUTPUT_MAX_SINKS) {
+                Log::printf(Log::Module_Core, Log::Level_Error, PSTR("Output: cannot register sink '%s', too many sinks"), sink->name);
+                return false;
+            }
+
+            sink->readSeq = nextSeq;
+            pending[sinksCount] = 0;
+            sinks[sinksCount++] = sink;
+            return true;
+        }
+
+        /**
+         * @param only nullptr for every sink
+         * @return false if a raw chunk was dropped because the pool is full of undelivered messages
+         * */
+        bool enqueue(const char *text, size_t length, bool raw, const Sink *only = nullptr) {
+            unsigned long seq = nextSeq;
+            Message &slot = pool[seq % OUTPUT_POOL_SIZE];
+            uint8_t mask = 0;
+
+            if (raw && slot.sinkMask != 0) {
+                // raw output never waits nor reclaims a message someone still has to get
+                for (uint8_t i = 0; i < sinksCount; i++)
+                    service(i, OUTPUT_MAX_WRITES_PER_LOOP, false);
+                if (slot.sinkMask != 0)
+                    return false;
+            }
+
+            for (uint8_t i = 0; i < sinksCount; i++) {
+                Sink *sink = sinks[i];
+
+                // the slot we are about to reuse must have been consumed by everyone
+                while (seq - sink->readSeq >= OUTPUT_POOL_SIZE) {
+                    if (sink->dropPolicy == Drop_Block && (pool[sink->readSeq % OUTPUT_POOL_SIZE].sinkMask & (1 << i))) {
+                        serviceOldestBlocking(i);
+                        if (seq - sink->readSeq < OUTPUT_POOL_SIZE)
+                            break;
+                    }
+                    skipOne(i);
+                }
+
+                if (!isEnabled(sink) || (raw && !sink->acceptsRaw) || (only != nullptr && sink != only))
+                    continue;
+
+                if (raw && pending[i] >= sink->queueSize) {
+                    sink->rawDropped++; // debug output must not stall the decoder
+                    continue;
+                }
+
+                if (pending[i] >= sink->queueSize) {
+                    switch (sink->dropPolicy) {
+                        case Drop_Newest:
+                            sink->dropped++;
+                            continue;
+                        case Drop_Block:
+                            serviceBlocking(i);
+                            if (pending[i] < sink->queueSize)
+                                break;
+                            // fall through
+                        case Drop_Oldest:
+                            dropOldest(i);
+                            break;
+                    }
+                }
+
+                mask |= 1 << i;
+                pending[i]++;
+                if (!raw)
+                    sink->published++;
+                if (pending[i] > sink->maxDepth)
+                    sink->maxDepth = pending[i];
+            }
+
+            if (length > PRINT_BUFFER_SIZE - 1)
+                length = PRINT_BUFFER_SIZE - 1;
+            memcpy(slot.text, text, length);
+            slot.text[length] = 0;
+            slot.length = length;
+            slot.raw = raw;
+            slot.sinkMask = mask;
+            slot.publishTime_us = micros();
+            nextSeq++;
+
+            // most of the time sinks are ready, so don't wait for next loop
+            for (uint8_t i = 0; i < sinksCount; i++)
+                service(i, OUTPUT_MAX_WRITES_PER_LOOP, false);
+            return true;
+        }
+
+        void publish(const char *msg) {
+            flushRaw(); // keep raw output and messages in order
+            enqueue(msg, strlen(msg), false);
+        }
+
+        bool publishTo(const char *msg, const char *sinkName) {
+            for (uint8_t i = 0; i < sinksCount; i++) {
+                if (strcmp(sinks[i]->name, sinkName) != 0)
+                    continue;
+                flushRaw();
+                enqueue(msg, strlen(msg), false, sinks[i]);
+                return true;
+            }
+            return false;
+        }
+
+        /**
+         * @return false if the chunk had to be dropped
+         * */
+        bool queueRawChunk() {
+            if (rawLength == 0)
+                return true;
+            rawChunks++;
+            bool queued = enqueue(rawChunk, rawLength, true);
+            if (!queued)
+                rawOverflowChunks++;
+            rawLength = 0;
+            return queued;
+        }
+
+        void flushRaw() {
+            queueRawChunk();
+        }
+
+        void publishRaw(const char *buf, size_t length) {
+            rawBytes += length;
+
+            while (length > 0) {
+                if (rawTruncating) {
+                    while (length > 0 && pgm_read_byte(buf) != '\n') {
+                        buf++;
+                        length--;
+                    }
+                    if (length == 0)
+                        return;
+                    rawTruncating = false; // the end of line goes through, so next output starts on a new line
+                }
+
+                size_t count = PRINT_BUFFER_SIZE - 1 - rawLength;
+                if (count > length)
+                    count = length;
+
+                memcpy_P(rawChunk + rawLength, buf, count);
+                bool endOfLine = memchr(rawChunk + rawLength, '\n', count) != nullptr;
+                rawLength += count;
+                buf += count;
+                length -= count;
+
+                if ((endOfLine || rawLength >= PRINT_BUFFER_SIZE - 1) && !queueRawChunk() && !endOfLine) {
+                    // sinks are behind: rather than a line with a hole in it, skip the rest of it
+                    rawTruncating = true;
+                    rawTruncatedLines++;
+                }
+            }
+        }
+
+        void publishRaw(const char *buf) {
+            publishRaw(buf, strlen_P(buf));
+        }
+
+        void mainLoop() {
+            flushRaw(); // partial lines, ie prompts, don't wait for more
+            for (uint8_t i = 0; i < sinksCount; i++)
+                service(i, OUTPUT_MAX_WRITES_PER_LOOP, false);
+        }
+
+        unsigned int queueDepth(const Sink *sink) {
+            for (uint8_t i = 0; i < sinksCount; i++) {
+                if (sinks[i] == sink)
+                    return pending[i];
+            }
+            return 0;
+        }
+
+        const Sink *getSink(uint8_t index) {
+            return index < sinksCount ? sinks[index] : nullptr;
+        }
+
+        void flush() {
+            flushRaw();
+            for (uint8_t i = 0; i < sinksCount; i++)
+                service(i, OUTPUT_POOL_SIZE, true);
+        }
+
+        void getStatusJsonString(JsonObject &output) {
+            auto &&bus = output.createNestedObject("output");
+            bus[F("pool_size")] = OUTPUT_POOL_SIZE;
+            bus[F("raw_chunks")] = rawChunks;
+            bus[F("raw_bytes")] = rawBytes;
+            bus[F("raw_overflow_chunks")] = rawOverflowChunks;
+            bus[F("raw_truncated_lines")] = rawTruncatedLines;
+
+            for (uint8_t i = 0; i < sinksCount; i++) {
+                Sink *sink = sinks[i];
+                auto &&obj = bus.createNestedObject(sink->name);
+                obj[F("enabled")] = isEnabled(sink);
+                obj[F("queue_depth")] = pending[i];
+                obj[F("queue_size")] = sink->queueSize;
+                obj[F("max_depth")] = sink->maxDepth;
+                obj[F("published")] = sink->published;
+                obj[F("delivered")] = sink->delivered;
+                obj[F("dropped")] = sink->dropped;
+                obj[F("write_failures")] = sink->writeFailures;
+                obj[F("raw_dropped")] = sink->rawDropped;
+                obj[F("last_latency_us")] = sink->lastLatency_us;
+                obj[F("max_latency_us")] = sink->maxLatency_us;
+            }
+        }
+
+    }
+}
@@ -0,0 +1,136 @@
+#ifndef _17_Output_H_
+#define _17_Output_H_
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "4_Display.h"
+
+#ifndef OUTPUT_POOL_SIZE
+#if defined(ESP32)
+#define OUTPUT_POOL_SIZE 32 // messages kept until every sink has consumed them, bounds all sink queues
+#else
+#define OUTPUT_POOL_SIZE 8
+#endif
+#endif
+
+#ifndef OUTPUT_MAX_SINKS
+#define OUTPUT_MAX_SINKS 8
+#endif
+
+#ifndef OUTPUT_MAX_WRITES_PER_LOOP
+#define OUTPUT_MAX_WRITES_PER_LOOP 4 // per sink, so a busy sink cannot hog the main loop
+#endif
+
+#ifndef OUTPUT_BLOCK_TIMEOUT_MS
+#define OUTPUT_BLOCK_TIMEOUT_MS 200 // Drop_Block sinks fall back to dropping oldest after this
+#endif
+
+/**
+ * Output bus: RFLink messages built in pbuffer are published once and delivered to every registered
+ * sink (Serial, MQTT, Serial2Net, OLED...) from its own bounded queue, so a slow sink only delays itself.
+ *
+ * Messages live in a shared pool, each sink reads it through its own cursor. A sink queue can never be
+ * larger than the pool, when it is full the sink drop policy decides what happens to the new message.
+ *
+ * Raw output (sendRawPrint) is coalesced into chunks which are queued like messages, at end of line,
+ * when the chunk is full or before the next message. Raw chunks never block whatever the sink policy:
+ * a chunk is dropped and accounted for when a sink queue is full, or when its pool slot still holds a
+ * message not delivered yet. The rest of a line which lost a chunk that way is skipped.
+ * */
+namespace RFLink {
+    namespace Output {
+
+        enum Format {
+            Format_Line,  // message as built, "20;XX;...;\r\n"
+            Format_Bare,  // without trailing end of line
+        };
+
+        enum DropPolicy {
+            Drop_Oldest,  // make room by discarding the oldest message of this sink
+            Drop_Newest,  // this sink skips the new message
+            Drop_Block,   // service this sink until it has room, up to OUTPUT_BLOCK_TIMEOUT_MS
+        };
+
+        struct Sink {
+            const char *name;
+            Format format;
+            DropPolicy dropPolicy;
+            uint8_t queueSize;                  // <= OUTPUT_POOL_SIZE
+            bool (*isEnabled)();                // nullptr means always, disabled sinks receive nothing
+            bool (*isReady)(size_t length);     // nullptr means always, must not block
+            bool (*write)(const char *msg, size_t length); // false if the sink failed to deliver
+            bool acceptsRaw;                    // receives sendRawPrint() output too
+            bool (*writeRaw)(const char *msg, size_t length); // nullptr means write() gets raw chunks too
+
+            // owned by the bus
+            unsigned long readSeq;
+            unsigned long published;
+            unsigned long delivered;
+            unsigned long dropped;
+            unsigned long writeFailures;
+            unsigned long rawDropped;           // raw chunks
+            unsigned long maxDepth;
+            unsigned long lastLatency_us;       // from publish to write
+            unsigned long maxLatency_us;
+
+            Sink(const char *name, Format format, DropPolicy dropPolicy, uint8_t queueSize,
+                 bool (*isEnabled)(), bool (*isReady)(size_t), bool (*write)(const char *, size_t),
+                 bool acceptsRaw = false, bool (*writeRaw)(const char *, size_t) = nullptr);
+        };
+
+        /**
+         * Include in your setup before any module registers its sink
+         * */
+        void setup();
+        /**
+         * Include in your main loop, it delivers queued messages to sinks which are ready
+         * */
+        void mainLoop();
+
+        /**
+         * Sink must outlive the bus (static storage), registering twice is harmless
+         * @return false if too many sinks
+         * */
+        bool registerSink(Sink *sink);
+
+        /**
+         * Queues a copy of msg for every enabled sink and delivers it right away where possible
+         * */
+        void publish(const char *msg);
+        /**
+         * Same as publish() for a single sink, ie the answer to a command
+         * @return false if no sink has this name
+         * */
+        bool publishTo(const char *msg, const char *sinkName);
+
+        /**
+         * Appends to the raw output chunk, which is queued at end of line or when full.
+         * buf may live in flash (PSTR/F)
+         * */
+        void publishRaw(const char *buf);
+        void publishRaw(const char *buf, size_t length);
+        /**
+         * Queues the current raw chunk, if any
+         * */
+        void flushRaw();
+
+        /**
+         * @return number of messages waiting for this sink
+         * */
+        unsigned int queueDepth(const Sink *sink);
+
+        /**
+         * @return registered sink at this index, nullptr past the last one
+         * */
+        const Sink *getSink(uint8_t index);
+
+        /**
+         * Delivers everything still queued, even to sinks which are not ready, ie before a reboot
+         * */
+        void flush();
+
+        void getStatusJsonString(JsonObject &output);
+    }
+}
+
+#endif // _17_Output_H_
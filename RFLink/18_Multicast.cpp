@@ -0,0 +1,200 @@
+#include <Arduino.h>
+#include "RFLink.h"
+#include "17_Output.h"
+#include "18_Multicast.h"
+#include "25_Log.h"
+
+#ifdef RFLINK_WIFI_ENABLED
+
+#ifdef ESP8266
+#include <ESP8266WiFi.h>
+#else
+#include <WiFi.h>
+#endif
+#include <WiFiUdp.h>
+
+namespace RFLink {
+    namespace Multicast {
+
+        namespace params {
+            bool enabled = false;
+            IPAddress group;
+            unsigned int port = MULTICAST_DEFAULT_PORT;
+            unsigned int ttl = 1;
+            Format format = Format_Text;
+        }
+
+        namespace counters {
+            unsigned long int sentDatagrams = 0;
+            unsigned long int failedDatagrams = 0;
+        }
+
+        const char *formatNames[] = {
+                "text",
+                "binary",
+                "EOF" // matches Format::Format_EOF
+        };
+        static_assert(sizeof(formatNames) / sizeof(char *) == Format::Format_EOF + 1, "formatNames has missing/extra names, please compare with Format enum declarations");
+
+        // All json variable names
+        const char json_name_enabled[] = "enabled";
+        const char json_name_group[] = "group";
+        const char json_name_port[] = "port";
+        const char json_name_ttl[] = "ttl";
+        const char json_name_format[] = "format";
+
+        enum ConfigItemIndex {
+            ConfigItem_Enabled,
+            ConfigItem_Group,
+            ConfigItem_Port,
+            ConfigItem_Ttl,
+            ConfigItem_Format,
+            ConfigItem_EOF,
+        };
+
+        Config::ConfigItem configItems[] = {
+                Config::ConfigItem(json_name_enabled, Config::SectionId::Multicast_id, false, paramsUpdatedCallback),
+                Config::ConfigItem(json_name_group, Config::SectionId::Multicast_id, MULTICAST_DEFAULT_GROUP, paramsUpdatedCallback),
+                Config::ConfigItem(json_name_port, Config::SectionId::Multicast_id, MULTICAST_DEFAULT_PORT, paramsUpdatedCallback),
+                Config::ConfigItem(json_name_ttl, Config::SectionId::Multicast_id, 1, paramsUpdatedCallback),
+                Config::ConfigItem(json_name_format, Config::SectionId::Multicast_id, formatNames[Format_Text], paramsUpdatedCallback),
+                Config::ConfigItem() // dont remove it!
+        };
+        static_assert(sizeof(configItems) / sizeof(Config::ConfigItem) == ConfigItem_EOF + 1, "configItems has missing/extra items, please compare with ConfigItemIndex enum declarations");
+
+        WiFiUDP udp;
+        uint32_t sequence = 0;
+
+        bool sinkIsEnabled() {
+            return params::enabled;
+        }
+
+        bool sinkIsReady(size_t length) {
+            return WiFi.isConnected();
+        }
+
+        inline void putUint32(uint8_t *buffer, uint32_t value) {
+            buffer[0] = value >> 24;
+            buffer[1] = value >> 16;
+            buffer[2] = value >> 8;
+            buffer[3] = value;
+        }
+
+        bool sinkWrite(const char *msg, size_t length) {
+            // only a datagram that left is numbered, receivers would see a failed one as lost
+            uint32_t number = sequence + 1;
+
+            // strip end of line, both formats add their own trailer
+            while (length > 0 && (msg[length - 1] == '\r' || msg[length - 1] == '\n'))
+                length--;
+
+#ifdef ESP8266
+            if (!udp.beginPacketMulticast(params::group, params::port, WiFi.localIP(), params::ttl)) {
+#else
+            // ESP32 WiFiUDP has no way to set the TTL, the stack default applies and params::ttl is ignored
+            if (!udp.beginPacket(params::group, params::port)) {
+#endif
+                counters::failedDatagrams++;
+                return false;
+            }
+
+            if (params::format == Format_Binary) {
+                uint8_t header[MULTICAST_BINARY_HEADER_SIZE] = {MULTICAST_BINARY_MAGIC_0, MULTICAST_BINARY_MAGIC_1, MULTICAST_BINARY_VERSION, 0};
+                putUint32(header + 4, number);
+                putUint32(header + 8, millis());
+                udp.write(header, sizeof(header));
+
+                // "20;XX;" is redundant with the header
+                const char *payload = msg;
+                for (int separators = 0; separators < 2 && payload != nullptr; separators++) {
+                    payload = (const char *) memchr(payload, ';', length - (payload - msg));
+                    if (payload != nullptr)
+                        payload++;
+                }
+                if (payload == nullptr)
+                    payload = msg;
+                udp.write((const uint8_t *) payload, length - (payload - msg));
+            } else {
+                char trailer[20];
+                udp.write((const uint8_t *) msg, length);
+                snprintf_P(trailer, sizeof(trailer), PSTR("SEQ=%lu;\r\n"), (unsigned long) number);
+                udp.write((const uint8_t *) trailer, strlen(trailer));
+            }
+
+            if (!udp.endPacket()) {
+                counters::failedDatagrams++;
+                return false;
+            }
+            sequence = number;
+            counters::sentDatagrams++;
+            return true;
+        }
+
+        Output::Sink sink("multicast", Output::Format_Line, Output::Drop_Oldest, MULTICAST_QUEUE_SIZE,
+                          sinkIsEnabled, sinkIsReady, sinkWrite);
+
+        Format formatFromString(const char *name) {
+            for (int i = 0; i < Format_EOF; i++) {
+                if (strcmp(formatNames[i], name) == 0)
+                    return (Format) i;
+            }
+            return Format_EOF;
+        }
+
+        void paramsUpdatedCallback() {
+            refreshParametersFromConfig();
+        }
+
+        void refreshParametersFromConfig(bool triggerChanges) {
+            Config::ConfigItem *item;
+
+            item = &configItems[ConfigItem_Enabled];
+            params::enabled = item->getBoolValue();
+
+            item = &configItems[ConfigItem_Group];
+            IPAddress group;
+            if (!group.fromString(item->getCharValue()) || group[0] < 224 || group[0] > 239) {
+                Log::printf(Log::Module_Core, Log::Level_Warning, PSTR("Multicast: '%s' is not a multicast address, falling back to %s"), item->getCharValue(), PSTR(MULTICAST_DEFAULT_GROUP));
+                item->setCharValue(MULTICAST_DEFAULT_GROUP);
+                group.fromString(MULTICAST_DEFAULT_GROUP);
+            }
+            params::group = group;
+
+            item = &configItems[ConfigItem_Port];
+            params::port = item->getLongIntValue();
+
+            item = &configItems[ConfigItem_Ttl];
+            params::ttl = item->getLongIntValue();
+
+            item = &configItems[ConfigItem_Format];
+            Format format = formatFromString(item->getCharValue());
+            if (format == Format_EOF) {
+                Log::printf(Log::Module_Core, Log::Level_Warning, PSTR("Multicast: unsupported format '%s', falling back to '%s'"), item->getCharValue(), formatNames[Format_Text]);
+                format = Format_Text;
+                item->setCharValue(formatNames[format]);
+            }
+            params::format = format;
+        }
+
+        void setup() {
+            refreshParametersFromConfig(false);
+            Output::registerSink(&sink);
+        }
+
+        void getStatusJsonString(JsonObject &output) {
+            auto &&multicast = output.createNestedObject("multicast");
+
+            if (params::enabled)
+                multicast[F("status")] = F("running");
+            else
+                multicast[F("status")] = F("disabled");
+
+            multicast[F("sequence")] = sequence;
+            multicast[F("sent_datagrams")] = counters::sentDatagrams;
+            multicast[F("failed_datagrams")] = counters::failedDatagrams;
+        }
+
+    }
+}
+
+#endif // RFLINK_WIFI_ENABLED
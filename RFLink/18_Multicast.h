@@ -0,0 +1,75 @@
+#ifndef _18_Multicast_H_
+#define _18_Multicast_H_
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "11_Config.h"
+
+#ifdef RFLINK_WIFI_ENABLED
+
+#ifndef MULTICAST_DEFAULT_GROUP
+#define MULTICAST_DEFAULT_GROUP "239.255.43.21"
+#endif
+
+#ifndef MULTICAST_DEFAULT_PORT
+#define MULTICAST_DEFAULT_PORT 43210
+#endif
+
+#ifndef MULTICAST_QUEUE_SIZE
+#define MULTICAST_QUEUE_SIZE 4 // messages waiting for Wifi, older ones are dropped
+#endif
+
+#define MULTICAST_BINARY_MAGIC_0 'R'
+#define MULTICAST_BINARY_MAGIC_1 'F'
+#define MULTICAST_BINARY_VERSION 1
+#define MULTICAST_BINARY_HEADER_SIZE 12
+
+/**
+ * Sends every RFLink message as a single UDP datagram to a multicast group, so any number of
+ * listeners on the LAN get it for the cost of one transmission.
+ *
+ * Each datagram carries a sequence number so receivers can detect loss:
+ *  - text format: the RFLink line with an extra field before end of line, ie "20;2A;NewKaku;ID=...;CMD=ON;SEQ=42;\r\n"
+ *  - binary format: 12 bytes header followed by the message without its "20;XX;" prefix nor end of line
+ *      'R' 'F' | version (1) | reserved (0) | sequence (uint32 big endian) | uptime ms (uint32 big endian)
+ *
+ * The ttl setting is applied on ESP8266 only, ESP32 WiFiUDP does not expose it.
+ * */
+namespace RFLink {
+    namespace Multicast {
+
+        enum Format {
+            Format_Text,
+            Format_Binary,
+            Format_EOF,
+        };
+
+        namespace params {
+            extern bool enabled;
+            extern IPAddress group;
+            extern unsigned int port;
+            extern unsigned int ttl;
+            extern Format format;
+        }
+
+        namespace counters {
+            extern unsigned long int sentDatagrams;
+            extern unsigned long int failedDatagrams;
+        }
+
+        extern Config::ConfigItem configItems[];
+
+        /**
+         * Include in your setup after Output has been initialized
+         * */
+        void setup();
+
+        void paramsUpdatedCallback();
+        void refreshParametersFromConfig(bool triggerChanges=true);
+
+        void getStatusJsonString(JsonObject &output);
+    }
+}
+
+#endif // RFLINK_WIFI_ENABLED
+#endif // _18_Multicast_H_
@@ -0,0 +1,568 @@
+#include <Arduino.h>
+#include "19_MqttClient.h"
+
+#define MQTT_PACKET_CONNECT     0x10
+#define MQTT_PACKET_CONNACK     0x20
+#define MQTT_PACKET_PUBLISH     0x30
+#define MQTT_PACKET_PUBACK      0x40
+#define MQTT_PACKET_SUBSCRIBE   0x82 // reserved flags 0010
+#define MQTT_PACKET_SUBACK      0x90
+#define MQTT_PACKET_PINGREQ     0xC0
+#define MQTT_PACKET_PINGRESP    0xD0
+#define MQTT_PACKET_DISCONNECT  0xE0
+
+#define MQTT_PUBLISH_DUP        0x08
+
+#define MQTT_MAX_PACKETS_PER_LOOP 8 // so a flood of incoming commands cannot starve the main loop
+
+MqttClient::MqttClient() :
+        published(0), acknowledged(0), retransmitted(0), received(0), ackTimeouts(0), maxAckTime_ms(0),
+        client(nullptr), host(), connectHost(), port(1883), callback(nullptr), keepAlive_s(60),
+        state(State_Disconnected), tcpDone(false), tcpResult(false), abortConnect(false), error(0),
+        stateTime(0), lastOutActivity(0), pingTime(0), pingOutstanding(false), nextPacketId(1), connectData(),
+        id(nullptr), user(nullptr), password(nullptr), willTopic(nullptr), willQos(0), willRetain(false),
+        willMessage(nullptr), inflightCount(0), inflightUsed(0) {
+    resetReceiver();
+}
+
+void MqttClient::setClient(Client &client) {
+    this->client = &client;
+}
+
+bool MqttClient::setServer(const char *host, uint16_t port) {
+    if (strlen(host) >= sizeof(this->host)) {
+        this->host[0] = 0;
+        return false;
+    }
+    strcpy(this->host, host);
+    this->port = port;
+    return true;
+}
+
+void MqttClient::setCallback(MessageCallback callback) {
+    this->callback = callback;
+}
+
+void MqttClient::setKeepAlive(uint16_t seconds) {
+    keepAlive_s = seconds;
+}
+
+size_t MqttClient::encodeLength(uint8_t *buffer, uint32_t length) {
+    size_t count = 0;
+    do {
+        uint8_t digit = length % 128;
+        length /= 128;
+        if (length > 0)
+            digit |= 0x80;
+        buffer[count++] = digit;
+    } while (length > 0);
+    return count;
+}
+
+size_t MqttClient::encodeString(uint8_t *buffer, const char *str, size_t length) {
+    buffer[0] = length >> 8;
+    buffer[1] = length;
+    memcpy(buffer + 2, str, length);
+    return length + 2;
+}
+
+size_t MqttClient::publishHeaderSize(size_t topicLength, size_t payloadLength, uint8_t qos) {
+    uint8_t lengthBytes[4];
+    size_t remaining = 2 + topicLength + (qos > 0 ? 2 : 0) + payloadLength;
+    return 1 + encodeLength(lengthBytes, remaining) + 2 + topicLength + (qos > 0 ? 2 : 0);
+}
+
+uint16_t MqttClient::takePacketId() {
+    uint16_t packetId = nextPacketId++;
+    if (nextPacketId == 0)
+        nextPacketId = 1;
+    return packetId;
+}
+
+void MqttClient::resetReceiver() {
+    rxHaveHeader = false;
+    rxLengthDone = false;
+    rxLength = 0;
+    rxReceived = 0;
+    rxLengthMultiplier = 1;
+}
+
+bool MqttClient::writePacket(const uint8_t *buffer, size_t length) {
+    if (client->write(buffer, length) != length) {
+        closeConnection(-1);
+        return false;
+    }
+    lastOutActivity = millis();
+    return true;
+}
+
+void MqttClient::closeConnection(int error) {
+    this->error = error;
+    if (client != nullptr)
+        client->stop();
+    state = State_Disconnected;
+    pingOutstanding = false;
+    resetReceiver();
+    // in-flight messages are kept, they will be sent again once reconnected
+}
+
+#if defined(ESP32)
+void MqttClient::connectTask(void *param) {
+    MqttClient *self = (MqttClient *) param;
+    self->tcpResult = self->client->connect(self->connectHost, self->port) == 1;
+    self->tcpDone = true;
+    vTaskDelete(nullptr);
+}
+#endif
+
+void MqttClient::startConnect() {
+    tcpDone = false;
+    tcpResult = false;
+    abortConnect = false;
+    state = State_Connecting;
+    stateTime = millis();
+    strcpy(connectHost, host);
+
+#if defined(ESP32)
+    // TLS handshake needs a comfortable stack
+    if (xTaskCreate(connectTask, "mqtt_connect", 8192, this, 1, nullptr) == pdPASS)
+        return;
+#endif
+    tcpResult = client->connect(connectHost, port) == 1;
+    tcpDone = true;
+}
+
+/**
+ * Appends str to connectData
+ * @return the copy, str itself if it is nullptr or does not fit (used is then past the end)
+ * */
+const char *MqttClient::copyConnectString(const char *str, size_t &used) {
+    if (str == nullptr || used > sizeof(connectData))
+        return str;
+    size_t length = strlen(str) + 1;
+    if (used + length > sizeof(connectData)) {
+        used = sizeof(connectData) + 1;
+        return str;
+    }
+    char *copy = connectData + used;
+    memcpy(copy, str, length);
+    used += length;
+    return copy;
+}
+
+bool MqttClient::beginConnect(const char *id, const char *user, const char *password,
+                              const char *willTopic, uint8_t willQos, bool willRetain, const char *willMessage) {
+    if (state != State_Disconnected || client == nullptr || host[0] == 0)
+        return false;
+
+    // read by sendConnect() once connected, by then the caller may have replaced its strings
+    size_t used = 0;
+    this->id = copyConnectString(id, used);
+    this->user = copyConnectString(user, used);
+    this->password = copyConnectString(password, used);
+    this->willTopic = copyConnectString(willTopic, used);
+    this->willMessage = copyConnectString(willMessage, used);
+    this->willQos = willQos;
+    this->willRetain = willRetain;
+    if (used > sizeof(connectData)) {
+        this->id = this->user = this->password = this->willTopic = this->willMessage = nullptr;
+        return false;
+    }
+
+    startConnect();
+    return true;
+}
+
+bool MqttClient::sendConnect() {
+    size_t idLength = strlen(id);
+    size_t userLength = user != nullptr ? strlen(user) : 0;
+    size_t passwordLength = password != nullptr ? strlen(password) : 0;
+    bool hasWill = willTopic != nullptr && willMessage != nullptr;
+    size_t willTopicLength = hasWill ? strlen(willTopic) : 0;
+    size_t willMessageLength = hasWill ? strlen(willMessage) : 0;
+
+    size_t remaining = 10 + 2 + idLength;
+    if (hasWill)
+        remaining += 2 + willTopicLength + 2 + willMessageLength;
+    if (userLength > 0)
+        remaining += 2 + userLength;
+    if (userLength > 0 && passwordLength > 0)
+        remaining += 2 + passwordLength;
+
+    // nothing is being received yet, so receive buffer is free
+    if (remaining + 5 > sizeof(rxBuffer))
+        return false;
+
+    uint8_t *p = rxBuffer;
+    uint8_t flags = 0x02; // clean session
+    if (hasWill)
+        flags |= 0x04 | (willQos & 0x03) << 3 | (willRetain ? 0x20 : 0);
+    if (userLength > 0) {
+        flags |= 0x80;
+        if (passwordLength > 0)
+            flags |= 0x40;
+    }
+
+    *p++ = MQTT_PACKET_CONNECT;
+    p += encodeLength(p, remaining);
+    p += encodeString(p, "MQTT", 4);
+    *p++ = 4; // protocol level 3.1.1
+    *p++ = flags;
+    *p++ = keepAlive_s >> 8;
+    *p++ = keepAlive_s;
+    p += encodeString(p, id, idLength);
+    if (hasWill) {
+        p += encodeString(p, willTopic, willTopicLength);
+        p += encodeString(p, willMessage, willMessageLength);
+    }
+    if (userLength > 0) {
+        p += encodeString(p, user, userLength);
+        if (passwordLength > 0)
+            p += encodeString(p, password, passwordLength);
+    }
+
+    return writePacket(rxBuffer, p - rxBuffer);
+}
+
+void MqttClient::onConnected() {
+    state = State_Connected;
+    error = 0;
+    resendInFlight();
+}
+
+void MqttClient::resendInFlight() {
+    unsigned long now = millis();
+    for (uint8_t i = 0; i < inflightCount; i++) {
+        InFlight &msg = inflight[i];
+        if (msg.acked)
+            continue;
+        inflightBuffer[msg.offset] |= MQTT_PUBLISH_DUP;
+        if (!writePacket(inflightBuffer + msg.offset, msg.length))
+            return;
+        msg.sentTime = now;
+        retransmitted++;
+    }
+}
+
+void MqttClient::releaseAcked(uint16_t packetId) {
+    unsigned long now = millis();
+    for (uint8_t i = 0; i < inflightCount; i++) {
+        if (inflight[i].packetId == packetId && !inflight[i].acked) {
+            inflight[i].acked = true;
+            acknowledged++;
+            if (now - inflight[i].sentTime > maxAckTime_ms)
+                maxAckTime_ms = now - inflight[i].sentTime;
+            break;
+        }
+    }
+
+    // brokers acknowledge in order, so this usually frees everything that was acked
+    uint8_t released = 0;
+    size_t releasedBytes = 0;
+    while (released < inflightCount && inflight[released].acked) {
+        releasedBytes += inflight[released].length;
+        released++;
+    }
+    if (released == 0)
+        return;
+
+    memmove(inflightBuffer, inflightBuffer + releasedBytes, inflightUsed - releasedBytes);
+    inflightUsed -= releasedBytes;
+    inflightCount -= released;
+    for (uint8_t i = 0; i < inflightCount; i++) {
+        inflight[i] = inflight[i + released];
+        inflight[i].offset -= releasedBytes;
+    }
+}
+
+void MqttClient::handlePacket() {
+    switch (rxHeader & 0xF0) {
+        case MQTT_PACKET_CONNACK:
+            if (state != State_WaitingConnAck)
+                break;
+            if (rxLength >= 2 && rxBuffer[1] == 0)
+                onConnected();
+            else
+                closeConnection(rxLength >= 2 ? rxBuffer[1] : -1);
+            break;
+
+        case MQTT_PACKET_PUBLISH: {
+            uint8_t qos = (rxHeader >> 1) & 0x03;
+            size_t topicLength = (rxBuffer[0] << 8) | rxBuffer[1];
+            size_t position = 2 + topicLength;
+            uint16_t packetId = 0;
+
+            if (position + (qos > 0 ? 2 : 0) > rxLength)
+                break;
+            if (qos > 0) {
+                packetId = (rxBuffer[position] << 8) | rxBuffer[position + 1];
+                position += 2;
+            }
+
+            // topic is moved over its length so it can be null terminated in place
+            memmove(rxBuffer, rxBuffer + 2, topicLength);
+            rxBuffer[topicLength] = 0;
+            received++;
+            if (callback != nullptr)
+                callback((char *) rxBuffer, rxBuffer + position, rxLength - position); // rxBuffer has room for a terminator
+
+            if (qos == 1 && state == State_Connected) {
+                uint8_t ack[4] = {MQTT_PACKET_PUBACK, 2, (uint8_t) (packetId >> 8), (uint8_t) packetId};
+                writePacket(ack, sizeof(ack));
+            }
+            break;
+        }
+
+        case MQTT_PACKET_PUBACK:
+            if (rxLength >= 2)
+                releaseAcked((rxBuffer[0] << 8) | rxBuffer[1]);
+            break;
+
+        case MQTT_PACKET_PINGRESP:
+            pingOutstanding = false;
+            break;
+
+        default: // SUBACK and anything we do not care about
+            break;
+    }
+}
+
+/**
+ * A QoS 1 PUBLISH too large for rxBuffer is dropped, it must still be acknowledged or the broker sends it forever
+ * */
+void MqttClient::acknowledgeDiscarded() {
+    if ((rxHeader & 0xF0) != MQTT_PACKET_PUBLISH || ((rxHeader >> 1) & 0x03) != 1 || state != State_Connected)
+        return;
+
+    size_t topicLength = (rxBuffer[0] << 8) | rxBuffer[1];
+    size_t position = 2 + topicLength;
+    if (position + 2 > MQTT_CLIENT_RX_BUFFER_SIZE) // packet id is not in what we kept
+        return;
+
+    uint8_t ack[4] = {MQTT_PACKET_PUBACK, 2, rxBuffer[position], rxBuffer[position + 1]};
+    writePacket(ack, sizeof(ack));
+}
+
+void MqttClient::readPackets() {
+    uint8_t packets = 0;
+    int available;
+
+    while (packets < MQTT_MAX_PACKETS_PER_LOOP && (state == State_WaitingConnAck || state == State_Connected) &&
+           (available = client->available()) > 0) {
+
+        if (!rxHaveHeader) {
+            rxHeader = client->read();
+            rxHaveHeader = true;
+            continue;
+        }
+
+        if (!rxLengthDone) {
+            uint8_t digit = client->read();
+            rxLength += (digit & 0x7F) * rxLengthMultiplier;
+            rxLengthMultiplier *= 128;
+            if (digit & 0x80) {
+                if (rxLengthMultiplier > 128UL * 128 * 128) {
+                    closeConnection(-1); // malformed remaining length
+                    return;
+                }
+                continue;
+            }
+            rxLengthDone = true;
+        } else {
+            size_t count = rxLength - rxReceived;
+            if (count > (size_t) available)
+                count = available;
+
+            if (rxReceived < MQTT_CLIENT_RX_BUFFER_SIZE) {
+                if (count > MQTT_CLIENT_RX_BUFFER_SIZE - rxReceived)
+                    count = MQTT_CLIENT_RX_BUFFER_SIZE - rxReceived;
+                count = client->read(rxBuffer + rxReceived, count);
+            } else {
+                uint8_t discard[32]; // packet too large for us, skip the rest of it
+                if (count > sizeof(discard))
+                    count = sizeof(discard);
+                count = client->read(discard, count);
+            }
+
+            if ((int) count <= 0)
+                return;
+            rxReceived += count;
+        }
+
+        if (rxReceived == rxLength) {
+            if (rxLength <= MQTT_CLIENT_RX_BUFFER_SIZE)
+                handlePacket();
+            else
+                acknowledgeDiscarded();
+            resetReceiver();
+            packets++;
+        }
+    }
+}
+
+void MqttClient::checkTimeouts() {
+    unsigned long now = millis();
+
+    if (state == State_WaitingConnAck) {
+        if (now - stateTime > MQTT_CONNECT_TIMEOUT_MS)
+            closeConnection(-2);
+        return;
+    }
+
+    if (inflightCount > 0 && now - inflight[0].sentTime > MQTT_ACK_TIMEOUT_MS) {
+        ackTimeouts++;
+        closeConnection(-2);
+        return;
+    }
+
+    if (pingOutstanding) {
+        if (now - pingTime > keepAlive_s * 1000UL)
+            closeConnection(-2);
+    } else if (now - lastOutActivity >= keepAlive_s * 1000UL) {
+        uint8_t ping[2] = {MQTT_PACKET_PINGREQ, 0};
+        if (writePacket(ping, sizeof(ping))) {
+            pingOutstanding = true;
+            pingTime = now;
+        }
+    }
+}
+
+void MqttClient::loop() {
+    if (state == State_Disconnected)
+        return;
+
+    if (state == State_Connecting) {
+        if (!tcpDone)
+            return;
+        if (abortConnect || !tcpResult) {
+            closeConnection(-1);
+            return;
+        }
+        state = State_WaitingConnAck;
+        stateTime = millis();
+        resetReceiver();
+        if (!sendConnect())
+            closeConnection(-1);
+        return;
+    }
+
+    if (!client->connected()) {
+        closeConnection(-1);
+        return;
+    }
+
+    readPackets();
+    if (state != State_Disconnected)
+        checkTimeouts();
+}
+
+void MqttClient::disconnect() {
+    if (state == State_Connecting && !tcpDone) {
+        abortConnect = true; // connect task still owns the client, loop() will close it
+        return;
+    }
+
+    if (state == State_Connected) {
+        uint8_t packet[2] = {MQTT_PACKET_DISCONNECT, 0};
+        client->write(packet, sizeof(packet));
+    }
+    if (state != State_Disconnected)
+        closeConnection(0);
+}
+
+bool MqttClient::canPublish(size_t topicLength, size_t payloadLength) const {
+    return state == State_Connected && inflightCount < MQTT_INFLIGHT_WINDOW &&
+           inflightUsed + publishHeaderSize(topicLength, payloadLength, 1) + payloadLength <= sizeof(inflightBuffer);
+}
+
+bool MqttClient::publish(const char *topic, const uint8_t *payload, size_t length, bool retained, uint8_t qos) {
+    if (state != State_Connected)
+        return false;
+
+    size_t topicLength = strlen(topic);
+    size_t headerSize = publishHeaderSize(topicLength, length, qos);
+    size_t packetSize = headerSize + length;
+    uint16_t packetId = 0;
+
+    if (qos > 0) {
+        if (!canPublish(topicLength, length))
+            return false;
+        qos = 1;
+        packetId = takePacketId();
+    }
+
+    // packet is assembled in the free part of the in-flight buffer, so it goes out in one write.
+    // canPublish() made sure it fits for QoS 1
+    bool assembled = inflightUsed + packetSize <= sizeof(inflightBuffer);
+    uint8_t *p = inflightBuffer + inflightUsed;
+
+    if (assembled) {
+        *p++ = MQTT_PACKET_PUBLISH | qos << 1 | (retained ? 1 : 0);
+        p += encodeLength(p, 2 + topicLength + (qos > 0 ? 2 : 0) + length);
+        p += encodeString(p, topic, topicLength);
+        if (qos > 0) {
+            *p++ = packetId >> 8;
+            *p++ = packetId;
+        }
+        memcpy(p, payload, length);
+    }
+
+    if (qos > 0) {
+        InFlight &msg = inflight[inflightCount++];
+        msg.packetId = packetId;
+        msg.offset = inflightUsed;
+        msg.length = packetSize;
+        msg.acked = false;
+        msg.sentTime = millis();
+        inflightUsed += packetSize;
+        // even if the socket fails now, it is sent again after reconnection
+        writePacket(inflightBuffer + msg.offset, msg.length);
+        published++;
+        return true;
+    }
+
+    bool success;
+    if (assembled) {
+        success = writePacket(inflightBuffer + inflightUsed, packetSize);
+    } else {
+        uint8_t topicHeader[2] = {(uint8_t) (topicLength >> 8), (uint8_t) topicLength};
+        uint8_t fixedHeader[5];
+        size_t fixedHeaderLength = 1;
+        fixedHeader[0] = MQTT_PACKET_PUBLISH | (retained ? 1 : 0);
+        fixedHeaderLength += encodeLength(fixedHeader + 1, 2 + topicLength + length);
+        success = writePacket(fixedHeader, fixedHeaderLength) &&
+                  writePacket(topicHeader, sizeof(topicHeader)) &&
+                  writePacket((const uint8_t *) topic, topicLength) &&
+                  writePacket(payload, length);
+    }
+
+    if (success)
+        published++;
+    return success;
+}
+
+bool MqttClient::publish(const char *topic, const char *payload, bool retained, uint8_t qos) {
+    return publish(topic, (const uint8_t *) payload, strlen(payload), retained, qos);
+}
+
+bool MqttClient::subscribe(const char *topic, uint8_t qos) {
+    if (state != State_Connected)
+        return false;
+
+    size_t topicLength = strlen(topic);
+    uint16_t packetId = takePacketId();
+    uint8_t header[9];
+    size_t headerLength = 0;
+
+    header[headerLength++] = MQTT_PACKET_SUBSCRIBE;
+    headerLength += encodeLength(header + headerLength, 2 + 2 + topicLength + 1);
+    header[headerLength++] = packetId >> 8;
+    header[headerLength++] = packetId;
+    header[headerLength++] = topicLength >> 8;
+    header[headerLength++] = topicLength;
+
+    uint8_t requestedQos = qos > 1 ? 1 : qos; // we never handle QoS 2 deliveries
+    return writePacket(header, headerLength) &&
+           writePacket((const uint8_t *) topic, topicLength) &&
+           writePacket(&requestedQos, 1);
+}
@@ -0,0 +1,193 @@
+#ifndef _19_MqttClient_H_
+#define _19_MqttClient_H_
+
+#include <Arduino.h>
+#include <Client.h>
+
+#ifndef MQTT_CLIENT_RX_BUFFER_SIZE
+#define MQTT_CLIENT_RX_BUFFER_SIZE 1024 // largest incoming packet, 10;batch; commands must fit in it
+#endif
+
+#ifndef MQTT_CLIENT_HOST_SIZE
+#define MQTT_CLIENT_HOST_SIZE 64 // longer host names are refused
+#endif
+
+#ifndef MQTT_CLIENT_CONNECT_DATA_SIZE
+#define MQTT_CLIENT_CONNECT_DATA_SIZE 256 // client ID, user, password and will, each with its terminator
+#endif
+
+#ifndef MQTT_INFLIGHT_WINDOW
+#if defined(ESP32)
+#define MQTT_INFLIGHT_WINDOW 8 // QoS 1 messages sent but not acknowledged yet
+#else
+#define MQTT_INFLIGHT_WINDOW 4
+#endif
+#endif
+
+#ifndef MQTT_INFLIGHT_BUFFER_SIZE
+#if defined(ESP32)
+#define MQTT_INFLIGHT_BUFFER_SIZE 2048 // encoded QoS 1 packets kept for retransmission
+#else
+#define MQTT_INFLIGHT_BUFFER_SIZE 768
+#endif
+#endif
+
+#ifndef MQTT_CONNECT_TIMEOUT_MS
+#define MQTT_CONNECT_TIMEOUT_MS 5000 // from TCP established to CONNACK
+#endif
+
+#ifndef MQTT_ACK_TIMEOUT_MS
+#define MQTT_ACK_TIMEOUT_MS 10000 // connection is considered dead if a PUBACK takes longer
+#endif
+
+/**
+ * Minimal MQTT 3.1.1 client which never waits for the broker:
+ * - on ESP32 the TCP/TLS connection is opened by a short lived task, the main loop keeps running
+ *   (on ESP8266 the TCP connect still blocks, and so does the TLS handshake, for seconds, when the client is secure)
+ * - CONNACK, SUBACK, PUBACK and incoming PUBLISH are handled by loop() as bytes arrive
+ * - QoS 1 publishes are pipelined, up to MQTT_INFLIGHT_WINDOW of them wait for their PUBACK at the same time.
+ *   Unacknowledged ones are sent again with DUP flag after a reconnection, so they are delivered at least once.
+ *
+ * The underlying Client (WiFiClient, WiFiClientSecure) is only used from the main loop once connected.
+ * */
+class MqttClient {
+public:
+    enum State {
+        State_Disconnected,
+        State_Connecting,      // TCP/TLS connection in progress
+        State_WaitingConnAck,
+        State_Connected,
+    };
+
+    typedef void (*MessageCallback)(char *topic, uint8_t *payload, unsigned int length);
+
+    MqttClient();
+
+    void setClient(Client &client);
+    /**
+     * host is copied, it is used by the connect task after the caller may have changed its own copy
+     * @return false if host is too long
+     * */
+    bool setServer(const char *host, uint16_t port);
+    void setCallback(MessageCallback callback);
+    void setKeepAlive(uint16_t seconds);
+
+    /**
+     * Starts connecting, progress is made by loop(). Strings are copied, the caller may change its own right away.
+     * @return false if a connection is already in progress, could not be started or strings are too long
+     * */
+    bool beginConnect(const char *id, const char *user, const char *password,
+                      const char *willTopic = nullptr, uint8_t willQos = 0, bool willRetain = false,
+                      const char *willMessage = nullptr);
+
+    /**
+     * Call every loop iteration, never blocks
+     * */
+    void loop();
+
+    void disconnect();
+
+    bool connected() const { return state == State_Connected; }
+    State getState() const { return state; }
+    /**
+     * @return return code of last CONNACK, or -1 (network), -2 (timeout)
+     * */
+    int lastError() const { return error; }
+
+    /**
+     * @return true if a QoS 1 publish of this size would be accepted right now
+     * */
+    bool canPublish(size_t topicLength, size_t payloadLength) const;
+
+    /**
+     * QoS 0 publishes are written right away, QoS 1 ones also take a slot of the in-flight window.
+     * @return false if not connected, window is full or the socket did not take the packet
+     * */
+    bool publish(const char *topic, const uint8_t *payload, size_t length, bool retained = false, uint8_t qos = 0);
+    bool publish(const char *topic, const char *payload, bool retained = false, uint8_t qos = 0);
+
+    bool subscribe(const char *topic, uint8_t qos = 0);
+
+    uint8_t inFlight() const { return inflightCount; }
+
+    // statistics
+    unsigned long published;
+    unsigned long acknowledged;
+    unsigned long retransmitted;
+    unsigned long received;
+    unsigned long ackTimeouts;
+    unsigned long maxAckTime_ms;
+
+private:
+    struct InFlight {
+        uint16_t packetId;
+        uint16_t offset;   // in inflightBuffer
+        uint16_t length;
+        bool acked;
+        unsigned long sentTime;
+    };
+
+    Client *client;
+    char host[MQTT_CLIENT_HOST_SIZE];        // empty until setServer()
+    char connectHost[MQTT_CLIENT_HOST_SIZE]; // what the connect task reads, copied when it starts
+    uint16_t port;
+    MessageCallback callback;
+    uint16_t keepAlive_s;
+
+    volatile State state;
+    volatile bool tcpDone;    // set by connect task
+    volatile bool tcpResult;
+    bool abortConnect;        // disconnect() was called while connect task was running
+    int error;
+    unsigned long stateTime;
+    unsigned long lastOutActivity;
+    unsigned long pingTime;
+    bool pingOutstanding;
+    uint16_t nextPacketId;
+
+    // point into connectData, or nullptr
+    char connectData[MQTT_CLIENT_CONNECT_DATA_SIZE];
+    const char *id;
+    const char *user;
+    const char *password;
+    const char *willTopic;
+    uint8_t willQos;
+    bool willRetain;
+    const char *willMessage;
+
+    // packet being received
+    uint8_t rxBuffer[MQTT_CLIENT_RX_BUFFER_SIZE + 1];
+    uint8_t rxHeader;
+    uint32_t rxLength;        // remaining length announced by the fixed header
+    uint32_t rxReceived;
+    uint32_t rxLengthMultiplier;
+    bool rxHaveHeader;
+    bool rxLengthDone;
+
+    InFlight inflight[MQTT_INFLIGHT_WINDOW];
+    uint8_t inflightCount;
+    uint8_t inflightBuffer[MQTT_INFLIGHT_BUFFER_SIZE];
+    size_t inflightUsed;
+
+    static void connectTask(void *param);
+    const char *copyConnectString(const char *str, size_t &used);
+    void startConnect();
+    bool sendConnect();
+    void onConnected();
+    void resendInFlight();
+    void releaseAcked(uint16_t packetId);
+    void readPackets();
+    void checkTimeouts();
+    void handlePacket();
+    void acknowledgeDiscarded();
+    void resetReceiver();
+    void closeConnection(int error);
+    bool writePacket(const uint8_t *buffer, size_t length);
+    uint16_t takePacketId();
+
+    static size_t encodeLength(uint8_t *buffer, uint32_t length);
+    static size_t encodeString(uint8_t *buffer, const char *str, size_t length);
+    static size_t publishHeaderSize(size_t topicLength, size_t payloadLength, uint8_t qos);
+};
+
+#endif // _19_MqttClient_H_
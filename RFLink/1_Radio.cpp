@@ -10,6 +10,7 @@
 #include "1_Radio.h"
 #include "4_Display.h"
 #include "2_Signal.h"
+#include "25_Log.h"
 
 
 
@@ -59,6 +60,17 @@ namespace RFLink { namespace Radio  {
 
 static_assert(sizeof(hardwareNames)/sizeof(char *) == HardwareType::HW_EOF_t+1, "hardwareNames has missing/extra names, please compare with HardwareType enum declarations");
 
+// TX->RX->TX switching time for each HardwareType, generic one pays TRANSMITTER_STABLE_DELAY_US in disableTX, enableRX and enableTX
+const unsigned long turnaroundTimes_us[] = {
+    3 * TRANSMITTER_STABLE_DELAY_US,
+    1000,
+    1000,
+    1000,
+    0 // EOF
+};
+
+static_assert(sizeof(turnaroundTimes_us)/sizeof(unsigned long) == HardwareType::HW_EOF_t+1, "turnaroundTimes_us has missing/extra values, please compare with HardwareType enum declarations");
+
 // All json variable names
 const char json_name_hardware[] = "hardware";
 
@@ -76,6 +88,22 @@ const char json_name_tx_pmos[] =  "tx_pmos";
 const char json_name_tx_gnd[] =   "tx_gnd";
 
 
+enum ConfigItemIndex {
+  ConfigItem_Hardware,
+  ConfigItem_RxData,
+  ConfigItem_RxVcc,
+  ConfigItem_RxNmos,
+  ConfigItem_RxPmos,
+  ConfigItem_RxGnd,
+  ConfigItem_RxNa,
+  ConfigItem_TxData,
+  ConfigItem_TxVcc,
+  ConfigItem_TxNmos,
+  ConfigItem_TxPmos,
+  ConfigItem_TxGnd,
+  ConfigItem_EOF,
+};
+
 Config::ConfigItem configItems[] =  {
   Config::ConfigItem(json_name_hardware,  Config::SectionId::Radio_id, hardwareNames[HardwareType::HW_basic_t], paramsUpdatedCallback),
 
@@ -95,6 +123,7 @@ Config::ConfigItem configItems[] =  {
   
   Config::ConfigItem()
 };
+static_assert(sizeof(configItems) / sizeof(Config::ConfigItem) == ConfigItem_EOF + 1, "configItems has missing/extra items, please compare with ConfigItemIndex enum declarations");
 
 void refreshParametersFromConfig() {
   States savedState = current_State;
@@ -108,11 +137,11 @@ void refreshParametersFromConfig() {
   Config::ConfigItem *item;
   bool changesDetected = false;
 
-  item = Config::findConfigItem(json_name_hardware, Config::SectionId::Radio_id);
+  item = &configItems[ConfigItem_Hardware];
   if( strcmp(hardwareNames[hardware], item->getCharValue()) != 0) {
     auto new_hardware_id =  hardwareIDFromString(item->getCharValue());
     if( new_hardware_id == HardwareType::HW_EOF_t ) {
-      Serial.printf_P(PSTR("Unsupported radio hardware name '%s' was provided, falling to default generic receiver!"), item->getCharValue());
+      Log::printf(Log::Module_Radio, Log::Level_Warning, PSTR("Unsupported radio hardware name '%s' was provided, falling to default generic receiver!"), item->getCharValue());
       changesDetected = true;
       hardware = HardwareType::HW_basic_t;
       item->setCharValue(hardwareNames[hardware]);
@@ -124,37 +153,37 @@ void refreshParametersFromConfig() {
       }
   }
 
-  item = Config::findConfigItem(json_name_rx_data, Config::SectionId::Radio_id);
+  item = &configItems[ConfigItem_RxData];
   if( pins::RX_DATA != item->getLongIntValue() ) {
     changesDetected = true;
     pins::RX_DATA = item->getLongIntValue();
   }
 
-  item = Config::findConfigItem(json_name_rx_vcc, Config::SectionId::Radio_id);
+  item = &configItems[ConfigItem_RxVcc];
   if( pins::RX_VCC != item->getLongIntValue() ) {
     changesDetected = true;
     pins::RX_VCC = item->getLongIntValue();
   }
 
-  item = Config::findConfigItem(json_name_rx_nmos, Config::SectionId::Radio_id);
+  item = &configItems[ConfigItem_RxNmos];
   if( pins::RX_NMOS != item->getLongIntValue() ) {
     changesDetected = true;
     pins::RX_NMOS = item->getLongIntValue();
   }
 
-  item = Config::findConfigItem(json_name_rx_pmos, Config::SectionId::Radio_id);
+  item = &configItems[ConfigItem_RxPmos];
   if( pins::RX_PMOS != item->getLongIntValue() ) {
     changesDetected = true;
     pins::RX_PMOS = item->getLongIntValue();
   }
 
-  item = Config::findConfigItem(json_name_rx_gnd, Config::SectionId::Radio_id);
+  item = &configItems[ConfigItem_RxGnd];
   if( pins::RX_GND != item->getLongIntValue() ) {
     changesDetected = true;
     pins::RX_GND = item->getLongIntValue();
   }
 
-  item = Config::findConfigItem(json_name_rx_na, Config::SectionId::Radio_id);
+  item = &configItems[ConfigItem_RxNa];
   if( pins::RX_NA != item->getLongIntValue() ) {
     changesDetected = true;
     pins::RX_NA = item->getLongIntValue();
@@ -163,31 +192,31 @@ void refreshParametersFromConfig() {
 
   // TX
 
-  item = Config::findConfigItem(json_name_tx_data, Config::SectionId::Radio_id);
+  item = &configItems[ConfigItem_TxData];
   if( pins::TX_DATA != item->getLongIntValue() ) {
     changesDetected = true;
     pins::TX_DATA = item->getLongIntValue();
   }
 
-  item = Config::findConfigItem(json_name_tx_vcc, Config::SectionId::Radio_id);
+  item = &configItems[ConfigItem_TxVcc];
   if( pins::TX_VCC != item->getLongIntValue() ) {
     changesDetected = true;
     pins::TX_VCC = item->getLongIntValue();
   }
 
-  item = Config::findConfigItem(json_name_tx_nmos, Config::SectionId::Radio_id);
+  item = &configItems[ConfigItem_TxNmos];
   if( pins::TX_NMOS != item->getLongIntValue() ) {
     changesDetected = true;
     pins::TX_NMOS = item->getLongIntValue();
   }
 
-  item = Config::findConfigItem(json_name_tx_pmos, Config::SectionId::Radio_id);
+  item = &configItems[ConfigItem_TxPmos];
   if( pins::TX_PMOS != item->getLongIntValue() ) {
     changesDetected = true;
     pins::TX_PMOS = item->getLongIntValue();
   }
 
-  item = Config::findConfigItem(json_name_tx_gnd, Config::SectionId::Radio_id);
+  item = &configItems[ConfigItem_TxGnd];
   if( pins::TX_GND != item->getLongIntValue() ) {
     changesDetected = true;
     pins::TX_GND = item->getLongIntValue();
@@ -331,6 +360,10 @@ void setup() {
   refreshParametersFromConfig();
 }
 
+unsigned long getTurnaroundTime_us() {
+  return turnaroundTimes_us[hardware];
+}
+
 void enableRX_generic()
 {
   // RX pins
@@ -139,6 +139,11 @@ namespace RFLink { namespace Radio {
     void set_Radio_mode(States new_state);
     void show_Radio_Pin();
 
+    /**
+     * Time needed by current hardware to go from TX to RX and back to TX, in microseconds
+     * */
+    unsigned long getTurnaroundTime_us();
+
     /**
      * don't use directly unless you know what you are doing.
      * */
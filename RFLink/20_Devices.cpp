@@ -0,0 +1,537 @@
+#include <Arduino.h>
+#include "RFLink.h"
+#include "4_Display.h"
+#include "20_Devices.h"
+#include "25_Log.h"
+#if defined(RFLINK_WIFI_ENABLED) && !defined(RFLINK_MQTT_DISABLED)
+#include "6_MQTT.h"
+#endif
+
+namespace RFLink {
+    namespace Devices {
+
+        namespace params {
+            bool enabled = true;
+            unsigned int maxEntries = DEVICES_MAX_ENTRIES;
+            bool mqttRetained = false;
+
+            bool changeOnly = false;
+            unsigned long maxSilence_ms = 300000;
+            Deadband deadbands[DEVICES_MAX_DEADBANDS];
+            uint8_t deadbandsCount = 0;
+        }
+
+        namespace counters {
+            unsigned long int updates = 0;
+            unsigned long int inserts = 0;
+            unsigned long int evictions = 0;
+            unsigned long int retainedPublished = 0;
+            unsigned long int retainedFailed = 0;
+            unsigned long int suppressed = 0;
+        }
+
+        // All json variable names
+        const char json_name_enabled[] = "enabled";
+        const char json_name_max_entries[] = "max_entries";
+        const char json_name_mqtt_retained[] = "mqtt_retained";
+        const char json_name_change_only[] = "change_only";
+        const char json_name_max_silence[] = "max_silence";
+        const char json_name_deadbands[] = "deadbands";
+
+        enum ConfigItemIndex {
+            ConfigItem_Enabled,
+            ConfigItem_MaxEntries,
+            ConfigItem_MqttRetained,
+            ConfigItem_ChangeOnly,
+            ConfigItem_MaxSilence,
+            ConfigItem_Deadbands,
+            ConfigItem_EOF,
+        };
+
+        Config::ConfigItem configItems[] = {
+                Config::ConfigItem(json_name_enabled, Config::SectionId::Devices_id, true, paramsUpdatedCallback),
+                Config::ConfigItem(json_name_max_entries, Config::SectionId::Devices_id, DEVICES_MAX_ENTRIES, paramsUpdatedCallback),
+                Config::ConfigItem(json_name_mqtt_retained, Config::SectionId::Devices_id, false, paramsUpdatedCallback),
+                Config::ConfigItem(json_name_change_only, Config::SectionId::Devices_id, false, paramsUpdatedCallback),
+                Config::ConfigItem(json_name_max_silence, Config::SectionId::Devices_id, 300, paramsUpdatedCallback),
+                Config::ConfigItem(json_name_deadbands, Config::SectionId::Devices_id, DEVICES_DEFAULT_DEADBANDS, paramsUpdatedCallback),
+                Config::ConfigItem() // dont remove it!
+        };
+        static_assert(sizeof(configItems) / sizeof(Config::ConfigItem) == ConfigItem_EOF + 1, "configItems has missing/extra items, please compare with ConfigItemIndex enum declarations");
+
+        Device table[DEVICES_TABLE_SIZE];
+        unsigned int count = 0;
+        bool replaying = false; // our own replayed messages must not count as received
+
+        inline bool isFree(const Device &device) {
+            return device.body[0] == 0;
+        }
+
+        // FNV-1a
+        uint32_t hashKey(const char *key, size_t length) {
+            uint32_t hash = 2166136261UL;
+            for (size_t i = 0; i < length; i++) {
+                hash ^= (uint8_t) key[i];
+                hash *= 16777619UL;
+            }
+            return hash;
+        }
+
+        bool parseMessage(const char *msg, const char *&body, size_t &bodyLength, size_t &keyLength) {
+            if (strncmp(msg, "20;", 3) != 0 || strlen(msg) < 6 || msg[5] != ';')
+                return false;
+            body = msg + 6;
+
+            const char *nameEnd = strchr(body, ';');
+            if (nameEnd == nullptr || strncmp(nameEnd, ";ID=", 4) != 0)
+                return false;
+            if (nameEnd - body == 5 && strncmp(body, "BATCH", 5) == 0)
+                return false;
+
+            bodyLength = strlen(body);
+            while (bodyLength > 0 && (body[bodyLength - 1] == '\r' || body[bodyLength - 1] == '\n' || body[bodyLength - 1] == ';'))
+                bodyLength--;
+
+            const char *keyEnd = strchr(nameEnd + 4, ';');
+            if (keyEnd != nullptr && strncmp(keyEnd, ";SWITCH=", 8) == 0)
+                keyEnd = strchr(keyEnd + 8, ';');
+            if (keyEnd == nullptr || keyEnd > body + bodyLength)
+                keyEnd = body + bodyLength;
+            keyLength = keyEnd - body;
+
+            return bodyLength < DEVICES_BODY_SIZE;
+        }
+
+        /**
+         * @return slot holding this key, or first free slot of its probe sequence
+         * */
+        unsigned int findSlot(const char *key, size_t keyLength, uint32_t hash) {
+            unsigned int slot = hash & (DEVICES_TABLE_SIZE - 1);
+            while (!isFree(table[slot])) {
+                const Device &device = table[slot];
+                if (device.hash == hash && device.keyLength == keyLength && strncmp(device.body, key, keyLength) == 0)
+                    break;
+                slot = (slot + 1) & (DEVICES_TABLE_SIZE - 1);
+            }
+            return slot;
+        }
+
+        /**
+         * Backward shift deletion, keeps probe sequences intact without tombstones
+         * */
+        void removeAt(unsigned int slot) {
+            unsigned int next = slot;
+            while (true) {
+                next = (next + 1) & (DEVICES_TABLE_SIZE - 1);
+                if (isFree(table[next]))
+                    break;
+                unsigned int home = table[next].hash & (DEVICES_TABLE_SIZE - 1);
+                // move it back only if its home is not between the hole and its current place
+                bool between = slot <= next ? (slot < home && home <= next) : (slot < home || home <= next);
+                if (between)
+                    continue;
+                table[slot] = table[next];
+                slot = next;
+            }
+            table[slot].body[0] = 0;
+            count--;
+        }
+
+        void evictLeastRecentlyUsed() {
+            unsigned long now = millis();
+            unsigned int oldest = DEVICES_TABLE_SIZE;
+            for (unsigned int i = 0; i < DEVICES_TABLE_SIZE; i++) {
+                if (isFree(table[i]))
+                    continue;
+                if (oldest == DEVICES_TABLE_SIZE || now - table[i].lastSeen > now - table[oldest].lastSeen)
+                    oldest = i;
+            }
+            if (oldest != DEVICES_TABLE_SIZE) {
+                removeAt(oldest);
+                counters::evictions++;
+            }
+        }
+
+        void clear() {
+            for (auto &device : table)
+                device.body[0] = 0;
+            count = 0;
+        }
+
+        void publishRetained(const Device &device) {
+#if defined(RFLINK_WIFI_ENABLED) && !defined(RFLINK_MQTT_DISABLED)
+            // <topic_out>/devices/<Name>/<ID>[/<SWITCH>]
+            char subTopic[DEVICES_BODY_SIZE + 8];
+            size_t length = 0;
+            length += snprintf_P(subTopic, sizeof(subTopic), PSTR("devices/"));
+            for (size_t i = 0; i < device.keyLength && length < sizeof(subTopic) - 1; i++) {
+                char c = device.body[i];
+                if (c == ';') {
+                    c = '/';
+                    // skip "ID=" and "SWITCH="
+                    const char *equal = strchr(device.body + i, '=');
+                    if (equal != nullptr && equal < device.body + device.keyLength)
+                        i = equal - device.body;
+                }
+                subTopic[length++] = c;
+            }
+            subTopic[length] = 0;
+
+            if (Mqtt::publishRetained(subTopic, device.body))
+                counters::retainedPublished++;
+            else
+                counters::retainedFailed++;
+#endif
+        }
+
+        struct FieldFormat {
+            const char *name;
+            bool decimal;   // else hexadecimal
+            bool signBit;   // 0x8000 means negative
+            uint8_t divider;
+        };
+
+        // how 4_Display.cpp prints measurements, anything else is compared as text
+        const FieldFormat fieldFormats[] = {
+                {"TEMP",     false, true,  10},
+                {"WINCHL",   false, true,  10},
+                {"WINTMP",   false, true,  10},
+                {"RAIN",     false, false, 10},
+                {"RAINRATE", false, false, 10},
+                {"WINSP",    false, false, 10},
+                {"AWINSP",   false, false, 10},
+                {"WINGS",    false, false, 10},
+                {"BARO",     false, false, 1},
+                {"UV",       false, false, 1},
+                {"LUX",      false, false, 1},
+                {"KWATT",    false, false, 1},
+                {"WATT",     false, false, 1},
+                {"HUM",      true,  false, 1},
+                {"WINDIR",   true,  false, 1},
+                {"CURRENT",  true,  false, 1},
+                {"VOLT",     true,  false, 1},
+                {"DIST",     true,  false, 1},
+                {"METER",    true,  false, 1},
+                {"SOUND",    true,  false, 1},
+        };
+
+        const FieldFormat *findFieldFormat(const char *name, size_t nameLength) {
+            for (auto &format : fieldFormats) {
+                if (strlen(format.name) == nameLength && strncmp(format.name, name, nameLength) == 0)
+                    return &format;
+            }
+            return nullptr;
+        }
+
+        long decodeField(const FieldFormat *format, const char *value) {
+            long raw = strtol(value, nullptr, format->decimal ? 10 : 16);
+            if (format->signBit && (raw & 0x8000))
+                raw = -(raw & 0x7fff);
+            return raw;
+        }
+
+        const Deadband *findDeadband(const char *name, size_t nameLength) {
+            for (uint8_t i = 0; i < params::deadbandsCount; i++) {
+                const Deadband &deadband = params::deadbands[i];
+                if (strlen(deadband.name) == nameLength && strncmp(deadband.name, name, nameLength) == 0)
+                    return &deadband;
+            }
+            return nullptr;
+        }
+
+        /**
+         * Looks for "NAME=" in a body and returns its value and length
+         * */
+        const char *findField(const char *body, size_t bodyLength, const char *name, size_t nameLength, size_t &valueLength) {
+            const char *end = body + bodyLength;
+            const char *p = body;
+            while (p < end) {
+                const char *fieldEnd = (const char *) memchr(p, ';', end - p);
+                if (fieldEnd == nullptr)
+                    fieldEnd = end;
+                if ((size_t) (fieldEnd - p) > nameLength && strncmp(p, name, nameLength) == 0 && p[nameLength] == '=') {
+                    valueLength = fieldEnd - p - nameLength - 1;
+                    return p + nameLength + 1;
+                }
+                p = fieldEnd + 1;
+            }
+            return nullptr;
+        }
+
+        /**
+         * Switch commands and alarms are events, each of them matters even when identical to the previous one
+         * */
+        bool isEvent(const char *body, size_t bodyLength) {
+            size_t valueLength;
+            return findField(body, bodyLength, "CMD", 3, valueLength) != nullptr ||
+                   findField(body, bodyLength, "PIR", 3, valueLength) != nullptr ||
+                   findField(body, bodyLength, "SMOKEALERT", 10, valueLength) != nullptr ||
+                   findField(body, bodyLength, "CHIME", 5, valueLength) != nullptr;
+        }
+
+        /**
+         * @return true if some field of body changed more than its deadband compared to previous
+         * */
+        bool isSignificantChange(const char *previous, const char *body, size_t bodyLength, size_t keyLength) {
+            size_t previousLength = strlen(previous);
+            const char *end = body + bodyLength;
+            const char *field = body + keyLength;
+            unsigned int fields = 0, previousFields = 0;
+
+            for (const char *p = previous + keyLength; *p != 0; p++) {
+                if (*p == ';')
+                    previousFields++;
+            }
+
+            while (field < end) {
+                if (*field == ';')
+                    field++;
+                const char *fieldEnd = (const char *) memchr(field, ';', end - field);
+                if (fieldEnd == nullptr)
+                    fieldEnd = end;
+                const char *equal = (const char *) memchr(field, '=', fieldEnd - field);
+                fields++;
+
+                if (equal == nullptr) {
+                    return true; // not a NAME=value field, don't guess
+                } else {
+                    size_t nameLength = equal - field;
+                    size_t valueLength = fieldEnd - equal - 1;
+                    size_t previousValueLength;
+                    const char *previousValue = findField(previous + keyLength, previousLength - keyLength, field, nameLength, previousValueLength);
+
+                    if (previousValue == nullptr)
+                        return true;
+
+                    if (previousValueLength != valueLength || strncmp(previousValue, equal + 1, valueLength) != 0) {
+                        const Deadband *deadband = findDeadband(field, nameLength);
+                        const FieldFormat *format = findFieldFormat(field, nameLength);
+                        if (deadband == nullptr || format == nullptr)
+                            return true;
+                        // compared in raw units, so 0.1 is exactly one tenth of a degree
+                        long band = (long) (deadband->band * format->divider + 0.5f);
+                        long delta = decodeField(format, equal + 1) - decodeField(format, previousValue);
+                        if (delta > band || delta < -band)
+                            return true;
+                    }
+                }
+                field = fieldEnd;
+            }
+
+            return fields != previousFields;
+        }
+
+        const Device *find(const char *msg) {
+            const char *body;
+            size_t bodyLength, keyLength;
+
+            if (!params::enabled || !parseMessage(msg, body, bodyLength, keyLength))
+                return nullptr;
+
+            unsigned int slot = findSlot(body, keyLength, hashKey(body, keyLength));
+            return isFree(table[slot]) ? nullptr : &table[slot];
+        }
+
+        bool update(const char *msg) {
+            const char *body;
+            size_t bodyLength, keyLength;
+
+            if (!params::enabled || replaying || !parseMessage(msg, body, bodyLength, keyLength))
+                return true;
+
+            uint32_t hash = hashKey(body, keyLength);
+            unsigned int slot = findSlot(body, keyLength, hash);
+            unsigned long now = millis();
+            bool isNew = isFree(table[slot]);
+            counters::updates++;
+
+            if (isNew) {
+                if (count >= params::maxEntries) {
+                    evictLeastRecentlyUsed();
+                    slot = findSlot(body, keyLength, hash); // table was reorganized
+                }
+                Device &device = table[slot];
+                device.hash = hash;
+                device.keyLength = keyLength;
+                device.messages = 0;
+                device.repeats = 0;
+                device.body[0] = 0;
+                count++;
+                counters::inserts++;
+            }
+
+            Device &device = table[slot];
+            bool identical = strlen(device.body) == bodyLength && strncmp(device.body, body, bodyLength) == 0;
+
+            device.messages++;
+            device.lastSeen = now;
+            if (identical)
+                device.repeats++;
+
+            if (params::changeOnly && !isNew && !isEvent(body, bodyLength) && now - device.lastPublished < params::maxSilence_ms &&
+                (identical || !isSignificantChange(device.body, body, bodyLength, keyLength))) {
+                counters::suppressed++;
+                return false; // body keeps the values consumers know about
+            }
+
+            device.lastPublished = now;
+            if (!identical) {
+                memcpy(device.body, body, bodyLength);
+                device.body[bodyLength] = 0;
+                if (params::mqttRetained)
+                    publishRetained(device);
+            }
+            return true;
+        }
+
+        /**
+         * "TEMP=0.1,HUM=1" into params::deadbands
+         * */
+        void parseDeadbands(Config::ConfigItem *item) {
+            const char *p = item->getCharValue();
+            params::deadbandsCount = 0;
+
+            while (*p != 0) {
+                const char *end = strchr(p, ',');
+                if (end == nullptr)
+                    end = p + strlen(p);
+                const char *equal = (const char *) memchr(p, '=', end - p);
+                char *number_end = nullptr;
+                double band = equal != nullptr ? strtod(equal + 1, &number_end) : 0;
+
+                if (equal == nullptr || equal == p || (size_t) (equal - p) >= sizeof(Deadband::name) ||
+                    number_end == equal + 1 || number_end != end || !(band >= 0) ||
+                    params::deadbandsCount >= DEVICES_MAX_DEADBANDS) {
+                    Log::printf(Log::Module_Core, Log::Level_Warning, PSTR("Devices: invalid deadbands '%s', falling back to '%s'"), item->getCharValue(), PSTR(DEVICES_DEFAULT_DEADBANDS));
+                    item->setCharValue(DEVICES_DEFAULT_DEADBANDS);
+                    parseDeadbands(item);
+                    return;
+                }
+
+                Deadband &deadband = params::deadbands[params::deadbandsCount++];
+                memcpy(deadband.name, p, equal - p);
+                deadband.name[equal - p] = 0;
+                deadband.band = band;
+
+                p = *end == ',' ? end + 1 : end;
+            }
+        }
+
+        void paramsUpdatedCallback() {
+            refreshParametersFromConfig();
+        }
+
+        void refreshParametersFromConfig(bool triggerChanges) {
+            Config::ConfigItem *item;
+
+            item = &configItems[ConfigItem_Enabled];
+            params::enabled = item->getBoolValue();
+
+            item = &configItems[ConfigItem_MaxEntries];
+            if (item->getLongIntValue() < 1 || item->getLongIntValue() > DEVICES_MAX_ENTRIES) {
+                Log::printf(Log::Module_Core, Log::Level_Warning, PSTR("Devices: max_entries must be between 1 and %d, falling back to %d"), DEVICES_MAX_ENTRIES, DEVICES_MAX_ENTRIES);
+                item->setLongIntValue(DEVICES_MAX_ENTRIES);
+            }
+            params::maxEntries = item->getLongIntValue();
+
+            item = &configItems[ConfigItem_MqttRetained];
+            params::mqttRetained = item->getBoolValue();
+
+            item = &configItems[ConfigItem_ChangeOnly];
+            params::changeOnly = item->getBoolValue();
+
+            item = &configItems[ConfigItem_MaxSilence];
+            params::maxSilence_ms = item->getLongIntValue() * 1000UL;
+
+            item = &configItems[ConfigItem_Deadbands];
+            parseDeadbands(item);
+
+            if (!triggerChanges)
+                return;
+            if (!params::enabled)
+                clear();
+            while (count > params::maxEntries)
+                evictLeastRecentlyUsed();
+        }
+
+        void setup() {
+            clear();
+            refreshParametersFromConfig(false);
+        }
+
+        void executeCliCommand(char *args) {
+            if (strncasecmp_P(args, PSTR("clear;"), 6) == 0) {
+                clear();
+            } else {
+                // replays last message of each device, so consumers can bootstrap
+                replaying = true;
+                for (auto &device : table) {
+                    if (isFree(device))
+                        continue;
+                    sendMsgFromBuffer(); // pbuffer holds a single message
+                    display_Header();
+                    strcat(pbuffer, ";");
+                    strcat(pbuffer, device.body);
+                    display_Footer();
+                    sendMsgFromBuffer();
+                }
+                replaying = false;
+            }
+
+            sendMsgFromBuffer();
+            display_Header();
+            display_Name(PSTR("DEVICES"));
+            sprintf_P(pbuffer + strlen(pbuffer), PSTR(";COUNT=%u"), count);
+            display_Footer();
+        }
+
+        void printDevicesJson(Print &output) {
+            unsigned long now = millis();
+            bool first = true;
+
+            output.print('[');
+            for (unsigned int i = 0; i < DEVICES_TABLE_SIZE; i++) {
+                Device device = table[i]; // main loop may update it meanwhile, work on a copy
+                device.body[DEVICES_BODY_SIZE - 1] = 0;
+                if (isFree(device) || device.keyLength > strlen(device.body))
+                    continue;
+
+                const char *idStart = strchr(device.body, ';');
+                if (idStart == nullptr)
+                    continue;
+                const char *idEnd = strchr(idStart + 1, ';');
+                const char *keyEnd = device.body + device.keyLength;
+                if (idEnd == nullptr || idEnd > keyEnd)
+                    idEnd = keyEnd;
+
+                output.print(first ? F("{\"protocol\":\"") : F(",{\"protocol\":\""));
+                output.write((const uint8_t *) device.body, idStart - device.body);
+                output.print(F("\",\"id\":\""));
+                output.write((const uint8_t *) idStart + 4, idEnd - idStart - 4);
+                if (idEnd < keyEnd) {
+                    output.print(F("\",\"switch\":\""));
+                    output.write((const uint8_t *) idEnd + 8, keyEnd - idEnd - 8);
+                }
+                output.printf_P(PSTR("\",\"message\":\"%s\",\"age_s\":%lu,\"messages\":%lu,\"repeats\":%lu}"),
+                                device.body, (now - device.lastSeen) / 1000, device.messages, device.repeats);
+                first = false;
+            }
+            output.print(']');
+        }
+
+        void getStatusJsonString(JsonObject &output) {
+            auto &&devices = output.createNestedObject("devices");
+            devices[F("enabled")] = params::enabled;
+            devices[F("count")] = count;
+            devices[F("max_entries")] = params::maxEntries;
+            devices[F("updates")] = counters::updates;
+            devices[F("inserts")] = counters::inserts;
+            devices[F("evictions")] = counters::evictions;
+            devices[F("retained_published")] = counters::retainedPublished;
+            devices[F("retained_failed")] = counters::retainedFailed;
+            devices[F("change_only")] = params::changeOnly;
+            devices[F("suppressed")] = counters::suppressed;
+        }
+
+    }
+}
@@ -0,0 +1,110 @@
+#ifndef _20_Devices_H_
+#define _20_Devices_H_
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "4_Display.h"
+#include "11_Config.h"
+
+#ifndef DEVICES_TABLE_SIZE
+#if defined(ESP32)
+#define DEVICES_TABLE_SIZE 128 // slots of the hash table, must be a power of 2
+#else
+#define DEVICES_TABLE_SIZE 32
+#endif
+#endif
+
+#define DEVICES_MAX_ENTRIES (DEVICES_TABLE_SIZE * 3 / 4) // keeps probe sequences short
+#define DEVICES_BODY_SIZE (PRINT_BUFFER_SIZE - 6)        // message without "20;XX;"
+
+#ifndef DEVICES_MAX_DEADBANDS
+#define DEVICES_MAX_DEADBANDS 8
+#endif
+
+#define DEVICES_DEFAULT_DEADBANDS "TEMP=0.1,HUM=1"
+
+static_assert((DEVICES_TABLE_SIZE & (DEVICES_TABLE_SIZE - 1)) == 0, "DEVICES_TABLE_SIZE must be a power of 2");
+
+/**
+ * Last known state of every device heard, so a consumer connecting later does not have to wait
+ * for each sensor to transmit again.
+ *
+ * Devices are identified by protocol name, ID and SWITCH (when it follows the ID), they are stored in an
+ * open addressing table. When max_entries is reached the least recently seen device makes room.
+ *
+ * With change_only, the table also filters what gets published: a sensor message whose values did not move
+ * more than their deadband is dropped, unless nothing was published for that device during max_silence.
+ * Events (switch commands, PIR, smoke alarms, doorbells) are never dropped.
+ * */
+namespace RFLink {
+    namespace Devices {
+
+        extern Config::ConfigItem configItems[];
+
+        struct Deadband {
+            char name[12];
+            float band;    // in the unit of the field, ie 0.1 (Celsius) for TEMP
+        };
+
+        namespace params {
+            extern bool enabled;
+            extern unsigned int maxEntries;
+            extern bool mqttRetained;
+
+            extern bool changeOnly;
+            extern unsigned long maxSilence_ms;
+        }
+
+        struct Device {
+            uint32_t hash;
+            unsigned long lastSeen;    // millis()
+            unsigned long messages;
+            unsigned long repeats;     // messages carrying the same values as body
+            unsigned long lastPublished;
+            uint8_t keyLength;         // "Name;ID=xx[;SWITCH=yy]" part of body
+            char body[DEVICES_BODY_SIZE]; // last published message, without "20;XX;" nor trailing ";\r\n". Empty slot if ""
+        };
+
+        /**
+         * Splits a "20;XX;Name;ID=...;...;\r\n" message
+         * @return false if it is not a device message
+         * */
+        bool parseMessage(const char *msg, const char *&body, size_t &bodyLength, size_t &keyLength);
+
+        /**
+         * Switch commands (CMD), PIR, smoke alarms and doorbells: each of them matters even when identical to the previous one
+         * @param body message without its "20;XX;" prefix
+         * */
+        bool isEvent(const char *body, size_t bodyLength);
+
+        /**
+         * @return the device this message belongs to, nullptr if not found or not a device message
+         * */
+        const Device *find(const char *msg);
+
+        /**
+         * Records a message built in pbuffer, call before it is published
+         * @return false if change_only filter says it should not be published
+         * */
+        bool update(const char *msg);
+
+        void setup();
+
+        void paramsUpdatedCallback();
+        void refreshParametersFromConfig(bool triggerChanges = true);
+
+        /**
+         * @param args the part following "10;devices;"
+         * */
+        void executeCliCommand(char *args);
+
+        /**
+         * JSON array of all devices, for the web API
+         * */
+        void printDevicesJson(Print &output);
+
+        void getStatusJsonString(JsonObject &output);
+    }
+}
+
+#endif // _20_Devices_H_
@@ -0,0 +1,366 @@
+#include <Arduino.h>
+#include "RFLink.h"
+#include "4_Display.h"
+#include "21_Filter.h"
+#include "25_Log.h"
+
+namespace RFLink {
+    namespace Filter {
+
+        namespace params {
+            Mode mode = Mode_Off;
+        }
+
+        namespace counters {
+            unsigned long int accepted = 0;
+            unsigned long int rejected = 0;
+            unsigned long int learned = 0;
+        }
+
+        const char *modeNames[] = {
+                "off",
+                "allow",
+                "deny",
+                "EOF" // matches Mode::Mode_EOF
+        };
+        static_assert(sizeof(modeNames) / sizeof(char *) == Mode::Mode_EOF + 1, "modeNames has missing/extra names, please compare with Mode enum declarations");
+
+        // All json variable names
+        const char json_name_mode[] = "mode";
+        const char json_name_ids[] = "ids";
+        const char json_name_protocols[] = "protocols";
+
+        enum ConfigItemIndex {
+            ConfigItem_Mode,
+            ConfigItem_Ids,
+            ConfigItem_Protocols,
+            ConfigItem_EOF,
+        };
+
+        Config::ConfigItem configItems[] = {
+                Config::ConfigItem(json_name_mode, Config::SectionId::Filter_id, modeNames[Mode_Off], paramsUpdatedCallback),
+                Config::ConfigItem(json_name_ids, Config::SectionId::Filter_id, "", paramsUpdatedCallback),
+                Config::ConfigItem(json_name_protocols, Config::SectionId::Filter_id, "", paramsUpdatedCallback),
+                Config::ConfigItem() // dont remove it!
+        };
+        static_assert(sizeof(configItems) / sizeof(Config::ConfigItem) == ConfigItem_EOF + 1, "configItems has missing/extra items, please compare with ConfigItemIndex enum declarations");
+
+        struct Pattern {
+            bool isRange;
+            uint32_t low, high;        // range
+            char prefix[FILTER_ID_SIZE];
+            uint8_t prefixLength;
+        };
+
+        // exact IDs and protocol names, by hash. 0 means free slot
+        uint32_t table[FILTER_TABLE_SIZE];
+        unsigned int tableCount = 0;
+        Pattern patterns[FILTER_MAX_PATTERNS];
+        uint8_t patternsCount = 0;
+
+        bool learning = false;
+        unsigned long learnEnd = 0;
+        char learnedIds[FILTER_LEARN_BUFFER_SIZE];
+        unsigned int learnedCount = 0;
+
+        const char kindId = 'i';
+        const char kindProtocol = 'p';
+
+        // FNV-1a, case insensitive as IDs may be printed either way
+        uint32_t hashKey(char kind, const char *key, size_t length) {
+            uint32_t hash = 2166136261UL;
+            hash = (hash ^ (uint8_t) kind) * 16777619UL;
+            for (size_t i = 0; i < length; i++)
+                hash = (hash ^ (uint8_t) tolower(key[i])) * 16777619UL;
+            return hash != 0 ? hash : 1;
+        }
+
+        bool contains(uint32_t hash) {
+            unsigned int slot = hash & (FILTER_TABLE_SIZE - 1);
+            while (table[slot] != 0) {
+                if (table[slot] == hash)
+                    return true;
+                slot = (slot + 1) & (FILTER_TABLE_SIZE - 1);
+            }
+            return false;
+        }
+
+        bool insert(uint32_t hash) {
+            if (contains(hash))
+                return true;
+            if (tableCount >= FILTER_MAX_ENTRIES)
+                return false;
+            unsigned int slot = hash & (FILTER_TABLE_SIZE - 1);
+            while (table[slot] != 0)
+                slot = (slot + 1) & (FILTER_TABLE_SIZE - 1);
+            table[slot] = hash;
+            tableCount++;
+            return true;
+        }
+
+        /**
+         * @return false if the entry is not valid or there is no room left
+         * */
+        bool addId(const char *id, size_t length) {
+            while (length > 0 && *id == ' ') {
+                id++;
+                length--;
+            }
+            while (length > 0 && id[length - 1] == ' ')
+                length--;
+            if (length == 0)
+                return true;
+
+            const char *dash = (const char *) memchr(id, '-', length);
+            if (dash != nullptr || id[length - 1] == '*') {
+                if (patternsCount >= FILTER_MAX_PATTERNS)
+                    return false;
+                Pattern &pattern = patterns[patternsCount];
+                if (dash != nullptr) {
+                    char *end;
+                    pattern.isRange = true;
+                    pattern.low = strtoul(id, &end, 16);
+                    if (end != dash)
+                        return false;
+                    pattern.high = strtoul(dash + 1, &end, 16);
+                    if (end != id + length || pattern.high < pattern.low)
+                        return false;
+                } else {
+                    pattern.isRange = false;
+                    pattern.prefixLength = length - 1;
+                    if (pattern.prefixLength >= FILTER_ID_SIZE)
+                        return false;
+                    for (uint8_t i = 0; i < pattern.prefixLength; i++)
+                        pattern.prefix[i] = tolower(id[i]);
+                }
+                patternsCount++;
+                return true;
+            }
+
+            return length < FILTER_ID_SIZE && insert(hashKey(kindId, id, length));
+        }
+
+        bool addProtocol(const char *name, size_t length) {
+            while (length > 0 && *name == ' ') {
+                name++;
+                length--;
+            }
+            while (length > 0 && name[length - 1] == ' ')
+                length--;
+            return length == 0 || insert(hashKey(kindProtocol, name, length));
+        }
+
+        /**
+         * Calls add() for each comma separated entry, an entry which is refused is reported and skipped
+         * @return false if any entry was refused
+         * */
+        bool compileList(const char *list, bool (*add)(const char *, size_t)) {
+            bool allAdded = true;
+            while (*list != 0) {
+                const char *end = strchr(list, ',');
+                if (end == nullptr)
+                    end = list + strlen(list);
+                if (!add(list, end - list)) {
+                    Log::printf(Log::Module_Core, Log::Level_Warning, PSTR("Filter: entry '%.*s' ignored, invalid or no room left"), (int) (end - list), list);
+                    allAdded = false;
+                }
+                list = *end == ',' ? end + 1 : end;
+            }
+            return allAdded;
+        }
+
+        bool matchesPatterns(const char *id, size_t length) {
+            uint32_t value = 0;
+            bool isHex = length > 0 && length <= 8;
+            for (size_t i = 0; i < length && isHex; i++) {
+                if (!isxdigit(id[i]))
+                    isHex = false;
+                else
+                    value = value << 4 | (isdigit(id[i]) ? id[i] - '0' : (tolower(id[i]) - 'a' + 10));
+            }
+
+            for (uint8_t i = 0; i < patternsCount; i++) {
+                const Pattern &pattern = patterns[i];
+                if (pattern.isRange) {
+                    if (isHex && value >= pattern.low && value <= pattern.high)
+                        return true;
+                } else if (length >= pattern.prefixLength && strncasecmp(id, pattern.prefix, pattern.prefixLength) == 0)
+                    return true;
+            }
+            return false;
+        }
+
+        void learn(const char *id, size_t length) {
+            size_t used = strlen(learnedIds);
+            if (length >= FILTER_ID_SIZE || used + length + 2 > sizeof(learnedIds))
+                return;
+            if (!insert(hashKey(kindId, id, length)))
+                return;
+
+            if (used > 0)
+                learnedIds[used++] = ',';
+            memcpy(learnedIds + used, id, length);
+            learnedIds[used + length] = 0;
+            learnedCount++;
+            counters::learned++;
+        }
+
+        bool accepts(const char *msg) {
+            if (params::mode == Mode_Off && !learning)
+                return true;
+
+            // "20;XX;Name;ID=..."
+            if (strncmp(msg, "20;", 3) != 0 || strlen(msg) < 6 || msg[5] != ';')
+                return true;
+            const char *name = msg + 6;
+            const char *nameEnd = strchr(name, ';');
+            if (nameEnd == nullptr || strncmp(nameEnd, ";ID=", 4) != 0)
+                return true;
+            const char *id = nameEnd + 4;
+            size_t idLength = strcspn(id, ";\r\n");
+
+            bool listed = contains(hashKey(kindId, id, idLength)) ||
+                          contains(hashKey(kindProtocol, name, nameEnd - name)) ||
+                          matchesPatterns(id, idLength);
+
+            if (learning) {
+                if (!listed)
+                    learn(id, idLength);
+                counters::accepted++;
+                return true;
+            }
+
+            if (listed == (params::mode == Mode_Allow)) {
+                counters::accepted++;
+                return true;
+            }
+            counters::rejected++;
+            return false;
+        }
+
+        Mode modeFromString(const char *name) {
+            for (int i = 0; i < Mode_EOF; i++) {
+                if (strcmp(modeNames[i], name) == 0)
+                    return (Mode) i;
+            }
+            return Mode_EOF;
+        }
+
+        void paramsUpdatedCallback() {
+            refreshParametersFromConfig();
+        }
+
+        void refreshParametersFromConfig(bool triggerChanges) {
+            Config::ConfigItem *item;
+
+            item = &configItems[ConfigItem_Mode];
+            Mode mode = modeFromString(item->getCharValue());
+            if (mode == Mode_EOF) {
+                Log::printf(Log::Module_Core, Log::Level_Warning, PSTR("Filter: unsupported mode '%s', falling back to '%s'"), item->getCharValue(), modeNames[Mode_Off]);
+                mode = Mode_Off;
+                item->setCharValue(modeNames[mode]);
+            }
+            params::mode = mode;
+
+            memset(table, 0, sizeof(table));
+            tableCount = 0;
+            patternsCount = 0;
+
+            item = &configItems[ConfigItem_Ids];
+            if (!compileList(item->getCharValue(), addId))
+                Log::printf(Log::Module_Core, Log::Level_Warning, PSTR("Filter: some ids were ignored, too many or invalid ones in '%s'"), item->getCharValue());
+
+            item = &configItems[ConfigItem_Protocols];
+            if (!compileList(item->getCharValue(), addProtocol))
+                Log::printf(Log::Module_Core, Log::Level_Warning, PSTR("Filter: some protocols were ignored, too many in '%s'"), item->getCharValue());
+
+            // what was learned so far is not in config yet
+            if (learning)
+                compileList(learnedIds, addId);
+        }
+
+        void setup() {
+            refreshParametersFromConfig(false);
+        }
+
+        void displayFilterStatus() {
+            sendMsgFromBuffer(); // pbuffer holds a single message
+            display_Header();
+            display_Name(PSTR("FILTER"));
+            sprintf_P(pbuffer + strlen(pbuffer), PSTR(";MODE=%s"), modeNames[params::mode]);
+            if (learning)
+                sprintf_P(pbuffer + strlen(pbuffer), PSTR(";LEARNING=%lu"), (learnEnd - millis()) / 1000);
+            sprintf_P(pbuffer + strlen(pbuffer), PSTR(";LEARNED=%u"), learnedCount);
+            display_Footer();
+        }
+
+        void stopLearning() {
+            learning = false;
+
+            if (learnedCount > 0) {
+                Config::ConfigItem *item = &configItems[ConfigItem_Ids];
+                String ids = item->getCharValue();
+                if (ids.length() > 0)
+                    ids += ',';
+                ids += learnedIds;
+                item->setCharValue(ids.c_str());
+
+                if (params::mode == Mode_Off) {
+                    item = &configItems[ConfigItem_Mode];
+                    item->setCharValue(modeNames[Mode_Allow]);
+                }
+
+                Config::saveConfigToFlash();
+                refreshParametersFromConfig();
+            }
+
+            displayFilterStatus();
+        }
+
+        void mainLoop() {
+            if (learning && (long) (millis() - learnEnd) >= 0) {
+                stopLearning();
+                sendMsgFromBuffer();
+            }
+        }
+
+        void executeCliCommand(char *args) {
+            if (strncasecmp_P(args, PSTR("learn=stop;"), 11) == 0) {
+                if (learning)
+                    stopLearning();
+                else
+                    displayFilterStatus();
+                return;
+            }
+
+            if (strncasecmp_P(args, PSTR("learn="), 6) == 0) {
+                unsigned long seconds = strtoul(args + 6, nullptr, 10);
+                if (seconds == 0) {
+                    display_Header();
+                    display_Name(PSTR("FILTER"));
+                    display_Name(PSTR("CMD UNKNOWN"));
+                    display_Footer();
+                    return;
+                }
+                learning = true;
+                learnEnd = millis() + seconds * 1000UL;
+                learnedIds[0] = 0;
+                learnedCount = 0;
+            }
+
+            displayFilterStatus();
+        }
+
+        void getStatusJsonString(JsonObject &output) {
+            auto &&filter = output.createNestedObject("filter");
+            filter[F("mode")] = modeNames[params::mode];
+            filter[F("learning")] = learning;
+            filter[F("entries")] = tableCount;
+            filter[F("patterns")] = patternsCount;
+            filter[F("accepted")] = counters::accepted;
+            filter[F("rejected")] = counters::rejected;
+            filter[F("learned")] = counters::learned;
+        }
+
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef _21_Filter_H_
+#define _21_Filter_H_
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "11_Config.h"
+
+#ifndef FILTER_TABLE_SIZE
+#define FILTER_TABLE_SIZE 128 // exact IDs and protocol names, must be a power of 2
+#endif
+
+#define FILTER_MAX_ENTRIES (FILTER_TABLE_SIZE * 3 / 4)
+
+#ifndef FILTER_MAX_PATTERNS
+#define FILTER_MAX_PATTERNS 8 // ID ranges and prefixes
+#endif
+
+#define FILTER_ID_SIZE 12 // longest ID is 8 hex digits
+
+#ifndef FILTER_LEARN_BUFFER_SIZE
+#define FILTER_LEARN_BUFFER_SIZE 256 // IDs learned during one window
+#endif
+
+static_assert((FILTER_TABLE_SIZE & (FILTER_TABLE_SIZE - 1)) == 0, "FILTER_TABLE_SIZE must be a power of 2");
+
+/**
+ * Allow or deny list of devices, checked before a decoded message is recorded or published,
+ * so a rejected neighbour's sensor costs a hash lookup.
+ *
+ * Configuration lists are compiled at load time:
+ * - ids: comma separated, exact "00c142", prefix "00c1*" or hexadecimal range "1000-1fff"
+ * - protocols: comma separated plugin names, ie "Oregon TempHygro,Cresta"
+ * A message matches if its protocol or its ID is listed. Messages without an ID always pass.
+ *
+ * Learn mode (10;filter;learn=<seconds>;) lets everything through and adds the IDs it hears to the list.
+ * */
+namespace RFLink {
+    namespace Filter {
+
+        extern Config::ConfigItem configItems[];
+
+        enum Mode {
+            Mode_Off,
+            Mode_Allow, // only listed devices pass
+            Mode_Deny,  // listed devices are dropped
+            Mode_EOF,
+        };
+
+        namespace counters {
+            extern unsigned long int accepted;
+            extern unsigned long int rejected;
+            extern unsigned long int learned;
+        }
+
+        void setup();
+        /**
+         * Include in your main loop, it ends learn windows
+         * */
+        void mainLoop();
+
+        /**
+         * @return false if this message must be dropped
+         * */
+        bool accepts(const char *msg);
+
+        /**
+         * @param args the part following "10;filter;"
+         * */
+        void executeCliCommand(char *args);
+
+        void paramsUpdatedCallback();
+        void refreshParametersFromConfig(bool triggerChanges = true);
+
+        void getStatusJsonString(JsonObject &output);
+    }
+}
+
+#endif // _21_Filter_H_
@@ -0,0 +1,273 @@
+#include <Arduino.h>
+#include <sys/time.h>
+#include "RFLink.h"
+#include "2_Signal.h"
+#include "5_Plugin.h"
+#include "14_Transmit.h"
+#include "17_Output.h"
+#include "21_Filter.h"
+#include "22_Metrics.h"
+#include "23_Profiler.h"
+#include "26_SerialTx.h"
+#if defined(RFLINK_WIFI_ENABLED)
+#include "6_MQTT.h"
+#include "9_Serial2Net.h"
+#endif
+
+namespace RFLink {
+    namespace Metrics {
+
+        const char counterType[] PROGMEM = "counter";
+        const char gaugeType[] PROGMEM = "gauge";
+        const char histogramType[] PROGMEM = "histogram";
+
+        // "# HELP rflink_name help\n# TYPE rflink_name type\n"
+        void printFamily(Print &output, const __FlashStringHelper *name, const char *type, const __FlashStringHelper *help) {
+            output.print(F("# HELP rflink_"));
+            output.print(name);
+            output.print(' ');
+            output.print(help);
+            output.print(F("\n# TYPE rflink_"));
+            output.print(name);
+            output.print(' ');
+            output.print(FPSTR(type));
+            output.print('\n');
+        }
+
+        void printLabel(Print &output, const __FlashStringHelper *label, const char *value) {
+            output.print(label);
+            output.print(F("=\""));
+            for (; *value != 0; value++) {
+                if (*value == '\\' || *value == '"')
+                    output.print('\\');
+                if (*value == '\n')
+                    output.print(F("\\n"));
+                else
+                    output.print(*value);
+            }
+            output.print('"');
+        }
+
+        void printName(Print &output, const __FlashStringHelper *name) {
+            output.print(F("rflink_"));
+            output.print(name);
+        }
+
+        void printSample(Print &output, const __FlashStringHelper *name, unsigned long value) {
+            printName(output, name);
+            output.print(' ');
+            output.print(value);
+            output.print('\n');
+        }
+
+        void printSample(Print &output, const __FlashStringHelper *name, double value) {
+            printName(output, name);
+            output.print(' ');
+            output.print(value, 6);
+            output.print('\n');
+        }
+
+        void printCounter(Print &output, const __FlashStringHelper *name, const __FlashStringHelper *help, unsigned long value) {
+            printFamily(output, name, counterType, help);
+            printSample(output, name, value);
+        }
+
+        void printGauge(Print &output, const __FlashStringHelper *name, const __FlashStringHelper *help, unsigned long value) {
+            printFamily(output, name, gaugeType, help);
+            printSample(output, name, value);
+        }
+
+        void printGauge(Print &output, const __FlashStringHelper *name, const __FlashStringHelper *help, double value) {
+            printFamily(output, name, gaugeType, help);
+            printSample(output, name, value);
+        }
+
+        // name_bucket{section="x",le="..."} lines, then name_sum and name_count
+        void printHistogram(Print &output, const __FlashStringHelper *name, const char *section, const Profiler::Histogram &histogram) {
+            unsigned long cumulated = 0;
+            for (uint8_t bucket = 0; bucket < PROFILER_BUCKETS; bucket++) {
+                cumulated += histogram.buckets[bucket];
+                printName(output, name);
+                output.print(F("_bucket{"));
+                if (section != nullptr) {
+                    printLabel(output, F("section"), section);
+                    output.print(',');
+                }
+                output.print(F("le=\""));
+                if (bucket < PROFILER_BUCKETS - 1)
+                    output.print(Profiler::bucketUpperBound_us(bucket) / 1000000.0, 6);
+                else
+                    output.print(F("+Inf"));
+                output.print(F("\"} "));
+                output.print(cumulated);
+                output.print('\n');
+            }
+
+            for (uint8_t i = 0; i < 2; i++) {
+                printName(output, name);
+                output.print(i == 0 ? F("_sum") : F("_count"));
+                if (section != nullptr) {
+                    output.print('{');
+                    printLabel(output, F("section"), section);
+                    output.print('}');
+                }
+                output.print(' ');
+                if (i == 0)
+                    output.print(histogram.total_us / 1000000.0, 6);
+                else
+                    output.print(histogram.count);
+                output.print('\n');
+            }
+        }
+
+        /**
+         * @param next first plugin index to print, moved past the last one printed
+         * @return true once every plugin has been printed
+         * */
+        bool printPluginMetrics(Print &output, uint16_t &next) {
+            char id[4];
+
+            if (next == 0)
+                printFamily(output, F("plugin_decoded_total"), counterType, F("Signals decoded by each receive plugin"));
+            for (uint8_t printed = 0; next < PLUGIN_MAX && printed < METRICS_PLUGINS_PER_PART; next++) {
+                if (Plugin_id[next] == 0)
+                    continue;
+                printName(output, F("plugin_decoded_total"));
+                output.print('{');
+                sprintf_P(id, PSTR("%03u"), Plugin_id[next]);
+                printLabel(output, F("plugin"), id);
+#ifndef ARDUINO_AVR_UNO
+                output.print(',');
+                printLabel(output, F("name"), Plugin_Description[next].c_str());
+#endif
+                output.print(F("} "));
+                output.print(Plugin_Hits[next]);
+                output.print('\n');
+                printed++;
+            }
+            return next >= PLUGIN_MAX;
+        }
+
+        void printOutputMetrics(Print &output) {
+            const Output::Sink *sink;
+
+            printFamily(output, F("output_queue_depth"), gaugeType, F("Messages waiting for each output"));
+            for (uint8_t i = 0; (sink = Output::getSink(i)) != nullptr; i++) {
+                printName(output, F("output_queue_depth"));
+                output.print('{');
+                printLabel(output, F("sink"), sink->name);
+                output.print(F("} "));
+                output.print(Output::queueDepth(sink));
+                output.print('\n');
+            }
+
+            printFamily(output, F("output_delivered_total"), counterType, F("Messages delivered by each output"));
+            for (uint8_t i = 0; (sink = Output::getSink(i)) != nullptr; i++) {
+                printName(output, F("output_delivered_total"));
+                output.print('{');
+                printLabel(output, F("sink"), sink->name);
+                output.print(F("} "));
+                output.print(sink->delivered);
+                output.print('\n');
+            }
+
+            printFamily(output, F("output_dropped_total"), counterType, F("Messages dropped by each output because its queue was full"));
+            for (uint8_t i = 0; (sink = Output::getSink(i)) != nullptr; i++) {
+                printName(output, F("output_dropped_total"));
+                output.print('{');
+                printLabel(output, F("sink"), sink->name);
+                output.print(F("} "));
+                output.print(sink->dropped + sink->rawDropped);
+                output.print('\n');
+            }
+        }
+
+        enum Part {
+            Part_Signals,
+            Part_Plugins,  // METRICS_PLUGINS_PER_PART at a time
+            Part_Loop,
+            Part_Sections, // one histogram at a time
+            Part_System,
+            Part_Transmit,
+            Part_EOF,
+        };
+
+        PartPrinter::PartPrinter() : part(Part_Signals), item(0) {}
+
+        bool PartPrinter::printNext(Print &output) {
+            switch (part) {
+                case Part_Signals: {
+                    struct timeval now;
+                    gettimeofday(&now, nullptr);
+                    printGauge(output, F("uptime_seconds"), F("Seconds since boot"), (unsigned long) (now.tv_sec - timeAtBoot.tv_sec));
+
+                    printCounter(output, F("signals_received_total"), F("Frames captured by the receiver"), Signal::counters::receivedSignalsCount);
+                    printCounter(output, F("signals_decoded_total"), F("Frames decoded by a plugin"), Signal::counters::successfullyDecodedSignalsCount);
+                    printCounter(output, F("signals_dropped_total"), F("Frames lost because the capture buffer overflowed or was busy"), Signal::counters::droppedSignalsCount);
+                    printCounter(output, F("signals_noise_total"), F("Frames discarded for too short or too few pulses"), Signal::counters::noiseSignalsCount);
+                    break;
+                }
+
+                case Part_Plugins:
+                    if (!printPluginMetrics(output, item))
+                        return true;
+                    break;
+
+                case Part_Loop:
+                    printCounter(output, F("filter_rejected_total"), F("Messages dropped by the device filter"), Filter::counters::rejected);
+
+                    printFamily(output, F("loop_duration_seconds"), histogramType, F("Duration of main loop iterations"));
+                    printHistogram(output, F("loop_duration_seconds"), nullptr, Profiler::loop);
+                    printGauge(output, F("loop_duration_max_seconds"), F("Longest main loop iteration since boot"), Profiler::loop.max_us / 1000000.0);
+                    printFamily(output, F("loop_section_duration_seconds"), histogramType, F("Time spent in each section of the main loop, per iteration"));
+                    break;
+
+                case Part_Sections:
+                    printHistogram(output, F("loop_section_duration_seconds"), Profiler::sectionNames[item], Profiler::sections[item]);
+                    if (++item < Profiler::Section_EOF)
+                        return true;
+                    break;
+
+                case Part_System:
+                    printGauge(output, F("heap_free_bytes"), F("Free heap"), (unsigned long) ESP.getFreeHeap());
+#if defined(ESP32)
+                    printGauge(output, F("heap_largest_block_bytes"), F("Largest block which can be allocated"), (unsigned long) ESP.getMaxAllocHeap());
+#elif defined(ESP8266)
+                    printGauge(output, F("heap_largest_block_bytes"), F("Largest block which can be allocated"), (unsigned long) ESP.getMaxFreeBlockSize());
+#endif
+
+                    printOutputMetrics(output);
+
+                    printGauge(output, F("serial_tx_buffered_bytes"), F("Bytes waiting in the serial transmit ring"), (unsigned long) SerialTx::used());
+                    printCounter(output, F("serial_tx_bytes_total"), F("Bytes handed to the UART"), SerialTx::counters::bytesWritten);
+                    printCounter(output, F("serial_tx_dropped_bytes_total"), F("Bytes dropped because the serial transmit ring was full"), SerialTx::counters::droppedBytes);
+                    printCounter(output, F("serial_tx_blocked_writes_total"), F("Writes which had to wait for room in the serial transmit ring"), SerialTx::counters::blockedWrites);
+
+#if defined(RFLINK_WIFI_ENABLED)
+                    printGauge(output, F("mqtt_in_flight"), F("QoS 1 messages waiting for their acknowledgement"), (unsigned long) Mqtt::inFlight());
+#ifndef RFLINK_SERIAL2NET_DISABLED
+                    printGauge(output, F("serial2net_clients"), F("Connected Serial2Net clients"), (unsigned long) Serial2Net::clientsCount());
+#endif
+#endif
+                    break;
+
+                case Part_Transmit:
+                    printCounter(output, F("tx_jobs_submitted_total"), F("Transmit jobs queued"), Transmit::counters::submittedJobs);
+                    printCounter(output, F("tx_jobs_completed_total"), F("Transmit jobs played"), Transmit::counters::completedJobs);
+                    printCounter(output, F("tx_jobs_rejected_total"), F("Transmit jobs refused, invalid signal or no TX pin"), Transmit::counters::rejectedJobs);
+                    printGauge(output, F("tx_queue_depth"), F("Transmit jobs waiting or playing"), (unsigned long) Transmit::queueDepth());
+                    printCounter(output, F("tx_frames_sent_total"), F("Frames transmitted, repeats included"), Transmit::counters::framesSent);
+                    printFamily(output, F("tx_airtime_seconds_total"), counterType, F("Time spent transmitting"));
+                    printSample(output, F("tx_airtime_seconds_total"), Transmit::counters::totalAirTime_us / 1000000.0);
+                    break;
+
+                default:
+                    return false;
+            }
+
+            item = 0;
+            return ++part < Part_EOF;
+        }
+
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef _22_Metrics_H_
+#define _22_Metrics_H_
+
+#include <Arduino.h>
+
+#ifndef METRICS_PLUGINS_PER_PART
+#define METRICS_PLUGINS_PER_PART 16 // plugin samples printed per call of PartPrinter::printNext()
+#endif
+
+/**
+ * Gateway telemetry in Prometheus text exposition format (version 0.0.4), served on /metrics.
+ *
+ * Nothing is accumulated here: samples are read from the counters each module already keeps,
+ * while the response is being streamed, a few families at a time so it never sits in memory as a whole.
+ * */
+namespace RFLink {
+    namespace Metrics {
+
+        /**
+         * Writes the exposition one part at a time, each part is at most a couple of KB.
+         * Safe to use from the web server task
+         * */
+        class PartPrinter {
+        public:
+            PartPrinter();
+            /**
+             * @return false once the last part has been printed
+             * */
+            bool printNext(Print &output);
+
+        private:
+            uint8_t part;
+            uint16_t item; // position within the part, ie next plugin
+        };
+
+    }
+}
+
+#endif // _22_Metrics_H_
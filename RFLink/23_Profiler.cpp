@@ -0,0 +1,190 @@
+#include <Arduino.h>
+#include "RFLink.h"
+#include "4_Display.h"
+#include "23_Profiler.h"
+
+namespace RFLink {
+    namespace Profiler {
+
+        Histogram loop;
+        Histogram sections[Section_EOF];
+        Stall stalls[PROFILER_TOP_STALLS];
+
+        const char *sectionNames[] = {
+                "mqtt",
+                "output",
+                "wifi",
+                "portal",
+                "serial2net",
+                "serial",
+                "transmit",
+                "batch",
+                "filter",
+                "scan",
+                "log",
+                "serialtx",
+                "other",
+                "EOF" // matches Section::Section_EOF
+        };
+        static_assert(sizeof(sectionNames) / sizeof(char *) == Section::Section_EOF + 1, "sectionNames has missing/extra names, please compare with Section enum declarations");
+
+        // current iteration
+        unsigned long loopStart_us = 0;
+        unsigned long lastMark_us = 0;
+        Section culprit = Section_Other;
+        unsigned long culprit_us = 0;
+
+        uint8_t bucketOf(unsigned long duration_us) {
+            uint8_t bucket = 0;
+            for (unsigned long value = duration_us / PROFILER_FIRST_BUCKET_US; value != 0 && bucket < PROFILER_BUCKETS - 1; value >>= 1)
+                bucket++;
+            return bucket;
+        }
+
+        void record(Histogram &histogram, unsigned long duration_us) {
+            histogram.buckets[bucketOf(duration_us)]++;
+            histogram.count++;
+            histogram.total_us += duration_us;
+            histogram.last_us = duration_us;
+            if (duration_us > histogram.max_us)
+                histogram.max_us = duration_us;
+        }
+
+        /**
+         * @return upper bound of the bucket holding the 99th percentile, max if it is the last bucket
+         * */
+        unsigned long percentile99(const Histogram &histogram) {
+            unsigned long threshold = histogram.count - histogram.count / 100;
+            unsigned long cumulated = 0;
+            for (uint8_t bucket = 0; bucket < PROFILER_BUCKETS - 1; bucket++) {
+                cumulated += histogram.buckets[bucket];
+                if (cumulated >= threshold)
+                    return min(bucketUpperBound_us(bucket), histogram.max_us);
+            }
+            return histogram.max_us;
+        }
+
+        unsigned long average(const Histogram &histogram) {
+            return histogram.count > 0 ? (unsigned long) (histogram.total_us / histogram.count) : 0;
+        }
+
+        void recordStall(unsigned long duration_us) {
+            if (duration_us <= stalls[PROFILER_TOP_STALLS - 1].duration_us)
+                return;
+
+            int8_t position = PROFILER_TOP_STALLS - 1;
+            for (; position > 0 && stalls[position - 1].duration_us < duration_us; position--)
+                stalls[position] = stalls[position - 1];
+
+            Stall &stall = stalls[position];
+            stall.duration_us = duration_us;
+            stall.when_ms = millis();
+            stall.culprit = culprit;
+            stall.culprit_us = culprit_us;
+        }
+
+        void beginLoop() {
+            loopStart_us = micros();
+            lastMark_us = loopStart_us;
+            culprit = Section_Other;
+            culprit_us = 0;
+        }
+
+        void mark(Section section) {
+            unsigned long now_us = micros();
+            unsigned long duration_us = now_us - lastMark_us;
+            lastMark_us = now_us;
+
+            record(sections[section], duration_us);
+            if (duration_us > culprit_us) {
+                culprit = section;
+                culprit_us = duration_us;
+            }
+        }
+
+        void endLoop() {
+            mark(Section_Other);
+            unsigned long duration_us = lastMark_us - loopStart_us;
+            record(loop, duration_us);
+            recordStall(duration_us);
+        }
+
+        void reset() {
+            memset(&loop, 0, sizeof(loop));
+            memset(sections, 0, sizeof(sections));
+            memset(stalls, 0, sizeof(stalls));
+        }
+
+        void executeCliCommand(char *args) {
+            if (strncasecmp_P(args, PSTR("reset;"), 6) == 0)
+                reset();
+
+            sendMsgFromBuffer(); // pbuffer holds a single message
+            display_Header();
+            display_Name(PSTR("PROFILER"));
+            sprintf_P(pbuffer + strlen(pbuffer), PSTR(";LOOPS=%lu;AVG=%lu;P99=%lu;MAX=%lu"),
+                      loop.count, average(loop), percentile99(loop), loop.max_us);
+            display_Footer();
+
+            for (int i = 0; i < Section_EOF; i++) {
+                const Histogram &section = sections[i];
+                if (section.count == 0)
+                    continue;
+                sendMsgFromBuffer();
+                display_Header();
+                display_Name(PSTR("PROFILER"));
+                sprintf_P(pbuffer + strlen(pbuffer), PSTR(";SECTION=%s;AVG=%lu;P99=%lu;MAX=%lu"),
+                          sectionNames[i], average(section), percentile99(section), section.max_us);
+                display_Footer();
+            }
+
+            for (auto &stall : stalls) {
+                if (stall.duration_us == 0)
+                    break;
+                sendMsgFromBuffer();
+                display_Header();
+                display_Name(PSTR("STALL"));
+                sprintf_P(pbuffer + strlen(pbuffer), PSTR(";US=%lu;CULPRIT=%s;CULPRIT_US=%lu;AGE=%lu"),
+                          stall.duration_us, sectionNames[stall.culprit], stall.culprit_us, (millis() - stall.when_ms) / 1000);
+                display_Footer();
+            }
+        }
+
+        void histogramToJson(JsonObject &&output, const Histogram &histogram, bool withBuckets) {
+            output[F("count")] = histogram.count;
+            output[F("last_us")] = histogram.last_us;
+            output[F("avg_us")] = average(histogram);
+            output[F("p99_us")] = percentile99(histogram);
+            output[F("max_us")] = histogram.max_us;
+            if (!withBuckets)
+                return; // status document is shared by all modules, /metrics has them all
+            auto &&buckets = output.createNestedArray("histogram");
+            for (auto bucket : histogram.buckets)
+                buckets.add(bucket);
+        }
+
+        void getStatusJsonString(JsonObject &output) {
+            auto &&profiler = output.createNestedObject("profiler");
+
+            histogramToJson(profiler.createNestedObject("loop"), loop, true);
+
+            auto &&sectionsJson = profiler.createNestedObject("sections");
+            for (int i = 0; i < Section_EOF; i++) {
+                if (sections[i].count > 0)
+                    histogramToJson(sectionsJson.createNestedObject(sectionNames[i]), sections[i], false);
+            }
+
+            auto &&stallsJson = profiler.createNestedArray("stalls");
+            for (auto &stall : stalls) {
+                if (stall.duration_us == 0)
+                    break;
+                auto &&stallJson = stallsJson.createNestedObject();
+                stallJson[F("duration_us")] = stall.duration_us;
+                stallJson[F("culprit")] = sectionNames[stall.culprit];
+                stallJson[F("culprit_us")] = stall.culprit_us;
+                stallJson[F("age_s")] = (millis() - stall.when_ms) / 1000;
+            }
+        }
+
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef _23_Profiler_H_
+#define _23_Profiler_H_
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#define PROFILER_BUCKETS 16         // log2 scale, first one is below 64us, last one is 1s and above
+#define PROFILER_FIRST_BUCKET_US 64
+
+#ifndef PROFILER_TOP_STALLS
+#define PROFILER_TOP_STALLS 8
+#endif
+
+/**
+ * Main loop instrumentation: every subsystem call is timestamped, so each iteration is split into
+ * the time spent by each section of the loop.
+ *
+ * Durations are accumulated in log2 histograms, one for the whole iteration and one per section,
+ * and the slowest iterations are kept along with the section which took most of their time.
+ * It costs one micros() per section.
+ * */
+namespace RFLink {
+    namespace Profiler {
+
+        enum Section {
+            Section_Mqtt,
+            Section_Output,
+            Section_Wifi,
+            Section_Portal,
+            Section_Serial2Net,
+            Section_Serial,
+            Section_Transmit,
+            Section_Batch,
+            Section_Filter,
+            Section_Scan,
+            Section_Log,
+            Section_SerialTx,
+            Section_Other,
+            Section_EOF,
+        };
+
+        struct Histogram {
+            unsigned long buckets[PROFILER_BUCKETS];
+            unsigned long count;
+            unsigned long long total_us;
+            unsigned long last_us;
+            unsigned long max_us;
+        };
+
+        struct Stall {
+            unsigned long duration_us; // whole iteration, 0 for a free slot
+            unsigned long when_ms;     // millis() at end of iteration
+            Section culprit;           // section which took the longest
+            unsigned long culprit_us;
+        };
+
+        extern Histogram loop;
+        extern Histogram sections[Section_EOF];
+        extern Stall stalls[PROFILER_TOP_STALLS]; // slowest first
+
+        extern const char *sectionNames[];
+
+        inline unsigned long bucketUpperBound_us(uint8_t bucket) {
+            return (unsigned long) PROFILER_FIRST_BUCKET_US << bucket;
+        }
+
+        /**
+         * Call first thing in the main loop
+         * */
+        void beginLoop();
+        /**
+         * Time since previous mark (or beginLoop) is accounted to this section
+         * */
+        void mark(Section section);
+        /**
+         * Call last thing in the main loop, remaining time goes to Section_Other
+         * */
+        void endLoop();
+
+        void reset();
+
+        /**
+         * @param args the part following "10;profiler;"
+         * */
+        void executeCliCommand(char *args);
+
+        void getStatusJsonString(JsonObject &output);
+    }
+}
+
+#endif // _23_Profiler_H_
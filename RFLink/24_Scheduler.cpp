@@ -0,0 +1,197 @@
+#include <Arduino.h>
+#include "RFLink.h"
+#include "4_Display.h"
+#include "24_Scheduler.h"
+
+namespace RFLink {
+    namespace Scheduler {
+
+        namespace counters {
+            unsigned long int passes = 0;
+            unsigned long int rxInterleaved = 0;
+            unsigned long int rxLate = 0;
+            unsigned long int rxMaxInterval_ms = 0;
+        }
+
+        Task *tasks[SCHEDULER_MAX_TASKS]; // by priority
+        uint8_t tasksCount = 0;
+        Task *receiver = nullptr;
+
+        unsigned long lastRx_ms = 0;
+        unsigned long countersReset_ms = 0;
+
+        Task::Task(const char *name, void (*run)(), unsigned long period_ms, uint8_t priority, unsigned long budget_us,
+                   Profiler::Section section) :
+                name(name), run(run), period_ms(period_ms), priority(priority), budget_us(budget_us), section(section),
+                nextRun_ms(0), runs(0), overruns(0), maxRun_us(0), totalRun_us(0) {}
+
+        bool registerTask(Task *task) {
+            for (uint8_t i = 0; i < tasksCount; i++) {
+                if (tasks[i] == task)
+                    return true;
+            }
+            if (tasksCount >= SCHEDULER_MAX_TASKS)
+                return false;
+
+            uint8_t position = tasksCount;
+            for (; position > 0 && tasks[position - 1]->priority > task->priority; position--)
+                tasks[position] = tasks[position - 1];
+            tasks[position] = task;
+            tasksCount++;
+            return true;
+        }
+
+        void unregisterTask(Task *task) {
+            for (uint8_t i = 0; i < tasksCount; i++) {
+                if (tasks[i] != task)
+                    continue;
+                for (; i + 1 < tasksCount; i++)
+                    tasks[i] = tasks[i + 1];
+                tasksCount--;
+                return;
+            }
+        }
+
+        void setReceiverTask(Task *task) {
+            receiver = task;
+        }
+
+        void runTask(Task *task) {
+            unsigned long start_us = micros();
+            task->run();
+            unsigned long duration_us = micros() - start_us;
+            Profiler::mark(task->section);
+
+            task->runs++;
+            task->totalRun_us += duration_us;
+            if (duration_us > task->maxRun_us)
+                task->maxRun_us = duration_us;
+            if (duration_us > task->budget_us)
+                task->overruns++;
+        }
+
+        void runReceiver() {
+            unsigned long interval_ms = millis() - lastRx_ms;
+            if (interval_ms > counters::rxMaxInterval_ms)
+                counters::rxMaxInterval_ms = interval_ms;
+            if (interval_ms > SCHEDULER_RX_MAX_INTERVAL_MS)
+                counters::rxLate++;
+
+            runTask(receiver);
+            lastRx_ms = millis();
+        }
+
+        void mainLoop() {
+            Profiler::beginLoop();
+            counters::passes++;
+
+            unsigned long now_ms = millis();
+            for (uint8_t i = 0; i < tasksCount; i++) {
+                Task *task = tasks[i];
+                if (task->period_ms != 0 && (long) (now_ms - task->nextRun_ms) < 0)
+                    continue;
+
+                if (receiver != nullptr && millis() - lastRx_ms >= SCHEDULER_RX_MAX_INTERVAL_MS) {
+                    counters::rxInterleaved++;
+                    runReceiver();
+                }
+
+                runTask(task);
+                if (tasks[i] != task) // unregistered itself, next one took its place
+                    i--;
+
+                // keep the cadence, unless we are so late that it would fire again right away
+                task->nextRun_ms += task->period_ms;
+                if ((long) (millis() - task->nextRun_ms) >= 0)
+                    task->nextRun_ms = millis() + task->period_ms;
+            }
+
+            if (receiver != nullptr)
+                runReceiver();
+
+            Profiler::endLoop();
+        }
+
+        void resetCounters() {
+            counters::passes = 0;
+            counters::rxInterleaved = 0;
+            counters::rxLate = 0;
+            counters::rxMaxInterval_ms = 0;
+            for (uint8_t i = 0; i < tasksCount; i++) {
+                tasks[i]->runs = 0;
+                tasks[i]->overruns = 0;
+                tasks[i]->maxRun_us = 0;
+                tasks[i]->totalRun_us = 0;
+            }
+            if (receiver != nullptr) {
+                receiver->runs = 0;
+                receiver->overruns = 0;
+                receiver->maxRun_us = 0;
+                receiver->totalRun_us = 0;
+            }
+            countersReset_ms = millis();
+        }
+
+        /**
+         * @return per thousand of the time spent in the receiver since boot or last reset
+         * */
+        unsigned long rxDutyCycle() {
+            unsigned long elapsed_ms = millis() - countersReset_ms;
+            if (receiver == nullptr || elapsed_ms == 0)
+                return 0;
+            return (unsigned long) (receiver->totalRun_us / elapsed_ms);
+        }
+
+        void displayTask(const Task *task) {
+            sendMsgFromBuffer();
+            display_Header();
+            display_Name(PSTR("TASK"));
+            sprintf_P(pbuffer + strlen(pbuffer), PSTR(";NAME=%s;RUNS=%lu;OVERRUNS=%lu;MAX=%lu"),
+                      task->name, task->runs, task->overruns, task->maxRun_us);
+            display_Footer();
+        }
+
+        void executeCliCommand(char *args) {
+            if (strncasecmp_P(args, PSTR("reset;"), 6) == 0)
+                resetCounters();
+
+            sendMsgFromBuffer(); // pbuffer holds a single message
+            display_Header();
+            display_Name(PSTR("SCHEDULER"));
+            sprintf_P(pbuffer + strlen(pbuffer), PSTR(";PASSES=%lu;RX_DUTY=%lu;RX_LATE=%lu;RX_MAX_INTERVAL=%lu"),
+                      counters::passes, rxDutyCycle(), counters::rxLate, counters::rxMaxInterval_ms);
+            display_Footer();
+
+            for (uint8_t i = 0; i < tasksCount; i++)
+                displayTask(tasks[i]);
+            if (receiver != nullptr)
+                displayTask(receiver);
+        }
+
+        void taskToJson(JsonObject &&output, const Task *task) {
+            output[F("period_ms")] = task->period_ms;
+            output[F("priority")] = task->priority;
+            output[F("budget_us")] = task->budget_us;
+            output[F("runs")] = task->runs;
+            output[F("overruns")] = task->overruns;
+            output[F("max_us")] = task->maxRun_us;
+        }
+
+        void getStatusJsonString(JsonObject &output) {
+            auto &&scheduler = output.createNestedObject("scheduler");
+
+            scheduler[F("passes")] = counters::passes;
+            scheduler[F("rx_duty_permille")] = rxDutyCycle();
+            scheduler[F("rx_interleaved")] = counters::rxInterleaved;
+            scheduler[F("rx_late")] = counters::rxLate;
+            scheduler[F("rx_max_interval_ms")] = counters::rxMaxInterval_ms;
+
+            auto &&tasksJson = scheduler.createNestedObject("tasks");
+            for (uint8_t i = 0; i < tasksCount; i++)
+                taskToJson(tasksJson.createNestedObject(tasks[i]->name), tasks[i]);
+            if (receiver != nullptr)
+                taskToJson(tasksJson.createNestedObject(receiver->name), receiver);
+        }
+
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef _24_Scheduler_H_
+#define _24_Scheduler_H_
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "23_Profiler.h"
+
+#ifndef SCHEDULER_MAX_TASKS
+#define SCHEDULER_MAX_TASKS 16
+#endif
+
+#ifndef SCHEDULER_RX_MAX_INTERVAL_MS
+#define SCHEDULER_RX_MAX_INTERVAL_MS 20 // receiver is serviced at least this often, between tasks if needed
+#endif
+
+/**
+ * Cooperative scheduler for the main loop.
+ *
+ * Each subsystem registers a task with a period, a priority and a time budget. Every pass runs the tasks
+ * which are due, by priority, then the receiver. Before each task, if the receiver was not serviced for
+ * SCHEDULER_RX_MAX_INTERVAL_MS, it runs first: a slow network task delays the next task, not RF capture.
+ *
+ * Nothing is preempted, a task running longer than its budget is only counted as an overrun
+ * (and shows up in the profiler stalls).
+ * */
+namespace RFLink {
+    namespace Scheduler {
+
+        struct Task {
+            const char *name;
+            void (*run)();
+            unsigned long period_ms;   // 0 means every pass
+            uint8_t priority;          // 0 runs first
+            unsigned long budget_us;
+            Profiler::Section section;
+
+            // owned by the scheduler
+            unsigned long nextRun_ms;
+            unsigned long runs;
+            unsigned long overruns;
+            unsigned long maxRun_us;
+            unsigned long long totalRun_us;
+
+            Task(const char *name, void (*run)(), unsigned long period_ms, uint8_t priority, unsigned long budget_us,
+                 Profiler::Section section);
+        };
+
+        namespace counters {
+            extern unsigned long int passes;
+            extern unsigned long int rxInterleaved; // receiver serviced between two tasks
+            extern unsigned long int rxLate;        // receiver serviced after more than SCHEDULER_RX_MAX_INTERVAL_MS
+            extern unsigned long int rxMaxInterval_ms;
+        }
+
+        /**
+         * Task must outlive the scheduler (static storage), tasks of same priority run in registration order
+         * @return false if too many tasks
+         * */
+        bool registerTask(Task *task);
+        /**
+         * A task may unregister itself while it runs, ie once its job is done
+         * */
+        void unregisterTask(Task *task);
+        /**
+         * The receiver task is not part of the priority list, it runs last and whenever it is overdue
+         * */
+        void setReceiverTask(Task *task);
+
+        /**
+         * Runs one pass, this is your main loop
+         * */
+        void mainLoop();
+
+        void resetCounters();
+
+        /**
+         * @param args the part following "10;scheduler;"
+         * */
+        void executeCliCommand(char *args);
+
+        void getStatusJsonString(JsonObject &output);
+    }
+}
+
+#endif // _24_Scheduler_H_
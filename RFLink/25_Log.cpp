@@ -0,0 +1,305 @@
+#include <Arduino.h>
+#include "RFLink.h"
+#include "4_Display.h"
+#include "25_Log.h"
+#include "26_SerialTx.h"
+
+namespace RFLink {
+    namespace Log {
+
+        namespace counters {
+            unsigned long int entries = 0;
+            unsigned long int lost = 0;
+            unsigned long int truncated = 0;
+        }
+
+        namespace params {
+            bool serialEnabled = true;
+        }
+
+        const char *levelNames[] = {
+                "none",
+                "error",
+                "warning",
+                "info",
+                "debug",
+                "EOF" // matches Level::Level_EOF
+        };
+        static_assert(sizeof(levelNames) / sizeof(char *) == Level::Level_EOF + 1, "levelNames has missing/extra names, please compare with Level enum declarations");
+
+        const char *moduleNames[] = {
+                "core",
+                "config",
+                "signal",
+                "radio",
+                "wifi",
+                "mqtt",
+                "portal",
+                "serial2net",
+                "serial",
+                "ota",
+                "EOF" // matches Module::Module_EOF
+        };
+        static_assert(sizeof(moduleNames) / sizeof(char *) == Module::Module_EOF + 1, "moduleNames has missing/extra names, please compare with Module enum declarations");
+
+        // until config is loaded
+        uint8_t levels[Module_EOF] = {Level_Info, Level_Info, Level_Info, Level_Info, Level_Info,
+                                      Level_Info, Level_Info, Level_Info, Level_Info, Level_Info};
+        static_assert(Module_EOF == 10, "levels initializer must have one value per module");
+
+        // All json variable names
+        const char json_name_levels[] = "levels";
+        const char json_name_serial_enabled[] = "serial_enabled";
+
+        enum ConfigItemIndex {
+            ConfigItem_Levels,
+            ConfigItem_SerialEnabled,
+            ConfigItem_EOF,
+        };
+
+        Config::ConfigItem configItems[] = {
+                Config::ConfigItem(json_name_levels, Config::SectionId::Log_id, "*=info", paramsUpdatedCallback),
+                Config::ConfigItem(json_name_serial_enabled, Config::SectionId::Log_id, true, paramsUpdatedCallback),
+                Config::ConfigItem() // dont remove it!
+        };
+        static_assert(sizeof(configItems) / sizeof(Config::ConfigItem) == ConfigItem_EOF + 1, "configItems has missing/extra items, please compare with ConfigItemIndex enum declarations");
+
+        struct Entry {
+            unsigned long seq; // 0 for a free slot
+            unsigned long ms;
+            uint8_t module;
+            uint8_t level;
+            char text[LOG_LINE_SIZE + 2]; // + end of line, added when written
+        };
+
+        Entry ring[LOG_ENTRIES]; // seq n lives in slot n % LOG_ENTRIES
+        unsigned long nextSeq = 1;
+        unsigned long drainSeq = 1; // next one to write to Serial
+
+#ifdef ESP32
+        // web server handlers log from another task
+        portMUX_TYPE ringMux = portMUX_INITIALIZER_UNLOCKED;
+#define LOG_LOCK portENTER_CRITICAL(&ringMux)
+#define LOG_UNLOCK portEXIT_CRITICAL(&ringMux)
+#else
+        // async web server callbacks run from the SDK, they must not interleave with the main loop
+        uint32_t ringSavedPS;
+#define LOG_LOCK ringSavedPS = xt_rsil(15)
+#define LOG_UNLOCK xt_wsr_ps(ringSavedPS)
+#endif
+
+        void printf(Module module, Level level, PGM_P format, ...) {
+            if (!enabled(module, level))
+                return;
+
+            char text[LOG_LINE_SIZE];
+            va_list args;
+            va_start(args, format);
+            int length = vsnprintf_P(text, sizeof(text), format, args);
+            va_end(args);
+            if (length < 0)
+                return;
+
+            // lines are stored without their end of line, we add our own when writing
+            size_t stored = strlen(text);
+            while (stored > 0 && (text[stored - 1] == '\r' || text[stored - 1] == '\n'))
+                text[--stored] = 0;
+
+            LOG_LOCK;
+            Entry &entry = ring[nextSeq % LOG_ENTRIES];
+            entry.seq = nextSeq++;
+            entry.ms = millis();
+            entry.module = module;
+            entry.level = level;
+            memcpy(entry.text, text, stored + 1);
+            counters::entries++;
+            if ((size_t) length >= sizeof(text))
+                counters::truncated++;
+            LOG_UNLOCK;
+        }
+
+        /**
+         * @return false if this entry was overwritten or not written yet
+         * */
+        bool copyEntry(unsigned long seq, Entry &copy) {
+            LOG_LOCK;
+            copy = ring[seq % LOG_ENTRIES];
+            LOG_UNLOCK;
+            return copy.seq == seq;
+        }
+
+        /**
+         * @return false when nothing could be written
+         * */
+        bool drainOne(bool blocking) {
+            Entry entry;
+
+            LOG_LOCK;
+            unsigned long head = nextSeq;
+            if (head - drainSeq > LOG_ENTRIES) {
+                counters::lost += head - drainSeq - LOG_ENTRIES;
+                drainSeq = head - LOG_ENTRIES;
+            }
+            LOG_UNLOCK;
+
+            if (drainSeq == head)
+                return false;
+            if (!copyEntry(drainSeq, entry))
+                return true; // overwritten meanwhile, accounted for at next call
+
+            size_t length = strlen(entry.text);
+            if (SerialTx::available(SerialTx::Class_Debug) < length + 2) {
+                if (!blocking)
+                    return false; // stays here until there is room, rather than being dropped by SerialTx
+                SerialTx::flush();
+            }
+
+            memcpy(entry.text + length, "\r\n", 2); // Entry::text keeps room for it
+            SerialTx::write(entry.text, length + 2, SerialTx::Class_Debug);
+            drainSeq++;
+            return true;
+        }
+
+        void mainLoop() {
+            if (!params::serialEnabled) {
+                drainSeq = nextSeq;
+                return;
+            }
+            for (uint8_t i = 0; i < LOG_MAX_WRITES_PER_LOOP; i++) {
+                if (!drainOne(false))
+                    break;
+            }
+        }
+
+        void flush() {
+            if (!params::serialEnabled)
+                return;
+            while (drainOne(true));
+        }
+
+        int findName(const char *names[], int count, const char *name, size_t length) {
+            for (int i = 0; i < count; i++) {
+                if (strlen(names[i]) == length && strncasecmp(names[i], name, length) == 0)
+                    return i;
+            }
+            return -1;
+        }
+
+        /**
+         * Applies "module=level" or "*=level"
+         * @return false if module or level is unknown
+         * */
+        bool setLevel(const char *setting, size_t length) {
+            const char *separator = (const char *) memchr(setting, '=', length);
+            if (separator == nullptr)
+                return false;
+
+            int level = findName(levelNames, Level_EOF, separator + 1, setting + length - separator - 1);
+            if (level < 0)
+                return false;
+
+            size_t moduleLength = separator - setting;
+            if (moduleLength == 1 && *setting == '*') {
+                for (auto &moduleLevel : levels)
+                    moduleLevel = level;
+                return true;
+            }
+
+            int module = findName(moduleNames, Module_EOF, setting, moduleLength);
+            if (module < 0)
+                return false;
+            levels[module] = level;
+            return true;
+        }
+
+        void paramsUpdatedCallback() {
+            refreshParametersFromConfig();
+        }
+
+        void refreshParametersFromConfig(bool triggerChanges) {
+            Config::ConfigItem *item;
+
+            item = &configItems[ConfigItem_Levels];
+            for (auto &moduleLevel : levels)
+                moduleLevel = Level_Info;
+            const char *setting = item->getCharValue();
+            while (*setting != 0) {
+                const char *end = strchr(setting, ',');
+                if (end == nullptr)
+                    end = setting + strlen(setting);
+                if (!setLevel(setting, end - setting))
+                    Log::printf(Log::Module_Core, Log::Level_Warning, PSTR("Log: invalid level setting '%.*s', ignored"), (int) (end - setting), setting);
+                setting = *end == ',' ? end + 1 : end;
+            }
+
+            item = &configItems[ConfigItem_SerialEnabled];
+            params::serialEnabled = item->getBoolValue();
+        }
+
+        void setup() {
+            refreshParametersFromConfig(false);
+        }
+
+        void executeCliCommand(char *args) {
+            char *end = strchr(args, ';');
+            if (end != nullptr && end != args) {
+                if (!setLevel(args, end - args)) {
+                    display_Header();
+                    display_Name(PSTR("LOG"));
+                    display_Name(PSTR("CMD UNKNOWN"));
+                    display_Footer();
+                    return;
+                }
+            }
+
+            display_Header();
+            display_Name(PSTR("LOG"));
+            sprintf_P(pbuffer + strlen(pbuffer), PSTR(";ENTRIES=%lu;LOST=%lu"), counters::entries, counters::lost);
+            display_Footer();
+        }
+
+        void printJsonString(Print &output, const char *text) {
+            output.print('"');
+            for (; *text != 0; text++) {
+                if (*text == '"' || *text == '\\') {
+                    output.print('\\');
+                    output.print(*text);
+                } else if ((uint8_t) *text < 0x20)
+                    output.printf_P(PSTR("\\u%04x"), (uint8_t) *text);
+                else
+                    output.print(*text);
+            }
+            output.print('"');
+        }
+
+        void printLogJson(Print &output, unsigned long sinceSeq) {
+            Entry entry;
+            unsigned long head = nextSeq;
+            unsigned long seq = head > LOG_ENTRIES ? head - LOG_ENTRIES : 1;
+            if (sinceSeq > seq)
+                seq = sinceSeq;
+            bool first = true;
+
+            output.printf_P(PSTR("{\"next\":%lu,\"entries\":["), head);
+            for (; seq < head; seq++) {
+                if (!copyEntry(seq, entry))
+                    continue;
+                output.printf_P(PSTR("%s{\"seq\":%lu,\"ms\":%lu,\"module\":\"%s\",\"level\":\"%s\",\"text\":"),
+                                first ? "" : ",", entry.seq, entry.ms, moduleNames[entry.module], levelNames[entry.level]);
+                printJsonString(output, entry.text);
+                output.print('}');
+                first = false;
+            }
+            output.print(F("]}"));
+        }
+
+        void getStatusJsonString(JsonObject &output) {
+            auto &&log = output.createNestedObject("log");
+            log[F("entries")] = counters::entries;
+            log[F("lost")] = counters::lost;
+            log[F("truncated")] = counters::truncated;
+            log[F("serial_enabled")] = params::serialEnabled;
+        }
+
+    }
+}
@@ -0,0 +1,106 @@
+#ifndef _25_Log_H_
+#define _25_Log_H_
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "11_Config.h"
+
+#ifndef LOG_ENTRIES
+#if defined(ESP32)
+#define LOG_ENTRIES 64 // recent entries kept in RAM
+#else
+#define LOG_ENTRIES 16
+#endif
+#endif
+
+#ifndef LOG_LINE_SIZE
+#define LOG_LINE_SIZE 96 // longer lines are truncated
+#endif
+
+#ifndef LOG_MAX_WRITES_PER_LOOP
+#define LOG_MAX_WRITES_PER_LOOP 4
+#endif
+
+/**
+ * Leveled logging into a RAM ring, so diagnostics never wait for the UART.
+ *
+ * Entries below the level of their module are discarded right away. Others are formatted into the ring,
+ * which mainLoop() drains to SerialTx when it has room. When the ring is full the oldest entries are
+ * overwritten, whether they were drained or not (and counted as lost).
+ * Recent entries can be fetched from /api/log.
+ *
+ * Levels are configured per module in section "log", ie "levels":"*=info,mqtt=debug"
+ * */
+namespace RFLink {
+    namespace Log {
+
+        extern Config::ConfigItem configItems[];
+
+        enum Level {
+            Level_None,
+            Level_Error,
+            Level_Warning,
+            Level_Info,
+            Level_Debug,
+            Level_EOF,
+        };
+
+        enum Module {
+            Module_Core,
+            Module_Config,
+            Module_Signal,
+            Module_Radio,
+            Module_Wifi,
+            Module_Mqtt,
+            Module_Portal,
+            Module_Serial2Net,
+            Module_Serial,
+            Module_Ota,
+            Module_EOF,
+        };
+
+        namespace counters {
+            extern unsigned long int entries;
+            extern unsigned long int lost;       // overwritten before they could be written to Serial
+            extern unsigned long int truncated;
+        }
+
+        extern uint8_t levels[Module_EOF];
+
+        inline bool enabled(Module module, Level level) {
+            return level <= levels[module];
+        }
+
+        /**
+         * printf like, format lives in flash (PSTR). Safe from any task, not from an interrupt
+         * */
+        void printf(Module module, Level level, PGM_P format, ...) __attribute__((format(printf, 3, 4)));
+
+        void setup();
+        /**
+         * Include in your main loop, it writes pending entries to Serial without blocking
+         * */
+        void mainLoop();
+        /**
+         * Writes every pending entry to Serial, blocking, ie before a reboot
+         * */
+        void flush();
+
+        void paramsUpdatedCallback();
+        void refreshParametersFromConfig(bool triggerChanges = true);
+
+        /**
+         * @param args the part following "10;log;"
+         * */
+        void executeCliCommand(char *args);
+
+        /**
+         * JSON object with kept entries from sinceSeq, and "next" to pass as sinceSeq next time. For the web API
+         * */
+        void printLogJson(Print &output, unsigned long sinceSeq);
+
+        void getStatusJsonString(JsonObject &output);
+    }
+}
+
+#endif // _25_Log_H_
@@ -0,0 +1,167 @@
+#include <Arduino.h>
+#include "RFLink.h"
+#include "25_Log.h"
+#include "26_SerialTx.h"
+
+namespace RFLink {
+    namespace SerialTx {
+
+        namespace counters {
+            unsigned long int bytesWritten = 0;
+            unsigned long int droppedBytes = 0;
+            unsigned long int droppedLines = 0;
+            unsigned long int blockedWrites = 0;
+            unsigned long int maxUsed = 0;
+        }
+
+        namespace params {
+            Policy policy = Policy_DropDebug;
+        }
+
+        const char *policyNames[] = {
+                "drop_debug",
+                "block",
+                "drop",
+                "EOF" // matches Policy::Policy_EOF
+        };
+        static_assert(sizeof(policyNames) / sizeof(char *) == Policy::Policy_EOF + 1, "policyNames has missing/extra names, please compare with Policy enum declarations");
+
+        // All json variable names
+        const char json_name_tx_policy[] = "tx_policy";
+
+        enum ConfigItemIndex {
+            ConfigItem_TxPolicy,
+            ConfigItem_EOF,
+        };
+
+        Config::ConfigItem configItems[] = {
+                Config::ConfigItem(json_name_tx_policy, Config::SectionId::Serial_id, policyNames[Policy_DropDebug], paramsUpdatedCallback),
+                Config::ConfigItem() // dont remove it!
+        };
+        static_assert(sizeof(configItems) / sizeof(Config::ConfigItem) == ConfigItem_EOF + 1, "configItems has missing/extra items, please compare with ConfigItemIndex enum declarations");
+
+        char ring[SERIAL_TX_BUFFER_SIZE];
+        size_t head = 0; // next byte to write
+        size_t tail = 0; // next byte to send
+        size_t count = 0;
+
+        size_t available(Class dataClass) {
+            size_t room = SERIAL_TX_BUFFER_SIZE - count;
+            if (dataClass == Class_Debug && params::policy == Policy_DropDebug)
+                room = room > SERIAL_TX_DEBUG_RESERVE ? room - SERIAL_TX_DEBUG_RESERVE : 0;
+            return room;
+        }
+
+        size_t used() {
+            return count;
+        }
+
+        void poll() {
+            while (count > 0) {
+                int room = Serial.availableForWrite();
+                if (room <= 0)
+                    return;
+
+                size_t length = SERIAL_TX_BUFFER_SIZE - tail; // contiguous part
+                if (length > count)
+                    length = count;
+                if (length > (size_t) room)
+                    length = room;
+
+                Serial.write((const uint8_t *) ring + tail, length);
+                tail = (tail + length) % SERIAL_TX_BUFFER_SIZE;
+                count -= length;
+                counters::bytesWritten += length;
+            }
+        }
+
+        void flush() {
+            while (count > 0) {
+                poll();
+                if (count > 0)
+                    yield();
+            }
+        }
+
+        void waitForRoom(size_t length) {
+            counters::blockedWrites++;
+            while (SERIAL_TX_BUFFER_SIZE - count < length) {
+                poll();
+                if (SERIAL_TX_BUFFER_SIZE - count < length)
+                    yield();
+            }
+        }
+
+        bool write(const char *data, size_t length, Class dataClass) {
+            if (length > SERIAL_TX_BUFFER_SIZE)
+                length = SERIAL_TX_BUFFER_SIZE;
+
+            poll(); // make room while we are here
+
+            if (available(dataClass) < length) {
+                bool mustWait = dataClass == Class_Message || params::policy == Policy_Block;
+                if (!mustWait) {
+                    counters::droppedBytes += length;
+                    counters::droppedLines++;
+                    return false;
+                }
+                waitForRoom(length);
+            }
+
+            size_t first = SERIAL_TX_BUFFER_SIZE - head;
+            if (first > length)
+                first = length;
+            memcpy(ring + head, data, first);
+            memcpy(ring, data + first, length - first);
+            head = (head + length) % SERIAL_TX_BUFFER_SIZE;
+            count += length;
+            if (count > counters::maxUsed)
+                counters::maxUsed = count;
+
+            poll();
+            return true;
+        }
+
+        Policy policyFromString(const char *name) {
+            for (int i = 0; i < Policy_EOF; i++) {
+                if (strcmp(policyNames[i], name) == 0)
+                    return (Policy) i;
+            }
+            return Policy_EOF;
+        }
+
+        void paramsUpdatedCallback() {
+            refreshParametersFromConfig();
+        }
+
+        void refreshParametersFromConfig(bool triggerChanges) {
+            Config::ConfigItem *item;
+
+            item = &configItems[ConfigItem_TxPolicy];
+            Policy policy = policyFromString(item->getCharValue());
+            if (policy == Policy_EOF) {
+                Log::printf(Log::Module_Serial, Log::Level_Warning, PSTR("Serial: unsupported tx_policy '%s', falling back to '%s'"), item->getCharValue(), policyNames[Policy_DropDebug]);
+                policy = Policy_DropDebug;
+                item->setCharValue(policyNames[policy]);
+            }
+            params::policy = policy;
+        }
+
+        void setup() {
+            refreshParametersFromConfig(false);
+        }
+
+        void getStatusJsonString(JsonObject &output) {
+            auto &&serial = output.createNestedObject("serial_tx");
+            serial[F("policy")] = policyNames[params::policy];
+            serial[F("buffer_size")] = SERIAL_TX_BUFFER_SIZE;
+            serial[F("used")] = count;
+            serial[F("max_used")] = counters::maxUsed;
+            serial[F("bytes_written")] = counters::bytesWritten;
+            serial[F("dropped_bytes")] = counters::droppedBytes;
+            serial[F("dropped_lines")] = counters::droppedLines;
+            serial[F("blocked_writes")] = counters::blockedWrites;
+        }
+
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef _26_SerialTx_H_
+#define _26_SerialTx_H_
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "11_Config.h"
+
+#ifndef SERIAL_TX_BUFFER_SIZE
+#if defined(ESP32)
+#define SERIAL_TX_BUFFER_SIZE 4096
+#else
+#define SERIAL_TX_BUFFER_SIZE 1024
+#endif
+#endif
+
+#define SERIAL_TX_DEBUG_RESERVE (SERIAL_TX_BUFFER_SIZE / 4) // debug output never eats into this, it is kept for messages
+
+/**
+ * Transmit ring for the host serial link: writers copy into RAM and return, the UART FIFO is refilled
+ * by poll() from the scheduler and from the receiver while it waits for a signal.
+ *
+ * Output is either a decoded message or debug (raw output, log entries). When the ring is short of room:
+ * - drop_debug: debug lines are dropped as soon as they would use the last quarter, messages wait for room
+ * - block: everything waits for room, this was the behaviour of a plain Serial.print
+ * - drop: debug output which does not fit is dropped, even into the last quarter, for hosts which prefer latency
+ * Messages are never dropped, whatever the policy.
+ *
+ * Anything else must go through Log (or the Output bus), a direct Serial write would land in the middle
+ * of a line being drained.
+ * */
+namespace RFLink {
+    namespace SerialTx {
+
+        extern Config::ConfigItem configItems[];
+
+        enum Class {
+            Class_Message,
+            Class_Debug,
+        };
+
+        enum Policy {
+            Policy_DropDebug,
+            Policy_Block,
+            Policy_Drop,
+            Policy_EOF,
+        };
+
+        namespace counters {
+            extern unsigned long int bytesWritten;   // to the UART
+            extern unsigned long int droppedBytes;
+            extern unsigned long int droppedLines;
+            extern unsigned long int blockedWrites;  // had to wait for room
+            extern unsigned long int maxUsed;
+        }
+
+        void setup();
+
+        /**
+         * Moves as much as the UART FIFO can take, never blocks
+         * */
+        void poll();
+        /**
+         * Waits until everything went out, ie before a reboot
+         * */
+        void flush();
+
+        /**
+         * @return room a write of this class can use right now, in bytes
+         * */
+        size_t available(Class dataClass = Class_Message);
+        size_t used();
+
+        /**
+         * Writes all or nothing, according to the policy
+         * @return false if dropped
+         * */
+        bool write(const char *data, size_t length, Class dataClass);
+
+        void paramsUpdatedCallback();
+        void refreshParametersFromConfig(bool triggerChanges = true);
+
+        void getStatusJsonString(JsonObject &output);
+    }
+}
+
+#endif // _26_SerialTx_H_
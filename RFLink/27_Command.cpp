@@ -0,0 +1,319 @@
+#include <Arduino.h>
+#include "RFLink.h"
+#include "2_Signal.h"
+#include "4_Display.h"
+#include "5_Plugin.h"
+#include "11_Config.h"
+#include "14_Transmit.h"
+#include "16_Batch.h"
+#include "17_Output.h"
+#include "20_Devices.h"
+#include "21_Filter.h"
+#include "23_Profiler.h"
+#include "24_Scheduler.h"
+#include "25_Log.h"
+#include "27_Command.h"
+
+namespace RFLink {
+    namespace Command {
+
+        namespace counters {
+            unsigned long int commands[Source_EOF] = {0};
+            unsigned long int unknown = 0;
+            unsigned long int txDeferred = 0;
+            unsigned long int txBusy = 0;
+        }
+
+        const char *sourceNames[] = {
+                "serial",
+                "mqtt",
+                "serial2net",
+                "websocket",
+                "http",
+                "EOF" // matches Source::Source_EOF
+        };
+        static_assert(sizeof(sourceNames) / sizeof(char *) == Source::Source_EOF + 1, "sourceNames has missing/extra names, please compare with Source enum declarations");
+
+        enum Keyword {
+            Keyword_Ping,
+            Keyword_Reboot,
+            Keyword_RfDebug,
+            Keyword_RfuDebug,
+            Keyword_QrfDebug,
+            Keyword_QrfuDebug,
+            Keyword_Version,
+            Keyword_Batch,
+            Keyword_Devices,
+            Keyword_Filter,
+            Keyword_Profiler,
+            Keyword_Scheduler,
+            Keyword_Log,
+            Keyword_Signal,
+            Keyword_Config,
+            Keyword_EOF, // not a keyword, should be a protocol name
+        };
+
+        constexpr const char *keywordNames[] = {
+                "ping",
+                "reboot",
+                "rfdebug",
+                "rfudebug",
+                "qrfdebug",
+                "qrfudebug",
+                "version",
+                "batch",
+                "devices",
+                "filter",
+                "profiler",
+                "scheduler",
+                "log",
+                "signal",
+                "config",
+                "EOF" // matches Keyword::Keyword_EOF
+        };
+        static_assert(sizeof(keywordNames) / sizeof(char *) == Keyword::Keyword_EOF + 1, "keywordNames has missing/extra names, please compare with Keyword enum declarations");
+
+        const Context *currentContext = nullptr;
+
+        char txQueue[COMMAND_TX_QUEUE_SIZE][RETRIEVE_BUFFER_SIZE];
+        uint8_t txQueueHead = 0;
+        uint8_t txQueueCount = 0;
+
+        uint32_t hashKeyword(const char *keyword, size_t length) {
+            uint32_t hash = 2166136261UL;
+            for (size_t i = 0; i < length; i++)
+                hash = (hash ^ lowerCase(keyword[i])) * 16777619UL;
+            return hash;
+        }
+
+        Keyword findKeyword(const char *keyword, size_t length) {
+            Keyword found;
+
+            // two keywords with the same hash would not compile
+            switch (hashKeyword(keyword, length)) {
+                case keywordHash(keywordNames[Keyword_Ping]): found = Keyword_Ping; break;
+                case keywordHash(keywordNames[Keyword_Reboot]): found = Keyword_Reboot; break;
+                case keywordHash(keywordNames[Keyword_RfDebug]): found = Keyword_RfDebug; break;
+                case keywordHash(keywordNames[Keyword_RfuDebug]): found = Keyword_RfuDebug; break;
+                case keywordHash(keywordNames[Keyword_QrfDebug]): found = Keyword_QrfDebug; break;
+                case keywordHash(keywordNames[Keyword_QrfuDebug]): found = Keyword_QrfuDebug; break;
+                case keywordHash(keywordNames[Keyword_Version]): found = Keyword_Version; break;
+                case keywordHash(keywordNames[Keyword_Batch]): found = Keyword_Batch; break;
+                case keywordHash(keywordNames[Keyword_Devices]): found = Keyword_Devices; break;
+                case keywordHash(keywordNames[Keyword_Filter]): found = Keyword_Filter; break;
+                case keywordHash(keywordNames[Keyword_Profiler]): found = Keyword_Profiler; break;
+                case keywordHash(keywordNames[Keyword_Scheduler]): found = Keyword_Scheduler; break;
+                case keywordHash(keywordNames[Keyword_Log]): found = Keyword_Log; break;
+                case keywordHash(keywordNames[Keyword_Signal]): found = Keyword_Signal; break;
+                case keywordHash(keywordNames[Keyword_Config]): found = Keyword_Config; break;
+                default:
+                    return Keyword_EOF;
+            }
+
+            // same hash is not same name, ie a protocol name
+            if (strlen(keywordNames[found]) != length || strncasecmp(keywordNames[found], keyword, length) != 0)
+                return Keyword_EOF;
+            return found;
+        }
+
+        /**
+         * "10;RFDEBUG=ON;" enables one debug mode and disables the others, "=OFF" only disables it
+         * */
+        void setDebug(boolean &mode, bool on, PGM_P name) {
+            if (on) {
+                RFDebug = false;
+                QRFDebug = false;
+                RFUDebug = false;
+                QRFUDebug = false;
+            }
+            mode = on;
+
+            display_Header();
+            display_Name(name);
+            strcat_P(pbuffer, on ? PSTR("=ON") : PSTR("=OFF"));
+            display_Footer();
+        }
+
+        /**
+         * Keeps a TX command until the transmitter has room for its frames
+         * @return false if it does not fit
+         * */
+        bool deferTx(const char *cmd) {
+            if (txQueueCount >= COMMAND_TX_QUEUE_SIZE || strlen(cmd) >= RETRIEVE_BUFFER_SIZE)
+                return false;
+            strcpy(txQueue[(txQueueHead + txQueueCount) % COMMAND_TX_QUEUE_SIZE], cmd);
+            txQueueCount++;
+            counters::txDeferred++;
+            return true;
+        }
+
+        /**
+         * @return false if no one knows this command
+         * */
+        bool dispatch(char *cmd) {
+            char *keyword = cmd + 3;
+            size_t length = strcspn(keyword, ";=");
+            char separator = keyword[length];
+            char *args = separator == 0 ? keyword + length : keyword + length + 1;
+            bool on = separator == '=' && strncasecmp(args, "ON", 2) == 0;
+
+            switch (findKeyword(keyword, length)) {
+                case Keyword_Ping:
+                    display_Header();
+                    display_Name(PSTR("PONG"));
+                    display_Footer();
+                    return true;
+                case Keyword_Reboot:
+                    display_Header();
+                    display_Name(PSTR("REBOOT"));
+                    display_Footer();
+                    CallReboot();
+                    return true;
+                case Keyword_RfDebug:
+                    if (separator != '=')
+                        break;
+                    setDebug(RFDebug, on, PSTR("RFDEBUG"));
+                    return true;
+                case Keyword_RfuDebug:
+                    if (separator != '=')
+                        break;
+                    setDebug(RFUDebug, on, PSTR("RFUDEBUG"));
+                    return true;
+                case Keyword_QrfDebug:
+                    if (separator != '=')
+                        break;
+                    setDebug(QRFDebug, on, PSTR("QRFDEBUG"));
+                    return true;
+                case Keyword_QrfuDebug:
+                    if (separator != '=')
+                        break;
+                    setDebug(QRFUDebug, on, PSTR("QRFUDEBUG"));
+                    return true;
+                case Keyword_Version:
+                    display_Header();
+                    display_Splash();
+                    display_Footer();
+                    return true;
+                case Keyword_Batch:
+                    Batch::executeCliCommand(args);
+                    return true;
+                case Keyword_Devices:
+                    Devices::executeCliCommand(args);
+                    return true;
+                case Keyword_Filter:
+                    Filter::executeCliCommand(args);
+                    return true;
+                case Keyword_Profiler:
+                    Profiler::executeCliCommand(args);
+                    return true;
+                case Keyword_Scheduler:
+                    Scheduler::executeCliCommand(args);
+                    return true;
+                case Keyword_Log:
+                    Log::executeCliCommand(args);
+                    return true;
+                case Keyword_Signal:
+                    Signal::executeCliCommand(args);
+                    return true;
+                case Keyword_Config:
+                    Config::executeCliCommand(args);
+                    return true;
+                case Keyword_EOF:
+                    break;
+            }
+
+            // -------------------------------------------------------
+            // Handle Generic Commands / Translate protocol data into Nodo text commands
+            // Plugins only queue their frames, Transmit engine takes care of the radio
+            // -------------------------------------------------------
+            if (txQueueCount > 0 || !Transmit::hasRoom()) { // behind the ones already waiting, order matters
+                bool deferred = deferTx(cmd);
+                if (!deferred)
+                    counters::txBusy++;
+                display_Header();
+                display_Name(deferred ? PSTR("OK") : PSTR("BUSY"));
+                display_Footer();
+                return true;
+            }
+            if (!PluginTXCall(0, cmd))
+                return false;
+            display_Header();
+            display_Name(PSTR("OK"));
+            display_Footer();
+            return true;
+        }
+
+        void mainLoop() {
+            while (txQueueCount > 0 && Transmit::hasRoom()) {
+                const char *queued = txQueue[txQueueHead];
+                char cmd[RETRIEVE_BUFFER_SIZE];
+                strcpy(cmd, queued); // plugins may modify it
+
+                if (!PluginTXCall(0, cmd)) {
+                    counters::unknown++; // already answered OK, too late for CMD UNKNOWN
+                    Log::printf(Log::Module_Core, Log::Level_Warning, PSTR("Command: no plugin handled queued '%s'"), queued);
+                }
+                sendMsgFromBuffer();
+
+                txQueueHead = (txQueueHead + 1) % COMMAND_TX_QUEUE_SIZE;
+                txQueueCount--;
+            }
+        }
+
+        bool execute(char *cmd, const Context &context) {
+            if (strncmp(cmd, "10;", 3) != 0) // Command from Master to RFLink
+                return false;
+
+            const Context *previousContext = currentContext;
+            sendMsgFromBuffer(); // whatever is pending does not belong to this command
+            currentContext = &context;
+            counters::commands[context.source]++;
+
+            if (!dispatch(cmd)) {
+                counters::unknown++;
+                display_Header();
+                display_Name(PSTR("CMD UNKNOWN"));
+                display_Footer();
+            }
+
+            sendMsgFromBuffer(); // in case there is a response waiting to be sent
+            currentContext = previousContext;
+            return true;
+        }
+
+        bool reply(const char *msg) {
+            if (currentContext == nullptr)
+                return false;
+
+            if (currentContext->reply != nullptr) {
+                currentContext->reply(msg, currentContext->target);
+                return true;
+            }
+
+            if (currentContext->sink != nullptr)
+                return Output::publishTo(msg, currentContext->sink);
+            return false;
+        }
+
+        EventScope::EventScope() : savedContext(currentContext) {
+            sendMsgFromBuffer(); // an answer being built belongs to the command
+            currentContext = nullptr;
+        }
+
+        EventScope::~EventScope() {
+            sendMsgFromBuffer();
+            currentContext = savedContext;
+        }
+
+        void getStatusJsonString(JsonObject &output) {
+            auto &&commands = output.createNestedObject("commands");
+            for (int i = 0; i < Source_EOF; i++)
+                commands[sourceNames[i]] = counters::commands[i];
+            commands[F("unknown")] = counters::unknown;
+            commands[F("tx_deferred")] = counters::txDeferred;
+            commands[F("tx_busy")] = counters::txBusy;
+            commands[F("tx_waiting")] = txQueueCount;
+        }
+
+    }
+}
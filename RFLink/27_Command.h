@@ -0,0 +1,105 @@
+#ifndef _27_Command_H_
+#define _27_Command_H_
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#ifndef COMMAND_TX_QUEUE_SIZE
+#if defined(ESP32)
+#define COMMAND_TX_QUEUE_SIZE 16 // TX commands waiting for room in the transmitter queue, each one takes RETRIEVE_BUFFER_SIZE
+#else
+#define COMMAND_TX_QUEUE_SIZE 8
+#endif
+#endif
+
+/**
+ * Command router shared by every transport (Serial, MQTT, Serial2Net, WebSocket, HTTP).
+ *
+ * The keyword following "10;" is hashed once and looked up in a switch built at compile time, anything
+ * else is a protocol name and goes straight to the transmit plugin which handles it (see PluginTXCall).
+ * When the transmitter queue is full, TX commands are answered OK right away and wait in a queue of their own,
+ * mainLoop() hands them to plugins as slots free up. If that queue is full too, the answer is BUSY.
+ *
+ * Each transport keeps its own input buffer and passes a Context telling where answers must go,
+ * so a command received from MQTT is answered on MQTT only and cannot clobber a command being typed on Serial.
+ * Messages emitted outside of a command, or within an EventScope (decoded signals, batch completions...),
+ * still go to every output.
+ * */
+namespace RFLink {
+    namespace Command {
+
+        enum Source {
+            Source_Serial,
+            Source_Mqtt,
+            Source_Serial2Net,
+            Source_WebSocket,
+            Source_Http,
+            Source_EOF,
+        };
+
+        struct Context {
+            Source source;
+            const char *sink;                             // answers go to this output only, nullptr means every output
+            void (*reply)(const char *msg, void *target); // when set, answers go there instead, ie a single Serial2Net client
+            void *target;
+        };
+
+        namespace counters {
+            extern unsigned long int commands[Source_EOF];
+            extern unsigned long int unknown;
+            extern unsigned long int txDeferred; // waited for room in the transmitter queue
+            extern unsigned long int txBusy;     // refused, nowhere left to wait
+        }
+
+        inline constexpr uint32_t lowerCase(char c) {
+            return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : (uint8_t) c;
+        }
+
+        /**
+         * Case insensitive FNV-1a, usable in case labels
+         * */
+        inline constexpr uint32_t keywordHash(const char *keyword, uint32_t hash = 2166136261UL) {
+            return *keyword == 0 ? hash : keywordHash(keyword + 1, (hash ^ lowerCase(*keyword)) * 16777619UL);
+        }
+
+        /**
+         * Same as keywordHash(), for the first length characters of a command
+         * */
+        uint32_t hashKeyword(const char *keyword, size_t length);
+
+        /**
+         * Include in your main loop, it feeds waiting TX commands to plugins while the transmitter has room
+         * */
+        void mainLoop();
+
+        /**
+         * Executes a "10;..." command and delivers its answers according to context.
+         * cmd may be modified
+         * @return false if cmd is not a command at all
+         * */
+        bool execute(char *cmd, const Context &context);
+
+        /**
+         * Called by sendMsgFromBuffer()
+         * @return true if msg is the answer to a command being executed and was delivered to its source
+         * */
+        bool reply(const char *msg);
+
+        /**
+         * Messages sent while it exists are events for every output, even in the middle of a command,
+         * ie a signal decoded or a batch completion reported while a plugin is handling the command
+         * */
+        class EventScope {
+        public:
+            EventScope();
+            ~EventScope();
+
+        private:
+            const Context *savedContext;
+        };
+
+        void getStatusJsonString(JsonObject &output);
+    }
+}
+
+#endif // _27_Command_H_
@@ -0,0 +1,178 @@
+#include <Arduino.h>
+#include "27_Command.h"
+#include "28_Tokenizer.h"
+
+namespace RFLink {
+    namespace Tokenizer {
+
+        const char delimiter = ';';
+
+        int keywordValue(const char *keyword, size_t length) {
+            using Command::keywordHash;
+            const char *name;
+            int value;
+
+            // two keywords with the same hash would not compile
+            switch (Command::hashKeyword(keyword, length)) {
+                case keywordHash("ON"): name = "ON"; value = VALUE_ON; break;
+                case keywordHash("OFF"): name = "OFF"; value = VALUE_OFF; break;
+                case keywordHash("ALLON"): name = "ALLON"; value = VALUE_ALLON; break;
+                case keywordHash("ALLOFF"): name = "ALLOFF"; value = VALUE_ALLOFF; break;
+                case keywordHash("PAIR"): name = "PAIR"; value = VALUE_PAIR; break;
+                case keywordHash("DIM"): name = "DIM"; value = VALUE_DIM; break;
+                case keywordHash("BRIGHT"): name = "BRIGHT"; value = VALUE_BRIGHT; break;
+                case keywordHash("UP"): name = "UP"; value = VALUE_UP; break;
+                case keywordHash("DOWN"): name = "DOWN"; value = VALUE_DOWN; break;
+                case keywordHash("STOP"): name = "STOP"; value = VALUE_STOP; break;
+                case keywordHash("CONFIRM"): name = "CONFIRM"; value = VALUE_CONFIRM; break;
+                case keywordHash("LIMIT"): name = "LIMIT"; value = VALUE_LIMIT; break;
+                default:
+                    return 0;
+            }
+
+            if (strlen(name) != length || strncasecmp(name, keyword, length) != 0)
+                return 0;
+            return value;
+        }
+
+        Fields::Fields(const char *command) : start(command), fieldLength(0) {
+            while (*start == delimiter)
+                start++;
+            while (start[fieldLength] != 0 && start[fieldLength] != delimiter)
+                fieldLength++;
+        }
+
+        void Fields::next() {
+            start += fieldLength;
+            fieldLength = 0;
+            while (*start == delimiter)
+                start++;
+            while (start[fieldLength] != 0 && start[fieldLength] != delimiter)
+                fieldLength++;
+        }
+
+        bool Fields::name(const char *expected) {
+            if (atEnd() || strlen(expected) != fieldLength || strncasecmp(start, expected, fieldLength) != 0)
+                return false;
+            next();
+            return true;
+        }
+
+        bool Fields::skipLabel(const char *label, const char *&from, size_t &length) const {
+            if (label == nullptr)
+                return false;
+            size_t labelLength = strlen(label);
+            if (length < labelLength || strncasecmp(from, label, labelLength) != 0)
+                return false;
+            from += labelLength;
+            length -= labelLength;
+            return true;
+        }
+
+        bool Fields::number(unsigned long &value, uint8_t base, uint8_t maxDigits, const char *label) {
+            const char *digits = start;
+            size_t count = fieldLength;
+            skipLabel(label, digits, count);
+            if (count == 0 || count > maxDigits)
+                return false;
+
+            unsigned long result = 0;
+            for (size_t i = 0; i < count; i++) {
+                char c = digits[i];
+                uint8_t digit;
+                if (c >= '0' && c <= '9')
+                    digit = c - '0';
+                else if (c >= 'a' && c <= 'f')
+                    digit = c - 'a' + 10;
+                else if (c >= 'A' && c <= 'F')
+                    digit = c - 'A' + 10;
+                else
+                    return false;
+                if (digit >= base)
+                    return false;
+                result = result * base + digit;
+            }
+
+            value = result;
+            next();
+            return true;
+        }
+
+        bool Fields::hex(unsigned long &value, uint8_t maxDigits, const char *label) {
+            return number(value, 16, maxDigits, label);
+        }
+
+        bool Fields::decimal(unsigned long &value, uint8_t maxDigits, const char *label) {
+            return number(value, 10, maxDigits, label);
+        }
+
+        bool Fields::id(unsigned long &value) {
+            unsigned long raw;
+            if (!hex(raw, 8, "ID="))
+                return false;
+            value = raw & 0x03FFFFFF;
+            return true;
+        }
+
+        bool Fields::switchCode(byte &value) {
+            const char *savedStart = start;
+            size_t savedLength = fieldLength;
+            unsigned long raw;
+            if (!hex(raw, 2, "SWITCH="))
+                return false;
+            if (raw < 1 || raw > 0x10) { // 1 to 16 -> 0 to 15 (displayed value is one more)
+                start = savedStart;
+                fieldLength = savedLength;
+                return false;
+            }
+            value = raw - 1;
+            return true;
+        }
+
+        bool Fields::keyword(int &value) {
+            const char *word = start;
+            size_t length = fieldLength;
+            skipLabel("CMD=", word, length);
+            int found = keywordValue(word, length);
+            if (found == 0)
+                return false;
+            value = found;
+            next();
+            return true;
+        }
+
+        bool Fields::dimLevel(byte &level) {
+            unsigned long raw;
+            if (!hex(raw, 2, "SET_LEVEL="))
+                return false;
+            level = raw;
+            return true;
+        }
+
+        bool Fields::command(byte &cmd, byte &level) {
+            int value;
+            if (!keyword(value))
+                return dimLevel(level);
+
+            switch (value) {
+                case VALUE_ON:
+                    cmd |= B01;
+                    break;
+                case VALUE_ALLON:
+                    cmd |= B11;
+                    break;
+                case VALUE_ALLOFF:
+                    cmd |= B10;
+                    break;
+                case VALUE_OFF:
+                    break;
+                default:
+                    level = value; // as before, other keywords are passed through
+                    return true;
+            }
+            level = 0xFF;
+            return true;
+        }
+
+    }
+}
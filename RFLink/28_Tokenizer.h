@@ -0,0 +1,80 @@
+#ifndef _28_Tokenizer_H_
+#define _28_Tokenizer_H_
+
+#include <Arduino.h>
+#include "4_Display.h"
+
+/**
+ * Reader for "10;Protocol;field;field;...;" commands, used by the transmit plugins.
+ *
+ * Fields are views into the command: nothing is copied or written, there is no hidden state like strtok()
+ * so any number of commands can be parsed at the same time, from any task or core.
+ * Empty fields are skipped, ie a trailing ';' does not count as a field.
+ *
+ * Typed parsers only move to the next field when they succeed, so a plugin may try another format on failure.
+ * */
+namespace RFLink {
+    namespace Tokenizer {
+
+        /**
+         * Case insensitive ON, OFF, ALLON, ALLOFF, PAIR, DIM, BRIGHT, UP, DOWN, STOP, CONFIRM, LIMIT
+         * @return VALUE_xxx or 0 if keyword is none of them
+         * */
+        int keywordValue(const char *keyword, size_t length);
+
+        class Fields {
+        public:
+            explicit Fields(const char *command);
+
+            const char *field() const { return start; }
+            size_t length() const { return fieldLength; }
+            bool atEnd() const { return fieldLength == 0; }
+            void next();
+
+            /**
+             * Exact (case insensitive) match of the current field, ie "10" then the protocol name
+             * */
+            bool name(const char *expected);
+            /**
+             * 1 to maxDigits digits, optionally preceded by label (ie "ID=")
+             * */
+            bool hex(unsigned long &value, uint8_t maxDigits, const char *label = nullptr);
+            bool decimal(unsigned long &value, uint8_t maxDigits, const char *label = nullptr);
+            /**
+             * "[ID=]hhhhhhhh", 26 bits kept
+             * */
+            bool id(unsigned long &value);
+            /**
+             * "[SWITCH=]h" 1 to 16, returned as 0 to 15
+             * */
+            bool switchCode(byte &value);
+            /**
+             * "[CMD=]ON" and friends
+             * @param value VALUE_xxx
+             * */
+            bool keyword(int &value);
+            /**
+             * "[SET_LEVEL=]hh"
+             * */
+            bool dimLevel(byte &level);
+            /**
+             * Either a keyword or a dim level:
+             * cmd gets bit 0 set for ON/ALLON and bit 1 for ALLON/ALLOFF, level is 0xFF for those
+             * */
+            bool command(byte &cmd, byte &level);
+            /**
+             * @return true if every field was consumed
+             * */
+            bool end() const { return atEnd(); }
+
+        private:
+            const char *start;
+            size_t fieldLength;
+
+            bool skipLabel(const char *label, const char *&from, size_t &length) const;
+            bool number(unsigned long &value, uint8_t base, uint8_t maxDigits, const char *label);
+        };
+    }
+}
+
+#endif // _28_Tokenizer_H_
@@ -9,6 +9,10 @@
 #include "1_Radio.h"
 #include "2_Signal.h"
 #include "5_Plugin.h"
+#include "14_Transmit.h"
+#include "15_Encoder.h"
+#include "25_Log.h"
+#include "26_SerialTx.h"
 
 unsigned long SignalCRC = 0L;   // holds the bitstream value for some plugins to identify RF repeats
 unsigned long SignalCRC_1 = 0L; // holds the previous SignalCRC (for mixed burst protocols)
@@ -134,6 +138,8 @@ namespace RFLink
         {
             unsigned long int receivedSignalsCount;
             unsigned long int successfullyDecodedSignalsCount;
+            volatile unsigned long int droppedSignalsCount;
+            volatile unsigned long int noiseSignalsCount;
         }
 
         namespace params
@@ -161,6 +167,19 @@ namespace RFLink
         const char json_name_signal_repeat_time[] = "signal_repeat_time";
         const char json_name_scan_high_time[] = "scan_high_time";
 
+        enum ConfigItemIndex {
+            ConfigItem_AsyncModeEnabled,
+            ConfigItem_SampleRate,
+            ConfigItem_MinRawPulses,
+            ConfigItem_SeekTimeout,
+            ConfigItem_MinPreamble,
+            ConfigItem_MinPulseLen,
+            ConfigItem_SignalEndTimeout,
+            ConfigItem_SignalRepeatTime,
+            ConfigItem_ScanHighTime,
+            ConfigItem_EOF,
+        };
+
         Config::ConfigItem configItems[] = {
                 Config::ConfigItem(json_name_async_mode_enabled, Config::SectionId::Signal_id, false, paramsUpdatedCallback),
                 Config::ConfigItem(json_name_sample_rate, Config::SectionId::Signal_id, DEFAULT_RAWSIGNAL_SAMPLE_RATE, paramsUpdatedCallback),
@@ -172,6 +191,7 @@ namespace RFLink
                 Config::ConfigItem(json_name_signal_repeat_time, Config::SectionId::Signal_id, SIGNAL_REPEAT_TIME_MS, paramsUpdatedCallback),
                 Config::ConfigItem(json_name_scan_high_time, Config::SectionId::Signal_id, SCAN_HIGH_TIME_MS, paramsUpdatedCallback),
                 Config::ConfigItem()};
+        static_assert(sizeof(configItems) / sizeof(Config::ConfigItem) == ConfigItem_EOF + 1, "configItems has missing/extra items, please compare with ConfigItemIndex enum declarations");
 
         void paramsUpdatedCallback()
         {
@@ -184,63 +204,63 @@ namespace RFLink
             Config::ConfigItem *item;
             bool changesDetected = false;
 
-            item = Config::findConfigItem(json_name_async_mode_enabled, Config::SectionId::Signal_id);
+            item = &configItems[ConfigItem_AsyncModeEnabled];
             if (item->getBoolValue() != params::async_mode_enabled)
             {
                 changesDetected = true;
                 params::async_mode_enabled = item->getBoolValue();
             }
 
-            item = Config::findConfigItem(json_name_sample_rate, Config::SectionId::Signal_id);
+            item = &configItems[ConfigItem_SampleRate];
             if (item->getLongIntValue() != params::sample_rate)
             {
                 changesDetected = true;
                 params::sample_rate = item->getLongIntValue();
             }
 
-            item = Config::findConfigItem(json_name_min_raw_pulses, Config::SectionId::Signal_id);
+            item = &configItems[ConfigItem_MinRawPulses];
             if (item->getLongIntValue() != params::min_raw_pulses)
             {
                 changesDetected = true;
                 params::min_raw_pulses = item->getLongIntValue();
             }
 
-            item = Config::findConfigItem(json_name_seek_timeout, Config::SectionId::Signal_id);
+            item = &configItems[ConfigItem_SeekTimeout];
             if (item->getLongIntValue() != params::seek_timeout)
             {
                 changesDetected = true;
                 params::seek_timeout = item->getLongIntValue();
             }
 
-            item = Config::findConfigItem(json_name_min_preamble, Config::SectionId::Signal_id);
+            item = &configItems[ConfigItem_MinPreamble];
             if (item->getLongIntValue() != params::min_preamble)
             {
                 changesDetected = true;
                 params::min_preamble = item->getLongIntValue();
             }
 
-            item = Config::findConfigItem(json_name_min_pulse_len, Config::SectionId::Signal_id);
+            item = &configItems[ConfigItem_MinPulseLen];
             if (item->getLongIntValue() != params::min_pulse_len)
             {
                 changesDetected = true;
                 params::min_pulse_len = item->getLongIntValue();
             }
 
-            item = Config::findConfigItem(json_name_signal_end_timeout, Config::SectionId::Signal_id);
+            item = &configItems[ConfigItem_SignalEndTimeout];
             if (item->getLongIntValue() != params::signal_end_timeout)
             {
                 changesDetected = true;
                 params::signal_end_timeout = item->getLongIntValue();
             }
 
-            item = Config::findConfigItem(json_name_signal_repeat_time, Config::SectionId::Signal_id);
+            item = &configItems[ConfigItem_SignalRepeatTime];
             if (item->getLongIntValue() != params::signal_repeat_time)
             {
                 changesDetected = true;
                 params::signal_repeat_time = item->getLongIntValue();
             }
 
-            item = Config::findConfigItem(json_name_scan_high_time, Config::SectionId::Signal_id);
+            item = &configItems[ConfigItem_ScanHighTime];
             if (item->getLongIntValue() != params::scan_high_time)
             {
                 changesDetected = true;
@@ -250,7 +270,7 @@ namespace RFLink
             // Applying changes will happen in mainLoop()
             if (triggerChanges && changesDetected)
             {
-                Serial.println(F("Signal parameters have changed."));
+                Log::printf(Log::Module_Signal, Log::Level_Info, PSTR("Signal parameters have changed."));
                 if (params::async_mode_enabled && AsyncSignalScanner::isStopped())
                 {
                     AsyncSignalScanner::startScanning();
@@ -272,18 +292,26 @@ namespace RFLink
             static unsigned long timeStartLoop_us;
             static unsigned int RawCodeLength;
             static unsigned long PulseLength_us;
+            static unsigned long seekTimeout_ms;
             static const bool Start_Level = LOW;
             // *********************************************************************************
 
 #define RESET_SEEKSTART timeStartSeek_ms = millis();
 #define RESET_TIMESTART timeStartLoop_us = micros();
 #define CHECK_RF ((digitalRead(Radio::pins::RX_DATA) == Start_Level) ^ Toggle)
-#define CHECK_TIMEOUT ((millis() - timeStartSeek_ms) < params::seek_timeout)
+#define CHECK_TIMEOUT ((millis() - timeStartSeek_ms) < seekTimeout_ms)
 #define GET_PULSELENGTH PulseLength_us = micros() - timeStartLoop_us
 #define SWITCH_TOGGLE Toggle = !Toggle
 #define STORE_PULSE RawSignal.Pulses[RawCodeLength++] = PulseLength_us / params::sample_rate
 
             // ***   Init Vars   ***
+            seekTimeout_ms = params::seek_timeout;
+            if (Transmit::isInRxWindow())
+            { // don't keep seeking when Transmit needs the radio back
+                long remaining = (long)(Transmit::getRxWindowEnd() - millis());
+                if (remaining < (long)seekTimeout_ms)
+                    seekTimeout_ms = remaining > 0 ? remaining : 0;
+            }
             Toggle = true;
             RawCodeLength = 0;
             PulseLength_us = 0;
@@ -334,6 +362,7 @@ namespace RFLink
                 {
                     // NO RawCodeLength++;
                     interrupts();
+                    counters::noiseSignalsCount++;
                     return false; // Or break; instead, if you think it may worth it.
                 }
 
@@ -364,6 +393,7 @@ namespace RFLink
             }
             else
             {
+                counters::noiseSignalsCount++;
                 RawSignal.Number = 0;
             }
 
@@ -379,9 +409,12 @@ namespace RFLink
             {
 
                 unsigned long Timer = millis() + params::scan_high_time;
+                if (Transmit::isInRxWindow() && (long)(Transmit::getRxWindowEnd() - Timer) < 0)
+                    Timer = Transmit::getRxWindowEnd(); // we are listening between two repeats of a transmission
 
                 while (Timer > millis()) // || RepeatingTimer > millis())
                 {
+                    SerialTx::poll(); // the UART FIFO lasts ~11ms at 115200, we may listen for much longer
                     if (FetchSignal_sync())
                     { // RF: *** data start ***
                         counters::receivedSignalsCount++;
@@ -457,7 +490,7 @@ namespace RFLink
                 }
                 else
                 {
-                    Serial.println(F("Start of async Receiver was requested but it's not enabled!"));
+                    Log::printf(Log::Module_Signal, Log::Level_Warning, PSTR("Start of async Receiver was requested but it's not enabled!"));
                 }
             }
 
@@ -512,6 +545,7 @@ namespace RFLink
                     nextPulseTimeoutTime_us = 0; // stop watching for a timeout
                     RawSignal.Number = 0;
                     RawSignal.Time = 0;
+                    counters::droppedSignalsCount++;
                     //Serial.println("this signal has too many pulses and will be dicarded");
                     return;
                 }
@@ -535,6 +569,7 @@ namespace RFLink
                 if (RawSignal.readyForDecoder)
                 { // it means previous packet has not been decoded yet, let's forget about it
                     //Serial.println("previous signal not decoded yet, discarding this one");
+                    counters::droppedSignalsCount++;
                     nextPulseTimeoutTime_us = 0;
                     return;
                 }
@@ -558,6 +593,7 @@ namespace RFLink
 
                 if (RawSignal.Number < MIN_RAW_PULSES)
                 { // not enough pulses, we ignore it
+                    counters::noiseSignalsCount++;
                     nextPulseTimeoutTime_us = 0;
                     RawSignal.Number = 0;
                     RawSignal.Time = 0;
@@ -577,150 +613,46 @@ namespace RFLink
         /*********************************************************************************************\
        Send bitstream to RF - Plugin 004 (Newkaku) special version
     \*********************************************************************************************/
-        void AC_Send(unsigned long data, byte cmd)
-        {
 #define AC_FPULSE 260 // Pulse width in microseconds
 #define AC_FRETRANS 5 // Number of code retransmissions
 
-            // Serial.println("Send AC");
-            // Serial.println(data, HEX);
-            // Serial.println(cmd, HEX);
+        // each bit is made of two marks, the long space comes last for a '0' and first for a '1'
+        const Encoder::Protocol AC_Protocol = {
+            {2, HIGH, {335, AC_FPULSE * 10 + (AC_FPULSE >> 1)}},                 // preamble 335*9=3015 //260*10=2600
+            {4, HIGH, {AC_FPULSE, AC_FPULSE, AC_FPULSE, AC_FPULSE * 5}},         // 335*3=1005 260*5=1300
+            {4, HIGH, {AC_FPULSE, AC_FPULSE * 5, AC_FPULSE, AC_FPULSE}},
+            {2, HIGH, {AC_FPULSE, AC_FPULSE * 40}},                              // termination/synchronisation-signal 31*335=10385 40*260=10400
+            AC_FRETRANS,
+            0, // frames are separated by the footer
+        };
 
-            unsigned long bitstream = 0L;
-            byte command = 0;
-            // prepare data to send
-            for (unsigned short i = 0; i < 32; i++)
-            { // reverse data bits
-                bitstream <<= 1;
-                bitstream |= (data & B1);
-                data >>= 1;
-            }
-            if (cmd != 0xff)
-            { // reverse dim bits
-                for (unsigned short i = 0; i < 4; i++)
-                {
-                    command <<= 1;
-                    command |= (cmd & B1);
-                    cmd >>= 1;
-                }
-            }
-            // send bits
-            for (byte nRepeat = 0; nRepeat < AC_FRETRANS; nRepeat++)
-            {
-                data = bitstream;
-                if (cmd != 0xff)
-                    cmd = command;
-                digitalWrite(Radio::pins::TX_DATA, HIGH);
-                //delayMicroseconds(fpulse);  //335
-                delayMicroseconds(335);
-                digitalWrite(Radio::pins::TX_DATA, LOW);
-                delayMicroseconds(AC_FPULSE * 10 + (AC_FPULSE >> 1)); //335*9=3015 //260*10=2600
-                for (unsigned short i = 0; i < 32; i++)
-                {
-                    if (i == 27 && cmd != 0xff)
-                    { // DIM command, send special DIM sequence TTTT replacing on/off bit
-                        digitalWrite(Radio::pins::TX_DATA, HIGH);
-                        delayMicroseconds(AC_FPULSE);
-                        digitalWrite(Radio::pins::TX_DATA, LOW);
-                        delayMicroseconds(AC_FPULSE);
-                        digitalWrite(Radio::pins::TX_DATA, HIGH);
-                        delayMicroseconds(AC_FPULSE);
-                        digitalWrite(Radio::pins::TX_DATA, LOW);
-                        delayMicroseconds(AC_FPULSE);
-                    }
-                    else
-                        switch (data & B1)
-                        {
-                            case 0:
-                                digitalWrite(Radio::pins::TX_DATA, HIGH);
-                                delayMicroseconds(AC_FPULSE);
-                                digitalWrite(Radio::pins::TX_DATA, LOW);
-                                delayMicroseconds(AC_FPULSE);
-                                digitalWrite(Radio::pins::TX_DATA, HIGH);
-                                delayMicroseconds(AC_FPULSE);
-                                digitalWrite(Radio::pins::TX_DATA, LOW);
-                                delayMicroseconds(AC_FPULSE * 5); // 335*3=1005 260*5=1300  260*4=1040
-                                break;
-                            case 1:
-                                digitalWrite(Radio::pins::TX_DATA, HIGH);
-                                delayMicroseconds(AC_FPULSE);
-                                digitalWrite(Radio::pins::TX_DATA, LOW);
-                                delayMicroseconds(AC_FPULSE * 5);
-                                digitalWrite(Radio::pins::TX_DATA, HIGH);
-                                delayMicroseconds(AC_FPULSE);
-                                digitalWrite(Radio::pins::TX_DATA, LOW);
-                                delayMicroseconds(AC_FPULSE);
-                                break;
-                        }
-                    //Next bit
-                    data >>= 1;
-                }
-                // send dim bits when needed
-                if (cmd != 0xff)
-                { // need to send DIM command bits
-                    for (unsigned short i = 0; i < 4; i++)
-                    { // 4 bits
-                        switch (cmd & B1)
-                        {
-                            case 0:
-                                digitalWrite(Radio::pins::TX_DATA, HIGH);
-                                delayMicroseconds(AC_FPULSE);
-                                digitalWrite(Radio::pins::TX_DATA, LOW);
-                                delayMicroseconds(AC_FPULSE);
-                                digitalWrite(Radio::pins::TX_DATA, HIGH);
-                                delayMicroseconds(AC_FPULSE);
-                                digitalWrite(Radio::pins::TX_DATA, LOW);
-                                delayMicroseconds(AC_FPULSE * 5); // 335*3=1005 260*5=1300
-                                break;
-                            case 1:
-                                digitalWrite(Radio::pins::TX_DATA, HIGH);
-                                delayMicroseconds(AC_FPULSE);
-                                digitalWrite(Radio::pins::TX_DATA, LOW);
-                                delayMicroseconds(AC_FPULSE * 5);
-                                digitalWrite(Radio::pins::TX_DATA, HIGH);
-                                delayMicroseconds(AC_FPULSE);
-                                digitalWrite(Radio::pins::TX_DATA, LOW);
-                                delayMicroseconds(AC_FPULSE);
-                                break;
-                        }
-                        //Next bit
-                        cmd >>= 1;
-                    }
-                }
-                //Send termination/synchronisation-signal. Total length: 32 periods
-                digitalWrite(Radio::pins::TX_DATA, HIGH);
-                delayMicroseconds(AC_FPULSE);
-                digitalWrite(Radio::pins::TX_DATA, LOW);
-                delayMicroseconds(AC_FPULSE * 40); //31*335=10385 40*260=10400
-            }
-            // End transmit
-        }
+        // DIM command, special DIM sequence TTTT replacing on/off bit
+        const Encoder::Symbol AC_DimSymbol = {4, HIGH, {AC_FPULSE, AC_FPULSE, AC_FPULSE, AC_FPULSE}};
 
-        void RawSendRF(RawSignalStruct *signal)
+        void AC_Send(unsigned long data, byte cmd)
         {
-            int x;
-
-            Radio::set_Radio_mode(Radio::States::Radio_TX);
+            RawSignalStruct signal;
 
-            //RawSignal.Pulses[RawSignal.Number]=1;                                   // due to a bug in Arduino 1.0.1
+            Encoder::begin(signal, AC_Protocol);
 
-            for (byte y = 0; y < signal->Repeats; y++)
-            { // herhaal verzenden RF code
-                x = 1;
-                noInterrupts();
-                while (x < signal->Number)
-                {
-                    digitalWrite(Radio::pins::TX_DATA, HIGH);
-                    delayMicroseconds(signal->Pulses[x++] * signal->Multiply); // min een kleine correctie
-                    digitalWrite(Radio::pins::TX_DATA, LOW);
-                    delayMicroseconds(signal->Pulses[x++] * signal->Multiply); // min een kleine correctie
-                }
-                interrupts();
-                if (y + 1 < signal->Repeats)
-                    delay(signal->Delay); // Delay buiten het gebied waar de interrupts zijn uitgeschakeld! Anders werkt deze funktie niet.
+            if (cmd != 0xff)
+            { // bit 4 is replaced by the dim sequence and dim level follows the 32 bits
+                Encoder::appendBits(signal, AC_Protocol, data >> 5, 27);
+                Encoder::appendSymbol(signal, AC_DimSymbol);
+                Encoder::appendBits(signal, AC_Protocol, data, 4);
+                Encoder::appendBits(signal, AC_Protocol, cmd, 4);
             }
+            else
+                Encoder::appendBits(signal, AC_Protocol, data, 32);
 
-            Radio::set_Radio_mode(Radio::States::Radio_RX);
+            Encoder::end(signal, AC_Protocol);
+
+            Transmit::submit(&signal);
+        }
+
+        bool RawSendRF(RawSignalStruct *signal)
+        {
+            return Transmit::submit(signal) != 0;
         }
 
         bool getSignalFromJson(RawSignalStruct &signal, const char *json_str)
@@ -730,7 +662,7 @@ namespace RFLink
 
             if (deserializeJson(json, json_str) != DeserializationError::Ok)
             {
-                Serial.println(F("An error occured while reading json"));
+                Log::printf(Log::Module_Signal, Log::Level_Error, PSTR("An error occured while reading json"));
                 return false;
             }
 
@@ -746,12 +678,12 @@ namespace RFLink
             signal.Number = pulsesJson.size() + 1;
 
             if(signal.Number < 2) {
-                Serial.println(F("error, your signal has 0 pulse defined!"));
+                Log::printf(Log::Module_Signal, Log::Level_Error, PSTR("error, your signal has 0 pulse defined!"));
                 return false;
             }
 
             if(signal.Number > RAW_BUFFER_SIZE) {
-                Serial.printf_P(PSTR("error, your Signal has %i pulses while this supports only %i\r\n"), signal.Number, RAW_BUFFER_SIZE);
+                Log::printf(Log::Module_Signal, Log::Level_Error, PSTR("error, your Signal has %i pulses while this supports only %i"), signal.Number, RAW_BUFFER_SIZE);
                 return false;
             }
 
@@ -780,7 +712,7 @@ namespace RFLink
 
             if (commaIndex == nullptr)
             {
-                Serial.println(F("Error : failed to find ending ';' for the command"));
+                Log::printf(Log::Module_Signal, Log::Level_Error, PSTR("Error : failed to find ending ';' for the command"));
                 return;
             }
 
@@ -789,26 +721,34 @@ namespace RFLink
             if (strncasecmp(commands::sendRF.c_str(), cmd, commands::sendRF.length()) == 0)
             {
                 if(!getSignalFromJson(signal, commaIndex + 1)) {
-                    Serial.println(FPSTR(error_command_aborted));
+                    Log::printf(Log::Module_Signal, Log::Level_Error, error_command_aborted);
                     return;
                 }
 
-                Serial.printf_P(PSTR("** sending RF signal with the following properties: pulses=%i, repeat=%i, delay=%i, multiply=%i... "), signal.Number, signal.Repeats, signal.Delay, signal.Multiply);
-                RawSendRF(&signal);
-                Serial.println(F("done"));
+                if (!Transmit::hasRoom())
+                {
+                    Log::printf(Log::Module_Signal, Log::Level_Error, PSTR("** RF signal rejected: transmit queue is full, try again later"));
+                    return;
+                }
+
+                unsigned long jobId = Transmit::submit(&signal);
+                if (jobId == 0)
+                    Log::printf(Log::Module_Signal, Log::Level_Error, PSTR("** RF signal rejected: pulses=%i, repeat=%i, delay=%i, multiply=%i"), signal.Number, signal.Repeats, signal.Delay, signal.Multiply);
+                else
+                    Log::printf(Log::Module_Signal, Log::Level_Info, PSTR("** RF signal queued as job #%lu: pulses=%i, repeat=%i, delay=%i, multiply=%i"), jobId, signal.Number, signal.Repeats, signal.Delay, signal.Multiply);
             }
             else if (strncasecmp(commands::testRF.c_str(), cmd, commands::testRF.length()) == 0)
             {
                 RawSignal.readyForDecoder = true;
 
                 if(!getSignalFromJson(RawSignal, commaIndex+1)) {
-                    Serial.println(FPSTR(error_command_aborted));
+                    Log::printf(Log::Module_Signal, Log::Level_Error, error_command_aborted);
                     RawSignal.readyForDecoder = false;
                     return;
                 }
 
                 if (!PluginRXCall(0, 0)){
-                    Serial.println(F("No plugin has matched your signal"));
+                    Log::printf(Log::Module_Signal, Log::Level_Info, PSTR("No plugin has matched your signal"));
                 }
                 else
                     RFLink::sendMsgFromBuffer();
@@ -817,7 +757,7 @@ namespace RFLink
             }
             else
             {
-                Serial.printf_P(PSTR("Error : unknown command '%s'\r\n"), cmd);
+                Log::printf(Log::Module_Signal, Log::Level_Error, PSTR("Error : unknown command '%s'"), cmd);
             }
         }
 
@@ -826,6 +766,8 @@ namespace RFLink
             auto &&signal = output.createNestedObject("signal");
             signal[F("received_signal_count")] = counters::receivedSignalsCount;
             signal[F("successfully_decoded_count")] = counters::successfullyDecodedSignalsCount;
+            signal[F("dropped_signal_count")] = counters::droppedSignalsCount;
+            signal[F("noise_signal_count")] = counters::noiseSignalsCount;
         }
 
     } // end of ns Signal
@@ -79,7 +79,8 @@ namespace RFLink {
     namespace counters {
       extern unsigned long int receivedSignalsCount;
       extern unsigned long int successfullyDecodedSignalsCount;
-      
+      extern volatile unsigned long int droppedSignalsCount; // overflowed the capture buffer or previous one was not decoded yet
+      extern volatile unsigned long int noiseSignalsCount;   // had a preamble but pulses were too short or too few
     }
 
     extern Config::ConfigItem configItems[];
@@ -87,7 +88,11 @@ namespace RFLink {
     void setup();
     void paramsUpdatedCallback();
     void refreshParametersFromConfig(bool triggerChanges=true);
-    void RawSendRF(RawSignalStruct *signal);
+    /**
+     * Queues the signal for the transmitter, see 14_Transmit.h
+     * @return false if the signal was rejected
+     * */
+    bool RawSendRF(RawSignalStruct *signal);
     void AC_Send(unsigned long data, byte cmd);
     
     void executeCliCommand(char *cmd);
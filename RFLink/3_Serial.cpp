@@ -12,19 +12,22 @@
 #include "3_Serial.h"
 #include "4_Display.h"
 #include "5_Plugin.h"
+#include "25_Log.h"
+#include "26_SerialTx.h"
+#include "27_Command.h"
 
-char InputBuffer_Serial[INPUT_COMMAND_SIZE];
+char serialInput[INPUT_COMMAND_SIZE]; // line being typed, other sources have their own buffer
 int serialBufferCursor=0;
 
+const RFLink::Command::Context serialContext = {RFLink::Command::Source_Serial, "serial", nullptr, nullptr};
+const RFLink::Command::Context mqttContext = {RFLink::Command::Source_Mqtt, "mqtt", nullptr, nullptr};
+
 /**
  *
  * @return true if some command/data needs to process, false if not
  */
 boolean ReadSerial();
 
-boolean CheckCmd();
-
-boolean CopySerial(char *);
 /*********************************************************************************************/
 
 using namespace RFLink;
@@ -66,13 +69,11 @@ boolean readSerialAndExecute() {
     if (ReadSerial()) {
 #ifdef SERIAL_ENABLED
         RFLink::sendRawPrint(F("\33[2K\r"));
-        Serial.flush();
         RFLink::sendRawPrint(PSTR("Message arrived [Serial]:"));
-        RFLink::sendRawPrint(InputBuffer_Serial);
+        RFLink::sendRawPrint(serialInput);
         RFLink::sendRawPrint(PSTR("\r\n"));
-        Serial.flush();
 #endif
-        bool success = RFLink::executeCliCommand(InputBuffer_Serial);
+        bool success = RFLink::Command::execute(serialInput, serialContext);
         resetSerialBuffer();
         if (success)
             return true;
@@ -81,20 +82,10 @@ boolean readSerialAndExecute() {
 }
 
 boolean CheckMQTT(byte *byte_in) {
-    if (CopySerial((char *) byte_in)) {
-#ifdef SERIAL_ENABLED
-        Serial.flush();
-        Serial.print(F("Message arrived [MQTT] "));
-        Serial.println(InputBuffer_Serial);
-#endif
-        if (CheckCmd())
-            return true;
-    }
-    return false;
-}
-
-boolean CopySerial(char *src) {
-    return (strncpy(InputBuffer_Serial, src, INPUT_COMMAND_SIZE - 2));
+    char *command = (char *) byte_in; // executed in place, the MQTT client does not need it anymore
+    RFLink::Log::printf(RFLink::Log::Module_Mqtt, RFLink::Log::Level_Info, PSTR("Message arrived [MQTT] %s"), command);
+    RFLink::Command::execute(command, mqttContext);
+    return true;
 }
 
 HardwareSerialExtended *RFL_Serial = (HardwareSerialExtended*) &Serial;
@@ -115,16 +106,16 @@ boolean ReadSerial() {
             availableBytes = Serial.available();
             if (availableBytes) {
 
-                readCount = RFL_Serial->readBytesUntilNewLine(&InputBuffer_Serial[serialBufferCursor], INPUT_COMMAND_SIZE - 1 - serialBufferCursor);
+                readCount = RFL_Serial->readBytesUntilNewLine(&serialInput[serialBufferCursor], INPUT_COMMAND_SIZE - 1 - serialBufferCursor);
 
                 if(readCount > 0) {
 
                     serialBufferCursor += readCount;
 
-                    //Serial.printf_P(PSTR("Read %i bytes so far from console and last char=%hu\r\n"), serialBufferCursor, InputBuffer_Serial[serialBufferCursor-1]);
+                    //Serial.printf_P(PSTR("Read %i bytes so far from console and last char=%hu\r\n"), serialBufferCursor, serialInput[serialBufferCursor-1]);
 
-                    if (InputBuffer_Serial[serialBufferCursor - 1] == 13 || InputBuffer_Serial[serialBufferCursor - 1] == 10) {
-                        InputBuffer_Serial[serialBufferCursor - 1] = 0;
+                    if (serialInput[serialBufferCursor - 1] == 13 || serialInput[serialBufferCursor - 1] == 10) {
+                        serialInput[serialBufferCursor - 1] = 0;
                         return true;
                     }
                     FocusTimer = millis() + FOCUS_TIME_MS;
@@ -135,14 +126,14 @@ boolean ReadSerial() {
             if (millis() >= FocusTimer) { // we will get more characters at next loop
                 //Serial.println(F("Exit because of timer"));
                 if(cursorReference != serialBufferCursor)
-                    Serial.write(&InputBuffer_Serial[cursorReference], serialBufferCursor-cursorReference);
+                    SerialTx::write(&serialInput[cursorReference], serialBufferCursor-cursorReference, SerialTx::Class_Message);
                 return false;
             }
 
             if(serialBufferCursor >= (INPUT_COMMAND_SIZE - 1))
             {
                 resetSerialBuffer();
-                Serial.println(F("Error: Your command was too long so it was ignored"));
+                Log::printf(Log::Module_Serial, Log::Level_Error, PSTR("Error: Your command was too long so it was ignored"));
                 while (Serial.available()) { // Let's empty Serial so no mistake is made !
                     Serial.read();
                 }
@@ -153,117 +144,8 @@ boolean ReadSerial() {
     return false;
 }
 
-boolean CheckCmd() {
-    static byte ValidCommand = 0;
-    if (strlen(InputBuffer_Serial) > 7) { // need to see minimal 8 characters on the serial port
-        // 10;....;..;ON;
-        if (strncmp(InputBuffer_Serial, "10;", 3) == 0) { // Command from Master to RFLink
-            // -------------------------------------------------------
-            // Handle Device Management Commands
-            // -------------------------------------------------------
-            if (strncasecmp(InputBuffer_Serial + 3, "PING;", 5) == 0) {
-                display_Header();
-                display_Name(PSTR("PONG"));
-                display_Footer();
-            } else if (strncasecmp(InputBuffer_Serial + 3, "REBOOT;", 7) == 0) {
-                display_Header();
-                display_Name(PSTR("REBOOT"));
-                display_Footer();
-                CallReboot();
-            } else if (strncasecmp(InputBuffer_Serial + 3, "RFDEBUG=O", 9) == 0) {
-                if (InputBuffer_Serial[12] == 'N' || InputBuffer_Serial[12] == 'n') {
-                    RFDebug = true;    // full debug on
-                    QRFDebug = false;  // q full debug off
-                    RFUDebug = false;  // undecoded debug off
-                    QRFUDebug = false; // q undecoded debug off
-                    display_Header();
-                    display_Name(PSTR("RFDEBUG=ON"));
-                    display_Footer();
-                } else {
-                    RFDebug = false; // full debug off
-                    display_Header();
-                    display_Name(PSTR("RFDEBUG=OFF"));
-                    display_Footer();
-                }
-            } else if (strncasecmp(InputBuffer_Serial + 3, "RFUDEBUG=O", 10) == 0) {
-                if (InputBuffer_Serial[13] == 'N' || InputBuffer_Serial[13] == 'n') {
-                    RFDebug = false;   // full debug off
-                    QRFDebug = false;  // q debug off
-                    RFUDebug = true;   // undecoded debug on
-                    QRFUDebug = false; // q undecoded debug off
-                    display_Header();
-                    display_Name(PSTR("RFUDEBUG=ON"));
-                    display_Footer();
-                } else {
-                    RFUDebug = false; // undecoded debug off
-                    display_Header();
-                    display_Name(PSTR("RFUDEBUG=OFF"));
-                    display_Footer();
-                }
-            } else if (strncasecmp(InputBuffer_Serial + 3, "QRFDEBUG=O", 10) == 0) {
-                if (InputBuffer_Serial[13] == 'N' || InputBuffer_Serial[13] == 'n') {
-                    RFDebug = false;   // full debug off
-                    QRFDebug = true;   // q debug on
-                    RFUDebug = false;  // undecoded debug off
-                    QRFUDebug = false; // q undecoded debug off
-                    display_Header();
-                    display_Name(PSTR("QRFDEBUG=ON"));
-                    display_Footer();
-                } else {
-                    QRFDebug = false; // q debug off
-                    display_Header();
-                    display_Name(PSTR("QRFDEBUG=OFF"));
-                    display_Footer();
-                }
-            } else if (strncasecmp(InputBuffer_Serial + 3, "QRFUDEBUG=O", 11) == 0) {
-                if (InputBuffer_Serial[14] == 'N' || InputBuffer_Serial[14] == 'n') {
-                    RFDebug = false;  // full debug off
-                    QRFDebug = false; // q debug off
-                    RFUDebug = false; // undecoded debug off
-                    QRFUDebug = true; // q undecoded debug on
-                    display_Header();
-                    display_Name(PSTR("QRFUDEBUG=ON"));
-                    display_Footer();
-                } else {
-                    QRFUDebug = false; // q undecode debug off
-                    display_Header();
-                    display_Name(PSTR("QRFUDEBUG=OFF"));
-                    display_Footer();
-                }
-            } else if (strncasecmp(InputBuffer_Serial + 3, "VERSION", 7) == 0) {
-                display_Header();
-                display_Splash();
-                display_Footer();
-            } else {
-                // -------------------------------------------------------
-                // Handle Generic Commands / Translate protocol data into Nodo text commands
-                // -------------------------------------------------------
-                Radio::set_Radio_mode(Radio::States::Radio_TX);
-
-                if (PluginTXCall(0, InputBuffer_Serial))
-                    ValidCommand = 1;
-                else // Answer that an invalid command was received?
-                    ValidCommand = 2;
-
-                Radio::set_Radio_mode(Radio::States::Radio_RX);
-            }
-        }
-    } // if > 7
-    if (ValidCommand != 0) {
-        display_Header();
-        if (ValidCommand == 1)
-            display_Name(PSTR("OK"));
-        else
-            display_Name(PSTR("CMD UNKNOWN"));
-        display_Footer();
-    }
-    resetSerialBuffer();
-    ValidCommand = 0;
-    return true;
-}
-
 void resetSerialBuffer() {
-    InputBuffer_Serial[0] = 0;
+    serialInput[0] = 0;
     serialBufferCursor = 0;
 }
 
@@ -16,7 +16,6 @@
 #endif
 #define FOCUS_TIME_MS 50      // 50         // Duration in mSec. that, after receiving serial data from USB only the serial port is checked.
 
-extern char InputBuffer_Serial[INPUT_COMMAND_SIZE];
 extern int serialBufferCursor;
 
 void resetSerialBuffer();
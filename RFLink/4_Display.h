@@ -11,6 +11,7 @@
 #include <Arduino.h>
 
 #define PRINT_BUFFER_SIZE 90 // 90         // Maximum number of characters that a command should print in one go via the print buffer.
+#define RETRIEVE_BUFFER_SIZE 100 //         // Maximum number of characters of a command received by a transport
 
 // extern byte PKSequenceNumber;     // 1 byte packet counter
 extern char pbuffer[PRINT_BUFFER_SIZE]; // Buffer for printing data
@@ -83,13 +84,6 @@ void display_METER(unsigned int);
 void display_VOLT(unsigned int);
 void display_RGBW(unsigned int);
 
-void retrieve_Init();
-boolean retrieve_Name(const char *);
-boolean retrieve_ID(unsigned long &);
-boolean retrieve_Switch(byte &);
-boolean retrieve_Command(byte &, byte &);
-boolean retrieve_End();
-
 #define VALUE_PAIR 44
 #define VALUE_ALLOFF 55
 #define VALUE_OFF 74
@@ -103,7 +97,6 @@ boolean retrieve_End();
 #define VALUE_LIMIT 82
 #define VALUE_ALLON 141
 
-int str2cmd(char *);
 void replacechar(char *, char, char);
 
 #if (defined(ESP8266) || defined(ESP32))
@@ -9,6 +9,9 @@
 #include "RFLink.h"
 #include "2_Signal.h"
 #include "5_Plugin.h"
+#include "25_Log.h"
+#include "27_Command.h"
+#include "28_Tokenizer.h"
 
 using namespace RFLink::Signal;
 using namespace RFLink;
@@ -17,6 +20,7 @@ using namespace RFLink;
 boolean (*Plugin_ptr[PLUGIN_MAX])(byte, const char *); // Receive plugins
 byte Plugin_id[PLUGIN_MAX];
 byte Plugin_State[PLUGIN_MAX];
+unsigned long Plugin_Hits[PLUGIN_MAX];
 #ifndef ARDUINO_AVR_UNO // Optimize memory limite to 2048 bytes on arduino uno
 String Plugin_Description[PLUGIN_MAX];
 #endif
@@ -2283,12 +2287,126 @@ byte PluginRXCall(byte Function, const char *str)
       if (Plugin_ptr[x](Function, str))
       {
         SignalHashPrevious = SignalHash; // store previous plugin number after success
+        Plugin_Hits[x]++;
         return true;
       }
     }
   }
   return false;
 }
+/*********************************************************************************************\
+ * Transmit plugins indexed by the protocol name they expect after "10;"
+ * @return 0 if refused, 1 if accepted, 2 if no known plugin handles this name
+ \*********************************************************************************************/
+#define PLUGIN_TX_UNKNOWN_NAME 2
+
+byte PluginTXCallByName(byte Function, const char *str, uint32_t nameHash)
+{
+  using RFLink::Command::keywordHash;
+
+  switch (nameHash)
+  {
+#ifdef PLUGIN_TX_003
+  case keywordHash("KAKU"):
+  case keywordHash("AB400D"):
+  case keywordHash("PT2262"):
+  case keywordHash("TriState"):
+  case keywordHash("Impuls"):
+    return PluginTX_003(Function, str);
+#endif
+#ifdef PLUGIN_TX_004
+  case keywordHash("NewKaku"):
+    return PluginTX_004(Function, str);
+#endif
+#ifdef PLUGIN_TX_005
+  case keywordHash("EURODOMEST"):
+    return PluginTX_005(Function, str);
+#endif
+#ifdef PLUGIN_TX_006
+  case keywordHash("AVIDSEN"):
+  case keywordHash("BLYSS"):
+    return PluginTX_006(Function, str);
+#endif
+#ifdef PLUGIN_TX_007
+  case keywordHash("CONRAD"):
+    return PluginTX_007(Function, str);
+#endif
+#ifdef PLUGIN_TX_008
+  case keywordHash("KAMBROOK"):
+    return PluginTX_008(Function, str);
+#endif
+#ifdef PLUGIN_TX_009
+  case keywordHash("X10"):
+    return PluginTX_009(Function, str);
+#endif
+#ifdef PLUGIN_TX_010
+  case keywordHash("TRC02RGB"):
+    return PluginTX_010(Function, str);
+#endif
+#ifdef PLUGIN_TX_011
+  case keywordHash("HomeConfort"):
+    return PluginTX_011(Function, str);
+#endif
+#ifdef PLUGIN_TX_012
+  case keywordHash("FA500"):
+    return PluginTX_012(Function, str);
+#endif
+#ifdef PLUGIN_TX_013
+  case keywordHash("POWERFIX"):
+    return PluginTX_013(Function, str);
+#endif
+#ifdef PLUGIN_TX_015
+  case keywordHash("HOMEEASY"):
+    return PluginTX_015(Function, str);
+#endif
+#ifdef PLUGIN_TX_070
+  case keywordHash("SELECTPLUS"):
+    return PluginTX_070(Function, str);
+#endif
+#ifdef PLUGIN_TX_072
+  case keywordHash("BYRON"):
+    return PluginTX_072(Function, str);
+#endif
+#ifdef PLUGIN_TX_073
+  case keywordHash("DELTRONIC"):
+    return PluginTX_073(Function, str);
+#endif
+#ifdef PLUGIN_TX_074
+  case keywordHash("BYRON MP"):
+    return PluginTX_074(Function, str);
+#endif
+#ifdef PLUGIN_TX_076
+  case keywordHash("CAME-TOP432"):
+    return PluginTX_076(Function, str);
+#endif
+#ifdef PLUGIN_TX_080
+  case keywordHash("FA20RF"):
+    return PluginTX_080(Function, str);
+#endif
+#if defined(PLUGIN_TX_081) || defined(PLUGIN_TX_082)
+  case keywordHash("MERTIK"): // both variants use the same name
+#ifdef PLUGIN_TX_081
+    if (PluginTX_081(Function, str))
+      return true;
+#endif
+#ifdef PLUGIN_TX_082
+    if (PluginTX_082(Function, str))
+      return true;
+#endif
+    return false;
+#endif
+#ifdef PLUGIN_TX_083
+  case keywordHash("BrelMotor"):
+    return PluginTX_083(Function, str);
+#endif
+#ifdef PLUGIN_TX_087
+  case keywordHash("NOXALARM"):
+    return PluginTX_087(Function, str);
+#endif
+  default:
+    return PLUGIN_TX_UNKNOWN_NAME;
+  }
+}
 /*********************************************************************************************\
  * With this function plugins are called that have Transmit functionality. 
  \*********************************************************************************************/
@@ -2296,6 +2414,15 @@ byte PluginTXCall(byte Function, const char *str)
 {
   int x;
 
+  Tokenizer::Fields fields(str);
+  if (fields.name("10"))
+  {
+    byte result = PluginTXCallByName(Function, str, RFLink::Command::hashKeyword(fields.field(), fields.length()));
+    if (result != PLUGIN_TX_UNKNOWN_NAME)
+      return result;
+  }
+
+  // not indexed, ie a plugin added without updating PluginTXCallByName()
   for (x = 0; x < PLUGIN_TX_MAX; x++)
   {
     if (PluginTX_id[x] != 0)
@@ -24,6 +24,7 @@ enum PState
 extern boolean (*Plugin_ptr[PLUGIN_MAX])(byte, const char *); // Receive plugins
 extern byte Plugin_id[PLUGIN_MAX];
 extern byte Plugin_State[PLUGIN_MAX];
+extern unsigned long Plugin_Hits[PLUGIN_MAX]; // signals decoded by each receive plugin
 #ifndef ARDUINO_AVR_UNO // Optimize memory limite to 2048 bytes on arduino uno
 extern String Plugin_Description[PLUGIN_MAX];
 #endif
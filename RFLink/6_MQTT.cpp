@@ -11,6 +11,9 @@
 #include "4_Display.h"
 #include "6_MQTT.h"
 #include "6_Credentials.h"
+#include "17_Output.h"
+#include "20_Devices.h"
+#include "25_Log.h"
 
 
 #ifdef ESP32
@@ -29,10 +32,21 @@ WiFiClientSecure WIFIClientSecure;
 // MQTT_KEEPALIVE : keepAlive interval in Seconds
 #define MQTT_KEEPALIVE 60
 
-// MQTT_SOCKET_TIMEOUT: socket timeout interval in Seconds
-#define MQTT_SOCKET_TIMEOUT 60
+// MQTT_RECONNECT_INTERVAL : seconds between connection attempts
+#ifndef MQTT_RECONNECT_INTERVAL
+#define MQTT_RECONNECT_INTERVAL 30
+#endif
+
+// MQTT_BATCH_BUFFER_SIZE : largest batch payload, batch_max_size is capped to it
+#ifndef MQTT_BATCH_BUFFER_SIZE
+#if defined(ESP32)
+#define MQTT_BATCH_BUFFER_SIZE 1024
+#else
+#define MQTT_BATCH_BUFFER_SIZE 384
+#endif
+#endif
 
-#include <PubSubClient.h>
+#include "19_MqttClient.h"
 boolean bResub; // uplink reSubscribe after setup only
 
 // Update these with values suitable for your network.
@@ -56,6 +70,19 @@ namespace RFLink { namespace Mqtt {
     bool ssl_enabled;
     bool ssl_insecure;
     String ca_cert;
+
+    uint8_t qos;
+
+    bool batch_enabled;
+    String topic_batch;
+    unsigned long batch_window_ms;
+    unsigned int batch_max_size;
+  }
+
+  namespace counters {
+    unsigned long int batchesPublished = 0;
+    unsigned long int batchedMessages = 0;
+    unsigned long int batchesDropped = 0;
   }
 
 // All json variable names
@@ -75,10 +102,40 @@ const char json_name_topic_lwt[] = "topic_lwt";
 const char json_name_ssl_enabled[] = "ssl_enabled";
 const char json_name_ssl_insecure[] = "ssl_insecure";
 const char json_name_ca_cert[] = "ca_cert";
+
+const char json_name_qos[] = "qos";
+
+const char json_name_batch_enabled[] = "batch_enabled";
+const char json_name_batch_topic[] = "batch_topic";
+const char json_name_batch_window_ms[] = "batch_window_ms";
+const char json_name_batch_max_size[] = "batch_max_size";
 // end of json variable names
 
 struct timeval lastMqttConnectionAttemptTime;
 bool paramsHaveChanged = true; 
+volatile bool reconnectRequested = false; // may be set from WiFi events, handled by checkMQTTloop()
+
+enum ConfigItemIndex {
+  ConfigItem_Enabled,
+  ConfigItem_Server,
+  ConfigItem_Port,
+  ConfigItem_Id,
+  ConfigItem_User,
+  ConfigItem_Password,
+  ConfigItem_TopicIn,
+  ConfigItem_TopicOut,
+  ConfigItem_LwtEnabled,
+  ConfigItem_TopicLwt,
+  ConfigItem_SslEnabled,
+  ConfigItem_SslInsecure,
+  ConfigItem_CaCert,
+  ConfigItem_Qos,
+  ConfigItem_BatchEnabled,
+  ConfigItem_BatchTopic,
+  ConfigItem_BatchWindowMs,
+  ConfigItem_BatchMaxSize,
+  ConfigItem_EOF,
+};
 
 Config::ConfigItem configItems[] =  {
   Config::ConfigItem(json_name_enabled, Config::SectionId::MQTT_id, false, paramsUpdatedCallback),
@@ -98,12 +155,21 @@ Config::ConfigItem configItems[] =  {
   Config::ConfigItem(json_name_ssl_insecure,Config::SectionId::MQTT_id, true, paramsUpdatedCallback),
   Config::ConfigItem(json_name_ca_cert,     Config::SectionId::MQTT_id, "", paramsUpdatedCallback),
 
+  Config::ConfigItem(json_name_qos,         Config::SectionId::MQTT_id, 1, paramsUpdatedCallback),
+
+  Config::ConfigItem(json_name_batch_enabled,  Config::SectionId::MQTT_id, false, paramsUpdatedCallback),
+  Config::ConfigItem(json_name_batch_topic,    Config::SectionId::MQTT_id, "", paramsUpdatedCallback),
+  Config::ConfigItem(json_name_batch_window_ms,Config::SectionId::MQTT_id, 1000, paramsUpdatedCallback),
+  Config::ConfigItem(json_name_batch_max_size, Config::SectionId::MQTT_id, MQTT_BATCH_BUFFER_SIZE, paramsUpdatedCallback),
+
   Config::ConfigItem()
 };
+static_assert(sizeof(configItems) / sizeof(Config::ConfigItem) == ConfigItem_EOF + 1, "configItems has missing/extra items, please compare with ConfigItemIndex enum declarations");
 
-PubSubClient MQTTClient; // MQTTClient(WIFIClient);
+MqttClient MQTTClient; // see 19_MqttClient.h, never blocks the main loop
+MqttClient::State lastState = MqttClient::State_Disconnected;
 
-void callback(char *, byte *, unsigned int);
+void callback(char *, uint8_t *, unsigned int);
 
 void paramsUpdatedCallback() {
   refreshParametersFromConfig();
@@ -114,79 +180,79 @@ void refreshParametersFromConfig(bool triggerChanges) {
     Config::ConfigItem *item;
     bool changesDetected = false;
 
-    item = Config::findConfigItem(json_name_enabled, Config::SectionId::MQTT_id);
+    item = &configItems[ConfigItem_Enabled];
     if( item->getBoolValue() != params::enabled) {
       changesDetected = true;
       params::enabled = item->getBoolValue();
     }
 
-    item = Config::findConfigItem(json_name_server, Config::SectionId::MQTT_id);
+    item = &configItems[ConfigItem_Server];
     if( params::server != item->getCharValue() ) {
       changesDetected = true;
       params::server = item->getCharValue();
     }
 
-    item = Config::findConfigItem(json_name_port, Config::SectionId::MQTT_id);
+    item = &configItems[ConfigItem_Port];
     if( item->getLongIntValue() != params::port) {
       changesDetected = true;
       params::port = item->getLongIntValue();
     }
 
-    item = Config::findConfigItem(json_name_id, Config::SectionId::MQTT_id);
+    item = &configItems[ConfigItem_Id];
     if( params::id != item->getCharValue() ) {
       changesDetected = true;
       params::id = item->getCharValue();
     }
 
-    item = Config::findConfigItem(json_name_user, Config::SectionId::MQTT_id);
+    item = &configItems[ConfigItem_User];
     if( params::user != item->getCharValue() ) {
       changesDetected = true;
       params::user = item->getCharValue();
     }
 
-    item = Config::findConfigItem(json_name_password, Config::SectionId::MQTT_id);
+    item = &configItems[ConfigItem_Password];
     if( params::password != item->getCharValue() ) {
       changesDetected = true;
       params::password = item->getCharValue();
     }
 
-    item = Config::findConfigItem(json_name_topic_in, Config::SectionId::MQTT_id);
+    item = &configItems[ConfigItem_TopicIn];
     if( params::topic_in != item->getCharValue() ) {
       changesDetected = true;
       params::topic_in = item->getCharValue();
     }
 
-    item = Config::findConfigItem(json_name_topic_out, Config::SectionId::MQTT_id);
+    item = &configItems[ConfigItem_TopicOut];
     if( params::topic_out != item->getCharValue() ) {
       changesDetected = true;
       params::topic_out = item->getCharValue();
     }
 
-    item = Config::findConfigItem(json_name_lwt_enabled, Config::SectionId::MQTT_id);
+    item = &configItems[ConfigItem_LwtEnabled];
     if( item->getBoolValue() != params::lwt_enabled) {
       changesDetected = true;
       params::lwt_enabled = item->getBoolValue();
     }
 
-    item = Config::findConfigItem(json_name_topic_lwt, Config::SectionId::MQTT_id);
+    item = &configItems[ConfigItem_TopicLwt];
     if( params::topic_lwt != item->getCharValue() ) {
       changesDetected = true;
       params::topic_lwt = item->getCharValue();
     }
 
-    item = Config::findConfigItem(json_name_ssl_enabled, Config::SectionId::MQTT_id);
+    item = &configItems[ConfigItem_SslEnabled];
     if( item->getBoolValue() != params::ssl_enabled) {
       changesDetected = true;
       params::ssl_enabled = item->getBoolValue();
     }
 
-    item = Config::findConfigItem(json_name_ssl_insecure, Config::SectionId::MQTT_id);
+    item = &configItems[ConfigItem_SslInsecure];
     if( item->getBoolValue() != params::ssl_insecure) {
       changesDetected = true;
       params::ssl_insecure = item->getBoolValue();
     }
 
-    item = Config::findConfigItem(json_name_ca_cert, Config::SectionId::MQTT_id);
+    item = &configItems[ConfigItem_CaCert];
     if( params::ca_cert != item->getCharValue() ) {
       changesDetected = true;
       params::ca_cert = item->getCharValue();
@@ -197,16 +263,141 @@ void refreshParametersFromConfig(bool triggerChanges) {
       #endif
     }
 
+    // only affects messages published from now on, no need to reconnect
+    item = &configItems[ConfigItem_Qos];
+    if (item->getLongIntValue() < 0 || item->getLongIntValue() > 1) {
+      Log::printf(Log::Module_Mqtt, Log::Level_Warning, PSTR("MQTT: unsupported qos %ld, falling back to 1"), item->getLongIntValue());
+      item->setLongIntValue(1);
+    }
+    params::qos = item->getLongIntValue();
+
+    // batching settings don't need a reconnection either
+    item = &configItems[ConfigItem_BatchEnabled];
+    params::batch_enabled = item->getBoolValue();
+
+    item = &configItems[ConfigItem_BatchTopic];
+    params::topic_batch = item->getCharValue();
+    if (params::topic_batch.length() == 0)
+      params::topic_batch = params::topic_out + F("/batch");
+
+    item = &configItems[ConfigItem_BatchWindowMs];
+    params::batch_window_ms = item->getLongIntValue();
+
+    item = &configItems[ConfigItem_BatchMaxSize];
+    if (item->getLongIntValue() < 2 * PRINT_BUFFER_SIZE + 4 || item->getLongIntValue() > MQTT_BATCH_BUFFER_SIZE) {
+      Log::printf(Log::Module_Mqtt, Log::Level_Warning, PSTR("MQTT: batch_max_size must be between %d and %d, falling back to %d"), 2 * PRINT_BUFFER_SIZE + 4, MQTT_BATCH_BUFFER_SIZE, MQTT_BATCH_BUFFER_SIZE);
+      item->setLongIntValue(MQTT_BATCH_BUFFER_SIZE);
+    }
+    params::batch_max_size = item->getLongIntValue();
+
 
     // Applying changes will happen in mainLoop()
     if(triggerChanges && changesDetected) {
-      Serial.println(F("Mqtt parameters have changed, they will be applied at next 'loop'."));
+      Log::printf(Log::Module_Mqtt, Log::Level_Info, PSTR("Mqtt parameters have changed, they will be applied at next 'loop'."));
       paramsHaveChanged = true; 
     }
 
 }
 
 
+bool sinkIsEnabled()
+{
+  return params::enabled;
+}
+
+// reconnection is left to checkMQTTloop(), messages wait in the sink queue meanwhile,
+// so do they while the QoS 1 in-flight window is full
+bool sinkIsReady(size_t length)
+{
+  if (params::qos > 0)
+    return MQTTClient.canPublish(params::topic_out.length(), length);
+  return MQTTClient.connected();
+}
+
+char batchBuffer[MQTT_BATCH_BUFFER_SIZE];
+size_t batchLength = 0; // 0 means no batch is open
+unsigned long batchStartTime = 0;
+
+/**
+ * Only sensor readings are batched: command answers and messages without a device ID are not,
+ * neither are events (switches, remotes, motion, alarms, doorbells) which must reach the controller right away
+ * */
+bool isBatchable(const char *msg)
+{
+  size_t length = strlen(msg);
+  return length > 6 && strstr_P(msg, PSTR(";ID=")) != nullptr && !Devices::isEvent(msg + 6, length - 6);
+}
+
+/**
+ * Publishes the open batch as a JSON array of messages
+ * @return false if it could not be handed to the MQTT client, batch is kept
+ * */
+bool flushBatch()
+{
+  if (batchLength == 0)
+    return true;
+
+  batchBuffer[batchLength] = ']'; // room was kept for it
+  if (!MQTTClient.publish(params::topic_batch.c_str(), (const uint8_t *) batchBuffer, batchLength + 1, false, params::qos))
+    return false;
+
+  counters::batchesPublished++;
+  batchLength = 0;
+  return true;
+}
+
+bool appendToBatch(const char *msg, size_t length)
+{
+  while (length > 0 && (msg[length - 1] == '\r' || msg[length - 1] == '\n'))
+    length--;
+
+  // worst case every char is escaped, plus '[' or ',', quotes and the closing ']'
+  if (batchLength > 0 && batchLength + 2 * length + 4 > params::batch_max_size) {
+    if (!flushBatch()) {
+      counters::batchesDropped++; // broker can't keep up, make room anyway
+      batchLength = 0;
+    }
+  }
+
+  if (batchLength == 0) {
+    batchStartTime = millis();
+    batchBuffer[batchLength++] = '[';
+  } else
+    batchBuffer[batchLength++] = ',';
+
+  batchBuffer[batchLength++] = '"';
+  for (size_t i = 0; i < length; i++) {
+    if (msg[i] == '"' || msg[i] == '\\')
+      batchBuffer[batchLength++] = '\\';
+    batchBuffer[batchLength++] = msg[i];
+  }
+  batchBuffer[batchLength++] = '"';
+
+  counters::batchedMessages++;
+  return true;
+}
+
+void checkBatch()
+{
+  if (batchLength == 0)
+    return;
+  if (!params::batch_enabled || millis() - batchStartTime >= params::batch_window_ms)
+    flushBatch(); // retried next loop if it failed
+}
+
+bool sinkWrite(const char *msg, size_t length)
+{
+  static boolean MQTT_RETAINED = MQTT_RETAINED_0;
+
+  if (params::batch_enabled && isBatchable(msg))
+    return appendToBatch(msg, length);
+
+  return MQTTClient.publish(params::topic_out.c_str(), (const uint8_t *) msg, length, MQTT_RETAINED, params::qos);
+}
+
+Output::Sink sink("mqtt", Output::Format_Line, Output::Drop_Oldest, OUTPUT_POOL_SIZE,
+                  sinkIsEnabled, sinkIsReady, sinkWrite);
+
 void setup_MQTT()
 {
   refreshParametersFromConfig(false);
@@ -235,135 +426,139 @@ void setup_MQTT()
   else
     MQTTClient.setClient(WIFIClient);
 
-  MQTTClient.setServer(params::server.c_str(), params::port);
+  if (!MQTTClient.setServer(params::server.c_str(), params::port))
+    Log::printf(Log::Module_Mqtt, Log::Level_Error, PSTR("MQTT: server name '%s' is too long"), params::server.c_str());
   MQTTClient.setCallback(callback);
   bResub = true;
+
+#ifndef RFLINK_MQTT_DISABLED
+  Output::registerSink(&sink);
+#endif // !RFLINK_MQTT_DISABLED
 }
 
-void callback(char *topic, byte *payload, unsigned int length)
+void callback(char *topic, uint8_t *payload, unsigned int length)
 {
   payload[length] = 0;
   CheckMQTT(payload);
 }
 
 
-void reconnect(int retryCount, bool force)
+void reconnect(bool force)
 {
   if(!params::enabled)
     return;
 
-  struct timeval currentTime;
-  gettimeofday(&currentTime, nullptr);
-
-  if(!force) {
-    if(currentTime.tv_sec- lastMqttConnectionAttemptTime.tv_sec < 30) {
-      return;
-    }
-  }
-
-  int retryLeft = retryCount;
-  bResub = true;
-
-  if(force && MQTTClient.connected()) {
-    MQTTClient.disconnect();
+  if(force) {
+    reconnectRequested = true;
+    return;
   }
 
+  struct timeval currentTime;
+  gettimeofday(&currentTime, nullptr);
 
-  while (!MQTTClient.connected() && (retryCount<=0 || retryLeft>0))
-  {
-    retryLeft--;
-    lastMqttConnectionAttemptTime.tv_sec = currentTime.tv_sec;
-
-    Serial.print(F("Trying to connect to MQTT Server '"));
-    Serial.print(params::server.c_str());
-    Serial.print(F("' ... "));
+  if(currentTime.tv_sec - lastMqttConnectionAttemptTime.tv_sec < MQTT_RECONNECT_INTERVAL)
+    return;
 
-    bool connectOK;
+  if(MQTTClient.getState() != MqttClient::State_Disconnected)
+    return;
 
-    if(params::lwt_enabled) {
-      #ifdef ESP32
-      connectOK = MQTTClient.connect(params::id.c_str(), params::user.c_str(), params::password.c_str(), (params::topic_lwt).c_str(), 2, true, PSTR("Offline"));
-      #elif defined(ESP8266)
-      connectOK = MQTTClient.connect(params::id.c_str(), params::user.c_str(), params::password.c_str(), (params::topic_lwt).c_str(), 2, true, "Offline");
-      #endif // ESP
+  lastMqttConnectionAttemptTime.tv_sec = currentTime.tv_sec;
+  bResub = true;
 
-    } else {
-      connectOK = MQTTClient.connect(params::id.c_str(), params::user.c_str(), params::password.c_str());
-    }
+  Log::printf(Log::Module_Mqtt, Log::Level_Info, PSTR("Trying to connect to MQTT Server '%s' ... "), params::server.c_str());
 
-    if(connectOK)
-    {
-      Serial.println(F("Established"));
-      Serial.print(F("MQTT ID :\t\t"));
-      Serial.println(params::id.c_str());
-      Serial.print(F("MQTT Username :\t\t"));
-      Serial.println(params::user.c_str());
-      if(params::lwt_enabled) {
-        #ifdef ESP32
-              MQTTClient.publish((params::topic_lwt).c_str(), PSTR("Online"), true);
-        #elif ESP8266
-              MQTTClient.publish((params::topic_lwt).c_str(), "Online", true);
-        #endif // ESP
-      }
-    }
-    else
-    {
-      Serial.print(F("Failed - rc="));
-      Serial.println(MQTTClient.state());
-    }
-  }
+  bool started;
+  if(params::lwt_enabled)
+    started = MQTTClient.beginConnect(params::id.c_str(), params::user.c_str(), params::password.c_str(), params::topic_lwt.c_str(), 1, true, "Offline");
+  else
+    started = MQTTClient.beginConnect(params::id.c_str(), params::user.c_str(), params::password.c_str());
+  if(!started)
+    Log::printf(Log::Module_Mqtt, Log::Level_Error, PSTR("MQTT connection not started, client ID, credentials and LWT topic must fit in %d bytes"), MQTT_CLIENT_CONNECT_DATA_SIZE);
 }
 
-void publishMsg()
+/**
+ * Connection happens in background, this reports its outcome
+ * */
+void checkConnectionState()
 {
-  if(!params::enabled)
+  MqttClient::State state = MQTTClient.getState();
+  if(state == lastState)
     return;
 
-  static boolean MQTT_RETAINED = MQTT_RETAINED_0;
+  if(state == MqttClient::State_Connected)
+  {
+    Log::printf(Log::Module_Mqtt, Log::Level_Info, PSTR("MQTT connection established, ID '%s', username '%s'"), params::id.c_str(), params::user.c_str());
+    if(params::lwt_enabled)
+      MQTTClient.publish(params::topic_lwt.c_str(), "Online", true, 1);
+  }
+  else if(state == MqttClient::State_Disconnected)
+  {
+    if(lastState == MqttClient::State_Connected)
+      Log::printf(Log::Module_Mqtt, Log::Level_Warning, PSTR("MQTT connection lost - rc=%i"), MQTTClient.lastError());
+    else
+      Log::printf(Log::Module_Mqtt, Log::Level_Warning, PSTR("MQTT connection failed - rc=%i"), MQTTClient.lastError());
+  }
 
-  if (!MQTTClient.connected())
-    reconnect(1);
-  MQTTClient.publish(params::topic_out.c_str(), pbuffer, MQTT_RETAINED);
+  lastState = state;
 }
 
 void checkMQTTloop()
 {
   if(!params::enabled) {
+    if(MQTTClient.getState() != MqttClient::State_Disconnected)
+      MQTTClient.disconnect();
     return;
   }
 
-  if(paramsHaveChanged) {
+  // the connect task may still be using the client, wait for it
+  if(paramsHaveChanged && MQTTClient.getState() != MqttClient::State_Connecting) {
     paramsHaveChanged = false;
     if(params::ssl_enabled)
       MQTTClient.setClient(WIFIClientSecure);
     else {
       MQTTClient.setClient(WIFIClient);
     }
-    MQTTClient.setServer(params::server.c_str(), params::port);
-    reconnect(1, true);
-    gettimeofday(&lastMqttConnectionAttemptTime, nullptr);
-    return;
+    if (!MQTTClient.setServer(params::server.c_str(), params::port))
+      Log::printf(Log::Module_Mqtt, Log::Level_Error, PSTR("MQTT: server name '%s' is too long"), params::server.c_str());
+    reconnectRequested = true;
   }
 
-  static unsigned long lastCheck = millis();
-
-  if (millis() > lastCheck + MQTT_LOOP_MS)
-  {
-    if (!MQTTClient.connected()) {
-      reconnect(1);
+  if(reconnectRequested) {
+    MQTTClient.disconnect(); // aborts a connection in progress too
+    if(MQTTClient.getState() == MqttClient::State_Disconnected) {
+      reconnectRequested = false;
+      lastMqttConnectionAttemptTime.tv_sec = 0;
     }
+  }
 
-    if (bResub)
-    {
-      // Once connected, resubscribe
-      MQTTClient.subscribe(params::topic_in.c_str());
-      bResub = false;
-      delay(10);
-    }
-    MQTTClient.loop();
-    lastCheck = millis();
+  if (MQTTClient.getState() == MqttClient::State_Disconnected && !reconnectRequested)
+    reconnect();
+
+  // every loop, so incoming commands are handled within milliseconds
+  MQTTClient.loop();
+  checkConnectionState();
+
+  checkBatch();
+
+  if (bResub && MQTTClient.connected())
+  {
+    // Once connected, resubscribe
+    MQTTClient.subscribe(params::topic_in.c_str(), 1);
+    bResub = false;
   }
+}
+
+bool publishRetained(const char *subTopic, const char *payload)
+{
+  if(!params::enabled || !MQTTClient.connected())
+    return false;
+
+  String topic = params::topic_out + '/' + subTopic;
+  return MQTTClient.publish(topic.c_str(), payload, true, params::qos);
+}
 
+uint8_t inFlight() {
+  return MQTTClient.inFlight();
 }
 
 void getStatusJsonString(JsonObject &output) {
@@ -372,6 +567,8 @@ void getStatusJsonString(JsonObject &output) {
   if(params::enabled) {
     if( MQTTClient.connected() ) {
       mqtt["status"] = "connected";
+    } else if( MQTTClient.getState() != MqttClient::State_Disconnected ) {
+      mqtt["status"] = "connecting";
     } else {
       mqtt["status"] = "error";
     }
@@ -379,6 +576,19 @@ void getStatusJsonString(JsonObject &output) {
     mqtt["status"] = "disabled";
   }
 
+  mqtt[F("qos")] = params::qos;
+  mqtt[F("in_flight")] = MQTTClient.inFlight();
+  mqtt[F("published")] = MQTTClient.published;
+  mqtt[F("acknowledged")] = MQTTClient.acknowledged;
+  mqtt[F("retransmitted")] = MQTTClient.retransmitted;
+  mqtt[F("received")] = MQTTClient.received;
+  mqtt[F("ack_timeouts")] = MQTTClient.ackTimeouts;
+  mqtt[F("max_ack_time_ms")] = MQTTClient.maxAckTime_ms;
+
+  mqtt[F("batch_enabled")] = params::batch_enabled;
+  mqtt[F("batches_published")] = counters::batchesPublished;
+  mqtt[F("batched_messages")] = counters::batchedMessages;
+  mqtt[F("batches_dropped")] = counters::batchesDropped;
 
 }
 
@@ -52,10 +52,24 @@ namespace RFLink { namespace Mqtt {
     }
 
 void setup_MQTT();
-void reconnect(int retryCount=-1, bool force=false);
-void publishMsg();
+/**
+ * Starts a background connection attempt if none happened recently.
+ * @param force drop current connection and reconnect from next checkMQTTloop(), safe from other tasks
+ * */
+void reconnect(bool force=false);
 void checkMQTTloop();
 
+/**
+ * Publishes a retained message to <topic_out>/<subTopic>
+ * @return false if not connected or client can't take it now
+ * */
+bool publishRetained(const char *subTopic, const char *payload);
+
+/**
+ * @return QoS 1 messages waiting for their PUBACK
+ * */
+uint8_t inFlight();
+
 void paramsUpdatedCallback();
 void refreshParametersFromConfig(bool triggerChanges=true);
 
@@ -13,6 +13,7 @@
 
 #include "4_Display.h"
 #include "8_OLED.h"
+#include "17_Output.h"
 #include <U8x8lib.h> // Comment to avoid dependency graph inclusion
 
 #define U8X8_PIN_NONE 255
@@ -27,6 +28,16 @@ U8X8_SSD1306_128X64_NONAME_HW_I2C u8x8(/* reset=*/U8X8_PIN_NONE, /* clock=*/PIN_
 uint8_t u8log_buffer[U8LOG_WIDTH * U8LOG_HEIGHT];
 U8X8LOG u8x8log;
 
+bool oledSinkWrite(const char *msg, size_t length)
+{
+    print_OLED(msg);
+    return true;
+}
+
+// only the last message is worth displaying
+RFLink::Output::Sink oledSink("oled", RFLink::Output::Format_Line, RFLink::Output::Drop_Oldest, 1,
+                              nullptr, nullptr, oledSinkWrite);
+
 void setup_OLED()
 {
     u8x8.begin();
@@ -37,6 +48,8 @@ void setup_OLED()
     u8x8log.begin(u8x8, U8LOG_WIDTH, U8LOG_HEIGHT, u8log_buffer);
     u8x8log.setRedrawMode(0); // 0: Update screen with newline, 1: Update screen for every char
     u8x8log.setLineHeightOffset(0);
+
+    RFLink::Output::registerSink(&oledSink);
 }
 
 void splash_OLED()
@@ -53,7 +66,7 @@ void splash_OLED()
     u8x8.setPowerSave(0);
 }
 
-void print_OLED()
+void print_OLED(const char *msg)
 {
     /*
     static char delim[2] = ";";
@@ -75,9 +88,13 @@ void print_OLED()
         ptr = strtok(NULL, delim);
     }
 */
+    char buffer[PRINT_BUFFER_SIZE];
+
+    strncpy(buffer, msg, PRINT_BUFFER_SIZE - 1);
+    buffer[PRINT_BUFFER_SIZE - 1] = 0;
     u8x8log.print('\f');
-    replacechar(pbuffer, ';', '\n');
-    u8x8log.print(pbuffer);
+    replacechar(buffer, ';', '\n');
+    u8x8log.print(buffer);
 }
 
 #endif // OLED_ENABLED
\ No newline at end of file
@@ -1,5 +1,9 @@
 #include "9_Serial2Net.h"
 #include "RFLink.h"
+#include "4_Display.h"
+#include "17_Output.h"
+#include "25_Log.h"
+#include "27_Command.h"
 
 #ifndef RFLINK_SERIAL2NET_DISABLED
 
@@ -7,30 +11,180 @@
 #include <WiFiClient.h>
 #include <WiFiServer.h>
 #include <lwip/sockets.h>
+#include <errno.h>
 
 namespace RFLink { namespace Serial2Net {
 
+        /**
+         * @return true if name is found in a comma separated list, or is a prefix of one of its items when prefix=true
+         * */
+        bool matchesList(const char *list, const char *name, size_t nameLength, bool prefix) {
+            while (*list != 0) {
+                const char *end = strchr(list, ',');
+                size_t itemLength = end == nullptr ? strlen(list) : end - list;
+
+                if (prefix ? (itemLength <= nameLength && strncasecmp(list, name, itemLength) == 0)
+                           : (itemLength == nameLength && strncasecmp(list, name, nameLength) == 0))
+                    return true;
+
+                if (end == nullptr)
+                    break;
+                list = end + 1;
+            }
+            return false;
+        }
+
         class Serial2NetClient : public WiFiClient {
 
         private:
-            static const uint16_t __buffer_size = 64;
-            char buffer[__buffer_size+1];
+            char buffer[SERIAL2NET_RX_BUFFER_SIZE+1];
             uint16_t buffer_end = 0;
+            uint16_t buffer_scanned = 0; // bytes already searched for an end of line
+
+            // subscription filters, all empty means everything is sent
+            char filterProtocols[SERIAL2NET_FILTER_SIZE];
+            char filterIds[SERIAL2NET_FILTER_SIZE];
+            bool filterUndecoded = false;
+            bool atLineStart = true;
+            bool lineAccepted = true;
+
+            char txBuffer[SERIAL2NET_TX_BUFFER_SIZE];
+            uint16_t txTail = 0;  // oldest byte not sent yet
+            uint16_t txCount = 0;
+
+            /**
+             * @return bytes accepted by the TCP stack without waiting, -1 on socket error
+             * */
+            int sendNonBlocking(const char *data, size_t length) {
+#ifdef ESP32
+                int result = ::send(fd(), data, length, MSG_DONTWAIT);
+                if (result < 0)
+                    return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+                return result;
+#else
+                size_t room = availableForWrite();
+                if (room == 0)
+                    return 0;
+                if (length > room)
+                    length = room;
+                return write((const uint8_t *) data, length);
+#endif
+            }
+
+            /**
+             * Discards bytes up to and including the oldest end of line
+             * */
+            void dropOldestLine() {
+                while (txCount > 0) {
+                    char c = txBuffer[txTail];
+                    txTail = (txTail + 1) % SERIAL2NET_TX_BUFFER_SIZE;
+                    txCount--;
+                    bytesDropped++;
+                    if (c == '\n')
+                        break;
+                }
+            }
 
         public:
             bool ignore = true;
 
+            unsigned long bytesSent = 0;
+            unsigned long bytesDropped = 0;
+            unsigned long dropEvents = 0;
+            uint16_t txHighWater = 0;
+
             Serial2NetClient(): WiFiClient::WiFiClient(){
-                buffer[__buffer_size] = 0;
+                buffer[SERIAL2NET_RX_BUFFER_SIZE] = 0;
+                clearFilters();
             }
 
             Serial2NetClient & operator=(const WiFiClient &other)  {
                 WiFiClient::operator=(other);
                 ignore = false;
                 buffer_end = 0;
+                buffer_scanned = 0;
+                clearFilters();
+                atLineStart = true;
+                lineAccepted = true;
+                txTail = 0;
+                txCount = 0;
+                bytesSent = 0;
+                bytesDropped = 0;
+                dropEvents = 0;
+                txHighWater = 0;
                 return *this;
             }
 
+            inline uint16_t txPending() const {
+                return txCount;
+            }
+
+            /**
+             * Copies msg to the send buffer and sends what the TCP stack accepts right away.
+             * When full, params::slow_client_policy applies.
+             * @return false if the client has been disconnected
+             * */
+            bool queue(const char *msg, size_t length) {
+                if (length > (size_t)(SERIAL2NET_TX_BUFFER_SIZE - txCount)) {
+                    drain(); // TCP stack may have room by now
+
+                    if (length > (size_t)(SERIAL2NET_TX_BUFFER_SIZE - txCount)) {
+                        dropEvents++;
+
+                        if (params::slow_client_policy == SlowClient_Disconnect) {
+                            counters::slowClientDisconnects++;
+                            disconnectAndClear();
+                            return false;
+                        }
+
+                        if (length > SERIAL2NET_TX_BUFFER_SIZE) {
+                            bytesDropped += length;
+                            return true;
+                        }
+
+                        while (length > (size_t)(SERIAL2NET_TX_BUFFER_SIZE - txCount))
+                            dropOldestLine();
+                    }
+                }
+
+                uint16_t head = (txTail + txCount) % SERIAL2NET_TX_BUFFER_SIZE;
+                size_t firstPart = SERIAL2NET_TX_BUFFER_SIZE - head;
+                if (firstPart > length)
+                    firstPart = length;
+                memcpy(txBuffer + head, msg, firstPart);
+                memcpy(txBuffer, msg + firstPart, length - firstPart);
+                txCount += length;
+                if (txCount > txHighWater)
+                    txHighWater = txCount;
+
+                drain();
+                return !ignore;
+            }
+
+            /**
+             * Sends as much of the send buffer as possible without blocking
+             * */
+            void drain() {
+                while (txCount > 0) {
+                    uint16_t chunk = txCount;
+                    if (txTail + chunk > SERIAL2NET_TX_BUFFER_SIZE)
+                        chunk = SERIAL2NET_TX_BUFFER_SIZE - txTail;
+
+                    int sent = sendNonBlocking(txBuffer + txTail, chunk);
+                    if (sent < 0) {
+                        disconnectAndClear();
+                        return;
+                    }
+
+                    txTail = (txTail + sent) % SERIAL2NET_TX_BUFFER_SIZE;
+                    txCount -= sent;
+                    bytesSent += sent;
+
+                    if (sent < chunk)
+                        return; // TCP window is full, try again later
+                }
+            }
+
             void enabledTcpKeepalive() {
                 int keepAlive = 1; // used only with ESP32
                 int keepIdle = 30;
@@ -49,75 +203,186 @@ namespace RFLink { namespace Serial2Net {
             }
 
             /**
-             * @return -1 if not found or error, index of last character of the commeand if found
+             * Reads what the client has sent, without any heap allocation
+             * @return NUL terminated command without its end of line, or nullptr if none is complete yet.
+             *         It stays valid until consumeCommand() is called
              * */
-            int hasCommandAvailable() {
-#if defined(RFLINK_SERIAL2NET_DEBUG) || defined(DEBUG)
-                String debugmsg;
-#endif
-
-                int newBytesCount = available();
-
+            char *readCommand() {
                 if( !connected() ) { // some errors happened during read operations
                     ignore = true;
-                    return -1;
+                    return nullptr;
                 }
 
-                if(newBytesCount < 1)
-                    return -1;
-
-#if defined(RFLINK_SERIAL2NET_DEBUG) || defined(DEBUG)
-                debugmsg += "Serial2Net: client has " + String(newBytesCount) + " more bytes to available to read";
-                    Serial.println(debugmsg);
-#endif
-
-                uint16_t spaceLeft = __buffer_size - buffer_end;
+                int newBytesCount = available();
+                uint16_t spaceLeft = SERIAL2NET_RX_BUFFER_SIZE - buffer_end;
 
                 if(newBytesCount > spaceLeft)
                     newBytesCount = spaceLeft;
 
-                readBytes(buffer + buffer_end, newBytesCount);
-
-                int result = -1;
+                if(newBytesCount > 0) {
+                    Log::printf(Log::Module_Serial2Net, Log::Level_Debug, PSTR("Serial2Net: client has %i more bytes available to read"), newBytesCount);
+                    buffer_end += readBytes(buffer + buffer_end, newBytesCount);
+                }
 
-                for(int i=buffer_end; i < buffer_end + newBytesCount; i++) {
-                    if(buffer[i] == 0x0d ||buffer[i] == 0x0a) {  // '\r' or "\n"
-                        result = i-1;
-#if defined(RFLINK_SERIAL2NET_DEBUG) || defined(DEBUG)
-                        debugmsg += "Serial2Net: end of command found at position " + String(result) ;
-                        Serial.println(debugmsg);
-#endif
-                        break;
+                for(; buffer_scanned < buffer_end; buffer_scanned++) {
+                    if(buffer[buffer_scanned] == 0x0d || buffer[buffer_scanned] == 0x0a) {  // '\r' or "\n"
+                        buffer[buffer_scanned] = 0;
+                        return buffer;
                     }
                 }
-                buffer_end += newBytesCount;
 
-                if( result < 0 && buffer_end >= __buffer_size - 1 ){
+                if( buffer_end >= SERIAL2NET_RX_BUFFER_SIZE ){
                     println(F("Command is too long, we're closing this connection!"));
-                    ignore = true;
-                    stop();
-                    return -1;
+                    disconnectAndClear();
                 }
 
-                return result;
+                return nullptr;
+            }
+
+            /**
+             * Removes the command returned by readCommand() and the end of line which follows it
+             * */
+            void consumeCommand(){
+                if (ignore || buffer_end == 0) // disconnected while the command was executed, nothing left to consume
+                    return;
+
+                uint16_t next = buffer_scanned + 1;
+                if (next > buffer_end)
+                    next = buffer_end;
+
+                while (next < buffer_end && (buffer[next] == 0x0d || buffer[next] == 0x0a))
+                    next++;
+
+                memmove(buffer, buffer + next, buffer_end - next);
+                buffer_end -= next;
+                buffer_scanned = 0;
+            }
+
+            void clearFilters() {
+                filterProtocols[0] = 0;
+                filterIds[0] = 0;
+                filterUndecoded = false;
             }
 
             /**
-             * Removes the command of which end at given position from the buffer (does not include new line character)
+             * Parses "protocol=a,b;id=00c1,ab;undecoded;" or "all;"
+             * @return false if a field is unknown or too long, filters are left partially updated
              * */
-            String consumeCommand(uint16_t position){
-                buffer[position+1] = 0;
-                String result(buffer);
+            bool setFilters(const char *fields) {
+                while (*fields != 0) {
+                    const char *end = strchr(fields, ';');
+                    size_t length = end == nullptr ? strlen(fields) : end - fields;
+                    char *target = nullptr;
+                    size_t nameLength = 0;
+
+                    if (length == 3 && strncasecmp(fields, "all", 3) == 0)
+                        clearFilters();
+                    else if (length == 9 && strncasecmp(fields, "undecoded", 9) == 0)
+                        filterUndecoded = true;
+                    else if (strncasecmp(fields, "protocol=", 9) == 0) {
+                        target = filterProtocols;
+                        nameLength = 9;
+                    } else if (strncasecmp(fields, "id=", 3) == 0) {
+                        target = filterIds;
+                        nameLength = 3;
+                    } else if (length > 0)
+                        return false;
+
+                    if (target != nullptr) {
+                        if (length - nameLength >= SERIAL2NET_FILTER_SIZE)
+                            return false;
+                        memcpy(target, fields + nameLength, length - nameLength);
+                        target[length - nameLength] = 0;
+                    }
 
-                if (buffer[position+2] == 0x0A) { // "\n"
-                    memcpy(buffer, buffer+position+3, buffer_end - position - 2);
-                    buffer_end = buffer_end - position - 3;
+                    if (end == nullptr)
+                        break;
+                    fields = end + 1;
                 }
-                else{
-                    memcpy(buffer, buffer+position+2, buffer_end - position - 1);
-                    buffer_end = buffer_end - position - 2;
+                return true;
+            }
+
+            void printFilters(char *output, size_t size) {
+                if (filterProtocols[0] == 0 && filterIds[0] == 0 && !filterUndecoded) {
+                    snprintf_P(output, size, PSTR(";ALL"));
+                    return;
+                }
+                snprintf_P(output, size, PSTR(";PROTOCOL=%s;ID=%s;UNDECODED=%s"),
+                           filterProtocols[0] == 0 ? "*" : filterProtocols,
+                           filterIds[0] == 0 ? "*" : filterIds,
+                           filterUndecoded ? "ON" : "OFF");
+            }
+
+            /**
+             * Undecoded frames are 20;XX;DEBUG;... lines, device messages carry an ID field.
+             * Anything else (command replies, status) is always sent.
+             * */
+            bool acceptsLine(const char *line) {
+                bool deviceFilters = filterProtocols[0] != 0 || filterIds[0] != 0;
+
+                if (!deviceFilters && !filterUndecoded)
+                    return true;
+
+                if (strncmp(line, "20;", 3) != 0)
+                    return true;
+
+                const char *name = strchr(line + 3, ';');
+                if (name == nullptr)
+                    return true;
+                name++;
+                const char *nameEnd = strchr(name, ';');
+                size_t nameLength = nameEnd == nullptr ? strlen(name) : nameEnd - name;
+
+                if (nameLength == 5 && strncmp(name, "DEBUG", 5) == 0)
+                    return filterUndecoded;
+
+                const char *id = strstr(name, ";ID=");
+                if (id == nullptr || (nameLength == 5 && strncmp(name, "BATCH", 5) == 0))
+                    return true;
+
+                if (!deviceFilters)
+                    return false;
+
+                if (filterProtocols[0] != 0 && !matchesList(filterProtocols, name, nameLength, false))
+                    return false;
+
+                if (filterIds[0] != 0) {
+                    id += 4;
+                    const char *idEnd = strchr(id, ';');
+                    if (!matchesList(filterIds, id, idEnd == nullptr ? strlen(id) : idEnd - id, true))
+                        return false;
+                }
+                return true;
+            }
+
+            /**
+             * Queues a message for this client if it passes its filters, Output always delivers them as whole lines
+             * */
+            void deliver(const char *msg, size_t length) {
+                if (length > 0 && acceptsLine(msg))
+                    queue(msg, length);
+                atLineStart = true;
+            }
+
+            /**
+             * Same for raw output, a line split over several chunks follows the decision taken on its first one
+             * @param chunkLost a chunk was dropped before reaching us, where lines start is unknown
+             * */
+            void deliverRaw(const char *msg, size_t length, bool chunkLost) {
+                if (chunkLost)
+                    atLineStart = true;
+
+                while (length > 0) {
+                    const char *newline = (const char *) memchr(msg, '\n', length);
+                    size_t segment = newline == nullptr ? length : newline - msg + 1;
+                    if (atLineStart)
+                        lineAccepted = acceptsLine(msg);
+                    if (lineAccepted)
+                        queue(msg, segment);
+                    atLineStart = newline != nullptr;
+                    msg += segment;
+                    length -= segment;
                 }
-                return result;
             }
 
             void disconnectAndClear(){
@@ -125,6 +390,11 @@ namespace RFLink { namespace Serial2Net {
                 this->stop();
                 ignore = true;
                 buffer_end = 0;
+                buffer_scanned = 0;
+                atLineStart = true;
+                lineAccepted = true;
+                txTail = 0;
+                txCount = 0;
             }
         };
 
@@ -132,23 +402,85 @@ namespace RFLink { namespace Serial2Net {
         {
             bool enabled = false;
             unsigned int port;
+            SlowClientPolicy slow_client_policy = SlowClient_DropOldest;
+            unsigned int max_clients = SERIAL2NET_DEFAULT_MAX_CLIENTS;
+        }
+
+        namespace counters {
+            unsigned long int slowClientDisconnects = 0;
         }
 
+        const char * slowClientPolicyNames[] = {
+                "drop_oldest",
+                "disconnect",
+                "EOF" // matches SlowClientPolicy::SlowClient_EOF
+        };
+        static_assert(sizeof(slowClientPolicyNames)/sizeof(char *) == SlowClientPolicy::SlowClient_EOF+1, "slowClientPolicyNames has missing/extra names, please compare with SlowClientPolicy enum declarations");
+
         // All json variable names
         const char json_name_enabled[] = "enabled";
         const char json_name_port[] = "port";
+        const char json_name_slow_client_policy[] = "slow_client_policy";
+        const char json_name_max_clients[] = "max_clients";
+
+        enum ConfigItemIndex {
+            ConfigItem_Enabled,
+            ConfigItem_Port,
+            ConfigItem_SlowClientPolicy,
+            ConfigItem_MaxClients,
+            ConfigItem_EOF,
+        };
 
         Config::ConfigItem configItems[] = {
                 Config::ConfigItem(json_name_enabled, Config::SectionId::Serial2Net_id, false, paramsUpdatedCallback),
                 Config::ConfigItem(json_name_port, Config::SectionId::Serial2Net_id,SERIAL2NET_PORT, paramsUpdatedCallback),
+                Config::ConfigItem(json_name_slow_client_policy, Config::SectionId::Serial2Net_id, slowClientPolicyNames[SlowClient_DropOldest], paramsUpdatedCallback),
+                Config::ConfigItem(json_name_max_clients, Config::SectionId::Serial2Net_id, SERIAL2NET_DEFAULT_MAX_CLIENTS, paramsUpdatedCallback),
                 Config::ConfigItem()};
+        static_assert(sizeof(configItems) / sizeof(Config::ConfigItem) == ConfigItem_EOF + 1, "configItems has missing/extra items, please compare with ConfigItemIndex enum declarations");
+
+        SlowClientPolicy slowClientPolicyFromString(const char *name) {
+            for(int i=0; i<SlowClientPolicy::SlowClient_EOF; i++) {
+                if(strcmp(slowClientPolicyNames[i], name) == 0)
+                    return (SlowClientPolicy) i;
+            }
+            return SlowClientPolicy::SlowClient_EOF;
+        }
 
         WiFiServer server(1900);
 
         boolean alreadyConnected = false;
-        const unsigned short clientsMax=5;
+        const unsigned short clientsMax=SERIAL2NET_MAX_CLIENTS;
         Serial2NetClient clients[clientsMax];
 
+        bool sinkIsEnabled() {
+            return params::enabled;
+        }
+
+        bool sinkWrite(const char *msg, size_t length) {
+            for(int i=0; i<clientsMax; i++) {
+                if(!clients[i].ignore && clients[i].connected())
+                    clients[i].deliver(msg, length);
+            }
+            return true;
+        }
+
+        extern Output::Sink sink;
+        unsigned long rawDroppedSeen = 0;
+
+        bool sinkWriteRaw(const char *msg, size_t length) {
+            bool chunkLost = sink.rawDropped != rawDroppedSeen;
+            rawDroppedSeen = sink.rawDropped;
+            for(int i=0; i<clientsMax; i++) {
+                if(!clients[i].ignore && clients[i].connected())
+                    clients[i].deliverRaw(msg, length, chunkLost);
+            }
+            return true;
+        }
+
+        Output::Sink sink("serial2net", Output::Format_Line, Output::Drop_Oldest, OUTPUT_POOL_SIZE,
+                          sinkIsEnabled, nullptr, sinkWrite, true, sinkWriteRaw);
+
         void paramsUpdatedCallback()
         {
             refreshParametersFromConfig();
@@ -159,23 +491,48 @@ namespace RFLink { namespace Serial2Net {
             Config::ConfigItem *item;
             bool changesDetected = false;
 
-            item = Config::findConfigItem(json_name_enabled, Config::SectionId::Serial2Net_id);
+            item = &configItems[ConfigItem_Enabled];
             if (item->getBoolValue() != params::enabled)
             {
                 changesDetected = true;
                 params::enabled = item->getBoolValue();
             }
 
-            item = Config::findConfigItem(json_name_port, Config::SectionId::Serial2Net_id);
+            item = &configItems[ConfigItem_Port];
             if (item->getLongIntValue() != params::port)
             {
                 changesDetected = true;
                 params::port = item->getLongIntValue();
             }
 
+            // applies to next overflow, no need to restart the server
+            item = &configItems[ConfigItem_SlowClientPolicy];
+            SlowClientPolicy policy = slowClientPolicyFromString(item->getCharValue());
+            if (policy == SlowClientPolicy::SlowClient_EOF) {
+                Log::printf(Log::Module_Serial2Net, Log::Level_Warning, PSTR("Unsupported Serial2Net slow client policy '%s', falling back to '%s'"), item->getCharValue(), slowClientPolicyNames[SlowClient_DropOldest]);
+                policy = SlowClient_DropOldest;
+                item->setCharValue(slowClientPolicyNames[policy]);
+            }
+            params::slow_client_policy = policy;
+
+            item = &configItems[ConfigItem_MaxClients];
+            long int maxClients = item->getLongIntValue();
+            if (maxClients < 1 || maxClients > SERIAL2NET_MAX_CLIENTS) {
+                Log::printf(Log::Module_Serial2Net, Log::Level_Warning, PSTR("Serial2Net max_clients must be between 1 and %i"), SERIAL2NET_MAX_CLIENTS);
+                maxClients = maxClients < 1 ? 1 : SERIAL2NET_MAX_CLIENTS;
+                item->setLongIntValue(maxClients);
+            }
+            if ((unsigned int)maxClients != params::max_clients) {
+                params::max_clients = maxClients;
+                for(int i=params::max_clients; i<clientsMax; i++) { // slots above the new limit are closed
+                    if(!clients[i].ignore)
+                        clients[i].disconnectAndClear();
+                }
+            }
+
             if (triggerChanges && changesDetected)
             {
-                Serial.println(F("Serial2Net parameters have changed."));
+                Log::printf(Log::Module_Serial2Net, Log::Level_Info, PSTR("Serial2Net parameters have changed."));
                 if(params::enabled)
                     restartServer();
                 else
@@ -196,7 +553,8 @@ namespace RFLink { namespace Serial2Net {
          *
          * */
         bool registerClient(WiFiClient &newClient) {
-            for(auto & client : clients) {
+            for(unsigned int i=0; i<params::max_clients; i++) {
+                Serial2NetClient & client = clients[i];
                 if(client.ignore && !client.connected()) {
                     client = newClient;
                     client.enabledTcpKeepalive();
@@ -210,48 +568,76 @@ namespace RFLink { namespace Serial2Net {
         void setup(){
             server.setNoDelay(true);
             refreshParametersFromConfig(false);
+            Output::registerSink(&sink);
         }
 
-        void serverLoop(){
-#if defined(RFLINK_SERIAL2NET_DEBUG) || defined(DEBUG)
-            String debugmsg;
-#endif
+        /**
+         * 10;subscribe;[all;|protocol=a,b;|id=prefix1,prefix2;|undecoded;]
+         * Answer only goes to the requesting client
+         * */
+        void executeSubscribeCommand(Serial2NetClient &client, const char *fields) {
+            char reply[48 + 2 * SERIAL2NET_FILTER_SIZE];
+            bool success = client.setFilters(fields);
+
+            RFLink::sendMsgFromBuffer(); // we borrow pbuffer for the header
+            display_Header();
+            display_Name(PSTR("SUBSCRIBE"));
+            size_t length = strlen(pbuffer);
+            memcpy(reply, pbuffer, length + 1);
+            pbuffer[0] = 0;
+
+            if (success)
+                client.printFilters(reply + length, sizeof(reply) - length);
+            else
+                snprintf_P(reply + length, sizeof(reply) - length, PSTR(";CMD UNKNOWN"));
+
+            length = strlen(reply);
+            snprintf_P(reply + length, sizeof(reply) - length, PSTR(";\r\n"));
+            client.queue(reply, strlen(reply));
+        }
+
+        /**
+         * Answers to a command only go back to the client which sent it
+         * */
+        void replyToClient(const char *msg, void *target) {
+            static_cast<Serial2NetClient *>(target)->queue(msg, strlen(msg));
+        }
 
+        void serverLoop(){
             WiFiClient client = server.available();
 
             if(client.connected()) {
                 if( isNewClient(client) ) {
-#if defined(RFLINK_SERIAL2NET_DEBUG) || defined(DEBUG)
-                    debugmsg += "Serial2Net: new client detected IP=" + client.remoteIP().toString() + " port=" + client.remotePort();
-                    Serial.println(debugmsg);
-#endif
-                    Serial.println("registering new client");
+                    Log::printf(Log::Module_Serial2Net, Log::Level_Info, PSTR("Serial2Net: new client IP=%s port=%u"), client.remoteIP().toString().c_str(), client.remotePort());
                     registerClient(client);
                     return;
                 }
             }
 
+            for(auto & client : clients) {
+                if(!client.ignore)
+                    client.drain();
+            }
+
             // Let's see if any client has sent some data
             for(int i=0; i<clientsMax; i++) {
                 if(!clients[i].ignore) {
-                    int commandLastCharPos = clients[i].hasCommandAvailable();
-                    if (commandLastCharPos >=0) {
-                        String command = clients[i].consumeCommand(commandLastCharPos);
-#if defined(RFLINK_SERIAL2NET_DEBUG) || defined(DEBUG)
-                        debugmsg += "Serial2Net: client has sent a command >>>> " + command + " <<<<<<";
-                    Serial.println(debugmsg);
-#endif
-
-                        if(command.length() > 0) { // Let's request RFLink to parse this command
-                            RFLink::sendRawPrint(F("\33[2K\r"));
-                            Serial.flush();
-                            RFLink::sendRawPrint(PSTR("Message arrived [Ser2Net]:"));
-                            RFLink::sendRawPrint(command.c_str());
-                            RFLink::sendRawPrint(PSTR("\r\n"));
-                            Serial.flush();
-                            RFLink::executeCliCommand((char*)command.c_str());
-                        }
+                    char *command = clients[i].readCommand();
+                    if (command == nullptr)
+                        continue;
+                    Log::printf(Log::Module_Serial2Net, Log::Level_Debug, PSTR("Serial2Net: client has sent a command >>>> %s <<<<<<"), command);
+
+                    if(strncasecmp(command, "10;subscribe;", 13) == 0) {
+                        executeSubscribeCommand(clients[i], command + 13);
+                    } else if(command[0] != 0) { // Let's request RFLink to parse this command
+                        RFLink::sendRawPrint(F("\33[2K\r"));
+                        RFLink::sendRawPrint(PSTR("Message arrived [Ser2Net]:"));
+                        RFLink::sendRawPrint(command);
+                        RFLink::sendRawPrint(PSTR("\r\n"));
+                        const Command::Context context = {Command::Source_Serial2Net, nullptr, replyToClient, &clients[i]};
+                        Command::execute(command, context);
                     }
+                    clients[i].consumeCommand();
                 }
             }
         }
@@ -259,7 +645,7 @@ namespace RFLink { namespace Serial2Net {
         void broadcastMessage(const char *msg) {
             for(int i=0; i<clientsMax; i++) {
                 if(!clients[i].ignore && clients[i].connected()) {
-                    clients[i].print(msg);
+                    clients[i].queue(msg, strlen(msg));
                 }
             }
         }
@@ -267,7 +653,7 @@ namespace RFLink { namespace Serial2Net {
         void broadcastMessage(char c) {
           for(int i=0; i<clientsMax; i++) {
             if(!clients[i].ignore && clients[i].connected()) {
-              clients[i].write(c);
+              clients[i].queue(&c, 1);
             }
           }
         }
@@ -284,7 +670,7 @@ namespace RFLink { namespace Serial2Net {
         }
         void startServer(){
             server.begin(params::port);
-            Serial.println(F("Serial2Net Server started!"));
+            Log::printf(Log::Module_Serial2Net, Log::Level_Info, PSTR("Serial2Net Server started!"));
         }
 
         void stopServer(bool show_message){
@@ -299,25 +685,48 @@ namespace RFLink { namespace Serial2Net {
             }
             server.stop();
             if(show_message)
-                Serial.println(F("Serial2Net Server stopped!"));
+                Log::printf(Log::Module_Serial2Net, Log::Level_Info, PSTR("Serial2Net Server stopped!"));
         }
 
-        void getStatusJsonString(JsonObject &output)
+        unsigned int clientsCount()
         {
-            auto &&signal = output.createNestedObject("serial2net");
-
-            unsigned int countClient =0;
+            unsigned int count = 0;
 
             for(int i=0; i<clientsMax; i++) {
                 if(!clients[i].ignore && clients[i].connected())
-                    countClient++;
+                    count++;
             }
+            return count;
+        }
+
+        void getStatusJsonString(JsonObject &output)
+        {
+            auto &&signal = output.createNestedObject("serial2net");
+
             if(params::enabled)
                 signal[F("status")] = F("running");
             else
                 signal[F("status")] = F("disabled");
 
-            signal[F("clients_count")] = countClient;
+            signal[F("clients_count")] = clientsCount();
+            signal[F("max_clients")] = params::max_clients;
+            signal[F("slow_client_policy")] = slowClientPolicyNames[params::slow_client_policy];
+            signal[F("slow_client_disconnects")] = counters::slowClientDisconnects;
+
+            auto &&clientsInfo = signal.createNestedArray("clients");
+            for(auto & client : clients) {
+                if(client.ignore || !client.connected())
+                    continue;
+                auto &&info = clientsInfo.createNestedObject();
+                info[F("ip")] = client.remoteIP().toString();
+                info[F("port")] = client.remotePort();
+                info[F("tx_buffered")] = client.txPending();
+                info[F("tx_high_water")] = client.txHighWater;
+                info[F("tx_buffer_size")] = SERIAL2NET_TX_BUFFER_SIZE;
+                info[F("bytes_sent")] = client.bytesSent;
+                info[F("bytes_dropped")] = client.bytesDropped;
+                info[F("drops")] = client.dropEvents;
+            }
         }
 
     } // end Serial2Net namespace
@@ -7,6 +7,38 @@
 #define SERIAL2NET_PORT 1900
 #endif
 
+#ifndef SERIAL2NET_MAX_CLIENTS
+#if defined(ESP32)
+#define SERIAL2NET_MAX_CLIENTS 8 // upper bound of the max_clients setting, each client holds its own buffers
+#else
+#define SERIAL2NET_MAX_CLIENTS 5
+#endif
+#endif
+
+#ifndef SERIAL2NET_DEFAULT_MAX_CLIENTS
+#define SERIAL2NET_DEFAULT_MAX_CLIENTS 5
+#endif
+
+#ifndef SERIAL2NET_RX_BUFFER_SIZE
+#if defined(ESP32)
+#define SERIAL2NET_RX_BUFFER_SIZE 512 // per client, longest command accepted (ie 10;batch;...)
+#else
+#define SERIAL2NET_RX_BUFFER_SIZE 128
+#endif
+#endif
+
+#ifndef SERIAL2NET_FILTER_SIZE
+#define SERIAL2NET_FILTER_SIZE 32 // per client, room for comma separated protocol names or ID prefixes
+#endif
+
+#ifndef SERIAL2NET_TX_BUFFER_SIZE
+#if defined(ESP32)
+#define SERIAL2NET_TX_BUFFER_SIZE 1024 // per client, outgoing bytes waiting for the TCP stack
+#else
+#define SERIAL2NET_TX_BUFFER_SIZE 256
+#endif
+#endif
+
 #include "11_Config.h"
 
 //#define RFLINK_SERIAL2NET_DEBUG
@@ -14,10 +46,25 @@
 namespace RFLink {
     namespace Serial2Net {
 
+        /**
+         * What to do when a client does not read fast enough and its send buffer is full
+         * */
+        enum SlowClientPolicy {
+            SlowClient_DropOldest,  // discard oldest complete lines to make room
+            SlowClient_Disconnect,  // close the connection
+            SlowClient_EOF,
+        };
+
         namespace params
         {
             extern bool enabled;
             extern unsigned int port;
+            extern SlowClientPolicy slow_client_policy;
+            extern unsigned int max_clients;
+        }
+
+        namespace counters {
+            extern unsigned long int slowClientDisconnects;
         }
 
         extern Config::ConfigItem configItems[];
@@ -37,6 +84,8 @@ namespace RFLink {
         void broadcastMessage(const char *msg);
         void broadcastMessage(char c);
 
+        unsigned int clientsCount();
+
         void paramsUpdatedCallback();
         void refreshParametersFromConfig(bool triggerChanges=true);
 
@@ -632,26 +632,24 @@ boolean  PluginTX_003(byte function, const char *string)
    uint32_t unitcode = 0;
    byte Home = 0;    // KAKU home A..P
    byte Address = 0; // KAKU Address 1..16
-   byte c = 0;
-   byte x = 0;
+   unsigned long value = 0;
+   int cmd = 0;
+   Tokenizer::Fields fields(string);
+
+   if (!fields.name("10"))
+      return false;
    // ==========================================================================
    //10;Kaku;00004d;1;OFF;
    //10;Kaku;00004f;e;ON;
    //10;Kaku;000050;10;ON;
    //10;Kaku;000049;b;ON;
-   //012345678901234567890
    // ==========================================================================
-   if (strncasecmp(InputBuffer_Serial + 3, "KAKU;", 5) == 0)
+   if (fields.name("KAKU"))
    { // KAKU Command eg. Kaku;A1;On
-      if (InputBuffer_Serial[14] != ';')
+      if (!fields.hex(value, 6))
          return false;
-
-      x = 15; // character pointer
-      InputBuffer_Serial[10] = 0x30;
-      InputBuffer_Serial[11] = 0x78;           // Get home from hexadecimal value
-      InputBuffer_Serial[14] = 0x00;           // Get home from hexadecimal value
-      Home = str2int(InputBuffer_Serial + 10); // KAKU home A is intern 0
-      if (Home < 0x51)                         // take care of upper/lower case
+      Home = value;    // KAKU home A is intern 0
+      if (Home < 0x51) // take care of upper/lower case
          Home = Home - 'A';
       else if (Home < 0x71) // take care of upper/lower case
          Home = Home - 'a';
@@ -660,22 +658,12 @@ boolean  PluginTX_003(byte function, const char *string)
          return false; // invalid value
       }
 
-      while ((c = InputBuffer_Serial[x++]) != ';')
-      { // Address: 1 to 16/32
-         if (c >= '0' && c <= '9')
-         {
-            Address = Address * 10;
-            Address = Address + c - '0';
-         }
-         if (c >= 'a' && c <= 'f')
-         {
-            Address = Address + (c - 'a' + 10);
-         } // 31?
-         if (c >= 'A' && c <= 'F')
-         {
-            Address = Address + (c - 'A' + 10);
-         } // 51?
-      }
+      // Address: 1 to 16/32, either decimal or a single hex digit
+      if (!fields.decimal(value, 2) && !fields.hex(value, 1))
+         return false;
+      Address = value;
+      if (!fields.keyword(cmd))
+         return false;
       //if (Address==0) {                        // group command is given: 0=all
       //   command=2;                            // Set 2nd bit for group.
       //   bitstream=Home;
@@ -684,7 +672,7 @@ boolean  PluginTX_003(byte function, const char *string)
       //}
 
       bitstream = Home | ((Address - 1) << 4);
-      command |= str2cmd(InputBuffer_Serial + x) == VALUE_ON;  // ON/OFF command
+      command |= cmd == VALUE_ON;                              // ON/OFF command
       bitstream = bitstream | (0x600 | ((command & 1) << 11)); // create the bitstream
       //Serial.println(bitstream);
       Arc_Send(bitstream);
@@ -694,18 +682,13 @@ boolean  PluginTX_003(byte function, const char *string)
    else
        // ==========================================================================
        //10;AB400D;00004d;1;OFF;
-       //012345678901234567890
        // ==========================================================================
-       if (strncasecmp(InputBuffer_Serial + 3, "AB400D;", 7) == 0)
+       if (fields.name("AB400D"))
    { // KAKU Command eg. Kaku;A1;On
-      if (InputBuffer_Serial[16] != ';')
+      if (!fields.hex(value, 6))
          return false;
-      x = 17; // character pointer
-      InputBuffer_Serial[12] = 0x30;
-      InputBuffer_Serial[13] = 0x78;           // Get home from hexadecimal value
-      InputBuffer_Serial[16] = 0x00;           // Get home from hexadecimal value
-      Home = str2int(InputBuffer_Serial + 12); // KAKU home A is intern 0
-      if (Home < 0x61)                         // take care of upper/lower case
+      Home = value;    // KAKU home A is intern 0
+      if (Home < 0x61) // take care of upper/lower case
          Home = Home - 'A';
       else if (Home < 0x81) // take care of upper/lower case
          Home = Home - 'a';
@@ -713,15 +696,12 @@ boolean  PluginTX_003(byte function, const char *string)
       {
          return false; // invalid value
       }
-      while ((c = InputBuffer_Serial[x++]) != ';')
-      { // Address: 1 to 16/32
-         if (c >= '0' && c <= '9')
-         {
-            Address = Address * 10;
-            Address = Address + c - '0';
-         }
-      }
-      command = str2cmd(InputBuffer_Serial + x) == VALUE_ON; // ON/OFF command
+      if (!fields.decimal(value, 2)) // Address: 1 to 16/32
+         return false;
+      Address = value;
+      if (!fields.keyword(cmd))
+         return false;
+      command = cmd == VALUE_ON; // ON/OFF command
       housecode = ~Home;
       housecode &= 0x0000001FL;
       unitcode = Address;
@@ -752,18 +732,13 @@ boolean  PluginTX_003(byte function, const char *string)
        // --------------- END SARTANO SEND ------------
        // ==========================================================================
        //10;PT2262;000041;1;OFF;
-       //012345678901234567890
        // ==========================================================================
-       if (strncasecmp(InputBuffer_Serial + 3, "PT2262;", 7) == 0)
+       if (fields.name("PT2262"))
    { // KAKU Command eg. Kaku;A1;On
-      if (InputBuffer_Serial[16] != ';')
+      if (!fields.hex(value, 6))
          return false;
-      x = 17; // character pointer
-      InputBuffer_Serial[12] = 0x30;
-      InputBuffer_Serial[13] = 0x78;           // Get home from hexadecimal value
-      InputBuffer_Serial[16] = 0x00;           // Get home from hexadecimal value
-      Home = str2int(InputBuffer_Serial + 12); // KAKU home A is intern 0
-      if (Home < 0x61)                         // take care of upper/lower case
+      Home = value;    // KAKU home A is intern 0
+      if (Home < 0x61) // take care of upper/lower case
          Home = Home - 'A';
       else if (Home < 0x81) // take care of upper/lower case
          Home = Home - 'a';
@@ -771,16 +746,13 @@ boolean  PluginTX_003(byte function, const char *string)
       {
          return false; // invalid value
       }
-      while ((c = InputBuffer_Serial[x++]) != ';')
-      { // Address: 1 to 16/32
-         if (c >= '0' && c <= '9')
-         {
-            Address = Address * 10;
-            Address = Address + c - '0';
-         }
-      }
+      if (!fields.decimal(value, 2)) // Address: 1 to 16/32
+         return false;
+      Address = value;
+      if (!fields.keyword(cmd))
+         return false;
       // reconstruct bitstream reversed order so that most right bit can be send first
-      command = str2cmd(InputBuffer_Serial + x) == VALUE_ON; // ON/OFF command
+      command = cmd == VALUE_ON; // ON/OFF command
       housecode = ~Home;
       housecode &= 0x00000007L;
       housecode = (housecode) << 1;
@@ -795,31 +767,20 @@ boolean  PluginTX_003(byte function, const char *string)
        //10;TriState;00004d;1;OFF;
        //10;TriState;08000a;2;OFF;       20;1B;TriState;ID=08000a;SWITCH=2;CMD=OFF;
        //10;TriState;0a6980;2;OFF;
-       //01234567890123456789012
        // ==========================================================================
-       if (strncasecmp(InputBuffer_Serial + 3, "TriState;", 9) == 0)
+       if (fields.name("TriState"))
    { // KAKU Command eg. Kaku;A1;On
-      if (InputBuffer_Serial[18] != ';')
+      if (!fields.hex(value, 6))
          return false;
-      x = 19; // character pointer
-      InputBuffer_Serial[10] = 0x30;
-      InputBuffer_Serial[11] = 0x78;                // Get home from hexadecimal value
-      InputBuffer_Serial[18] = 0x00;                // Get home from hexadecimal value
-      bitstream = str2int(InputBuffer_Serial + 10); // KAKU home A is intern 0
-      bitstream = (bitstream << 4);
+      bitstream = (value << 4);
 
       // 11^00^01=10   11^10^11=01   11^11^00=00
-      while ((c = InputBuffer_Serial[x++]) != ';')
-      { // Address: 0/1/2
-         if (c >= '0' && c <= '9')
-         {
-            Address = Address * 10;
-            Address = Address + c - '0';
-         }
-      }
-      Address = (Address)&0x03;                  // only use 3 bits
-      command = str2cmd(InputBuffer_Serial + x); // ON/OFF command
-      if (command == VALUE_ON)
+      if (!fields.decimal(value, 2)) // Address: 0/1/2
+         return false;
+      Address = (value)&0x03; // only use 3 bits
+      if (!fields.keyword(cmd))
+         return false;
+      if (cmd == VALUE_ON)
       { // on
          if (Address == 0x0)
             bitstream |= 0x0000000bL; // 0011
@@ -844,18 +805,13 @@ boolean  PluginTX_003(byte function, const char *string)
        // --------------- END TRISTATE SEND ------------
        // ==========================================================================
        //10;Impuls;00004d;1;OFF;
-       //012345678901234567890
        // ==========================================================================
-       if (strncasecmp(InputBuffer_Serial + 3, "Impuls;", 7) == 0)
+       if (fields.name("Impuls"))
    { // KAKU Command eg. Kaku;A1;On
-      if (InputBuffer_Serial[16] != ';')
+      if (!fields.hex(value, 6))
          return false;
-      x = 17; // character pointer
-      InputBuffer_Serial[12] = 0x30;
-      InputBuffer_Serial[13] = 0x78;           // Get home from hexadecimal value
-      InputBuffer_Serial[16] = 0x00;           // Get home from hexadecimal value
-      Home = str2int(InputBuffer_Serial + 12); // KAKU home A is intern 0
-      if (Home < 0x61)                         // take care of upper/lower case
+      Home = value;    // KAKU home A is intern 0
+      if (Home < 0x61) // take care of upper/lower case
          Home = Home - 'A';
       else if (Home < 0x81) // take care of upper/lower case
          Home = Home - 'a';
@@ -863,15 +819,12 @@ boolean  PluginTX_003(byte function, const char *string)
       {
          return false; // invalid value
       }
-      while ((c = InputBuffer_Serial[x++]) != ';')
-      { // Address: 1 to 16/32
-         if (c >= '0' && c <= '9')
-         {
-            Address = Address * 10;
-            Address = Address + c - '0';
-         }
-      }
-      command = str2cmd(InputBuffer_Serial + x) == VALUE_ON; // ON/OFF command
+      if (!fields.decimal(value, 2)) // Address: 1 to 16/32
+         return false;
+      Address = value;
+      if (!fields.keyword(cmd))
+         return false;
+      command = cmd == VALUE_ON; // ON/OFF command
       housecode = ~Home;
       housecode &= 0x0000001FL;
       unitcode = Address;
@@ -156,7 +156,6 @@ boolean Plugin_004(byte function, const char *string)
 #endif // Plugin_004
 
 #ifdef PLUGIN_TX_004
-#include "../3_Serial.h"
 #include "../4_Display.h"
 
 boolean  PluginTX_004(byte function, const char *string)
@@ -177,18 +176,18 @@ boolean  PluginTX_004(byte function, const char *string)
    byte Cmd_bitstream = 0;          // 2 bits Command
    byte Cmd_dimmer = 0;             // 4 bits Alt Command
 
-   retrieve_Init();
-   if (!retrieve_Name("10"))
+   Tokenizer::Fields fields(string);
+   if (!fields.name("10"))
       return false;
-   if (!retrieve_Name("Newkaku"))
+   if (!fields.name("Newkaku"))
       return false;
-   if (!retrieve_ID(ID_bitstream))
+   if (!fields.id(ID_bitstream))
       return false;
-   if (!retrieve_Switch(Switch_bitstream))
+   if (!fields.switchCode(Switch_bitstream))
       return false;
-   if (!retrieve_Command(Cmd_bitstream, Cmd_dimmer))
+   if (!fields.command(Cmd_bitstream, Cmd_dimmer))
       return false;
-   if (!retrieve_End())
+   if (!fields.end())
       return false;
 
    // --------------- Prepare bitstream ------------
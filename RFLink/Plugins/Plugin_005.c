@@ -151,22 +151,17 @@ void Eurodomest_Send(unsigned long address);
 boolean PluginTX_005(byte function, const char *string)
 {
    //10;EURODOMEST;03696b;0;ON;
-   //012345678901234567890123456
    boolean success = false;
-   if (strncasecmp(InputBuffer_Serial + 3, "EURODOMEST;", 11) == 0)
+   Tokenizer::Fields fields(string);
+   if (fields.name("10") && fields.name("EURODOMEST"))
    { // KAKU Command eg.
       unsigned long bitstream = 0L;
-      if (InputBuffer_Serial[20] != ';')
+      unsigned long temp = 0;
+      int command = 0;
+      if (!fields.hex(bitstream, 6)) // Address
          return success;
-      if (InputBuffer_Serial[22] != ';')
+      if (!fields.hex(temp, 1)) // Button number
          return success;
-
-      InputBuffer_Serial[12] = 0x30;
-      InputBuffer_Serial[13] = 0x78;
-      InputBuffer_Serial[20] = 0x00;
-      bitstream = str2int(InputBuffer_Serial + 12); // Address
-      InputBuffer_Serial[22] = 0x00;
-      byte temp = str2int(InputBuffer_Serial + 21); // Button number
       bitstream = (bitstream) << 4;
       if (temp == 1)
          bitstream = bitstream + 0x02; // 0010
@@ -182,8 +177,8 @@ boolean PluginTX_005(byte function, const char *string)
       {
          return success;
       }
-      byte command = 0;
-      command = str2cmd(InputBuffer_Serial + 23);
+      if (!fields.keyword(command))
+         return success;
       if (command == VALUE_OFF)
       {
          bitstream = bitstream | 1;
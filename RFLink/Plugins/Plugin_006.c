@@ -159,42 +159,40 @@ boolean  PluginTX_006(byte function, const char *string)
 {
    boolean success = false;
    //10;Avidsen;00ff98;A1;OFF;
-   //012345678901234567890123456
    //10;Blyss;00ff98;A1;OFF;
-   //012345678901234567890123456
    int offset = 0;
-   if (strncasecmp(InputBuffer_Serial + 3, "AVIDSEN;", 8) == 0)
+   Tokenizer::Fields fields(string);
+   if (!fields.name("10"))
+      return success;
+   if (fields.name("AVIDSEN"))
    { // Blyss Command eg.
       offset = 2;
    }
-   if ((strncasecmp(InputBuffer_Serial + 3, "BLYSS;", 6) == 0) || (offset == 2))
+   if ((offset == 2) || fields.name("BLYSS"))
    { // Blyss Command eg.
       unsigned long Bitstream = 0L;
-      if (InputBuffer_Serial[15 + offset] != ';')
-         return success; // check
-      if (InputBuffer_Serial[18 + offset] != ';')
-         return success; // check
-
       unsigned long Home = 0; // Blyss channel A..P
       byte Address = 0;       // Blyss subchannel 1..5
       byte c;
       byte subchan = 0; // subchannel
+      int cmd = 0;
 
-      InputBuffer_Serial[7 + offset] = 0x30;
-      InputBuffer_Serial[8 + offset] = 0x78;
-      InputBuffer_Serial[15 + offset] = 0;
-      Bitstream = str2int(InputBuffer_Serial + 7 + offset); // get address
+      if (!fields.hex(Bitstream, 6)) // get address
+         return success;
+      if (fields.length() != 2)
+         return success; // check
 
-      c = tolower(InputBuffer_Serial[16 + offset]); // A..P
+      c = tolower(fields.field()[0]); // A..P
       if (c >= 'a' && c <= 'p')
       {
          Home = c - 'a';
       }
-      c = tolower(InputBuffer_Serial[17 + offset]); // 1..5
+      c = tolower(fields.field()[1]); // 1..5
       if (c >= '1' && c <= '5')
       {
          Address = Address + c - '0';
       }
+      fields.next();
 
       if (Address == 1)
          subchan = 0x80;
@@ -212,18 +210,19 @@ boolean  PluginTX_006(byte function, const char *string)
       Bitstream = Bitstream + subchan;
       Bitstream = Bitstream + Home;
 
-      c = str2cmd(InputBuffer_Serial + 19 + offset); // ALL ON/OFF command
-      if (c == VALUE_OFF)
+      if (!fields.keyword(cmd)) // ALL ON/OFF command
+         return success;
+      if (cmd == VALUE_OFF)
       {
          Bitstream = Bitstream | 1;
       }
       else
       {
-         if (c == VALUE_ALLOFF)
+         if (cmd == VALUE_ALLOFF)
          {
             Bitstream = Bitstream | 3;
          }
-         else if (c == VALUE_ALLON)
+         else if (cmd == VALUE_ALLON)
          {
             Bitstream = Bitstream | 2;
          }
@@ -249,22 +249,21 @@ boolean  PluginTX_007(byte function, const char *string)
    //10;CONRAD;000fa0;0;OFF;
    //10;CONRAD;009200;1;ON;
    //10;CONRAD;ff0607;1;OFF;
-   //012345678901234567890123
-   if (strncasecmp(InputBuffer_Serial + 3, "CONRAD;", 7) == 0)
+   Tokenizer::Fields fields(string);
+   if (fields.name("10") && fields.name("CONRAD"))
    { // KAKU Command eg.
       unsigned long bitstream = 0L;
       unsigned long command = 0L;
-      if (InputBuffer_Serial[16] != ';')
+      unsigned long temp = 0;
+      int cmd = 0;
+      if (!fields.hex(bitstream, 6)) // Address
+         return success;
+      if (!fields.hex(temp, 1)) // het button/unit number (0x00..0x0f)
+         return success;
+      if (!fields.keyword(cmd)) // ON/OFF
          return success;
-      InputBuffer_Serial[8] = 0x30;
-      InputBuffer_Serial[9] = 0x78;
-      InputBuffer_Serial[16] = 0;
-      bitstream = str2int(InputBuffer_Serial + 8); // Address
-
-      byte temp = str2int(InputBuffer_Serial + 17); // het button/unit number (0x00..0x0f)
       if (temp < 16)
-      {                                               // No button with a number higher than 15
-         byte cmd = str2cmd(InputBuffer_Serial + 19); // ON/OFF
+      { // No button with a number higher than 15
          if (cmd == VALUE_OFF)
          {
             if (temp == 0)
@@ -160,26 +160,21 @@ boolean  PluginTX_008(byte function, const char *string)
 {
     boolean success = false;
     //10;kambrook;050325;a1;ON;
-    //012345678901234567890123
-    if (strncasecmp(InputBuffer_Serial + 3, "KAMBROOK;", 9) == 0)
+    Tokenizer::Fields fields(string);
+    if (fields.name("10") && fields.name("KAMBROOK"))
     { // KAKU Command eg.
-        if (InputBuffer_Serial[18] != ';')
-            return false;
-
-        InputBuffer_Serial[10] = 0x30;
-        InputBuffer_Serial[11] = 0x78; // Get address from hexadecimal value
-        InputBuffer_Serial[18] = 0x00; // Get address from hexadecimal value
-
         unsigned long bitstream = 0L; // Main placeholder
         byte Home = 0;                // channel A..D
         byte Address = 0;             // subchannel 1..5
         byte c;
-        byte x = 19; // teller die wijst naar het te behandelen teken
+        int cmd = 0;
 
-        bitstream = str2int(InputBuffer_Serial + 10); // Address
+        if (!fields.hex(bitstream, 6)) // Address
+            return false;
 
-        while ((c = tolower(InputBuffer_Serial[x++])) != ';')
+        for (size_t x = 0; x < fields.length(); x++)
         {
+            c = tolower(fields.field()[x]);
             if (c >= '0' && c <= '9')
             {
                 Address = Address + c - '0';
@@ -189,11 +184,12 @@ boolean  PluginTX_008(byte function, const char *string)
                 Home = c - 'a';
             } // Address a..d
         }
+        fields.next();
 
         Address = Address << 1; // shift left 1 bit
-        c = 0;
-        c = str2cmd(InputBuffer_Serial + x); // ON/OFF command
-        if (c == VALUE_ON)
+        if (!fields.keyword(cmd)) // ON/OFF command
+            return false;
+        if (cmd == VALUE_ON)
         {
             Address--;
         }
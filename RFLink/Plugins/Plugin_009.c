@@ -294,23 +294,23 @@ boolean  PluginTX_009(byte function, const char *string)
 {
    boolean success = false;
    //10;X10;000041;1;OFF;
-   //0123456789012345678
    // Hier aangekomen bevat string het volledige commando. Test als eerste of het opgegeven commando overeen komt
-   if (strncasecmp(InputBuffer_Serial + 3, "X10;", 4) == 0)
+   Tokenizer::Fields fields(string);
+   if (fields.name("10") && fields.name("X10"))
    { // X10 Command eg.
       unsigned long bitstream = 0L;
-      byte x = 14; // teller die wijst naar het te behandelen teken
+      unsigned long value = 0;
+      int cmd = 0;
       byte command = 0;
       byte Home = 0;    // Home A..P
       byte Address = 0; // Blyss subchannel 1..5
       byte c;
       uint32_t newadd = 0;
 
-      InputBuffer_Serial[9] = 0x30;
-      InputBuffer_Serial[10] = 0x78;
-      InputBuffer_Serial[13] = 0;
-      Home = str2int(InputBuffer_Serial + 9); // Home: A..P
-      if (Home < 0x51)                        // take care of upper/lower case
+      if (!fields.hex(value, 6))
+         return success;
+      Home = value;    // Home: A..P
+      if (Home < 0x51) // take care of upper/lower case
          Home = Home - 'A';
       else if (Home < 0x71) // take care of upper/lower case
          Home = Home - 'a';
@@ -319,14 +319,9 @@ boolean  PluginTX_009(byte function, const char *string)
          return success; // invalid value
       }
 
-      while ((c = tolower(InputBuffer_Serial[x++])) != ';')
-      { // Address: 1 to 16
-         if (c >= '0' && c <= '9')
-         {
-            Address = Address * 10;
-            Address = Address + c - '0';
-         }
-      }
+      if (!fields.decimal(value, 2)) // Address: 1 to 16
+         return success;
+      Address = value;
 
       if (Home == 0)
          c = 0x60;
@@ -366,14 +361,15 @@ boolean  PluginTX_009(byte function, const char *string)
          Address = Address - 8;
       }
       // ---------------
-      Home = str2cmd(InputBuffer_Serial + x);
-      if (Home == 0)
+      if (!fields.keyword(cmd))
+         return success;
+      if (cmd == VALUE_DIM || cmd == VALUE_BRIGHT)
       { // DIM/BRIGHT command
-         if (strcasecmp(InputBuffer_Serial + x, "DIM") == 0)
+         if (cmd == VALUE_DIM)
          {
             command = 3;
          }
-         else if (strcasecmp(InputBuffer_Serial + x, "BRIGHT") == 0)
+         else
          {
             command = 2;
          }
@@ -381,20 +377,20 @@ boolean  PluginTX_009(byte function, const char *string)
       }
       else
       {
-         if (Home == VALUE_ON)
+         if (cmd == VALUE_ON)
          {
             command = 1;
          }
-         else if (Home == VALUE_OFF)
+         else if (cmd == VALUE_OFF)
          {
             command = 0;
          }
-         else if (Home == VALUE_ALLOFF)
+         else if (cmd == VALUE_ALLOFF)
          {
             command = 4;
             c = c + 4;
          }
-         else if (Home == VALUE_ALLON)
+         else if (cmd == VALUE_ALLON)
          {
             command = 5;
             c = c + 4;
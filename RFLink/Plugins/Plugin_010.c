@@ -235,11 +235,13 @@ void TRC02_Send(unsigned long address, int command);
 boolean  PluginTX_010(byte function, const char *string)
 {
    //10;TRC02RGB;03023c;00;
-   //012345678901234567890123456
    boolean success = false;
-   if (strncasecmp(InputBuffer_Serial + 3, "TRC02RGB;", 9) == 0)
+   unsigned long address = 0;
+   unsigned long command = 0;
+   Tokenizer::Fields fields(string);
+   if (fields.name("10") && fields.name("TRC02RGB") && fields.hex(address, 6) && fields.hex(command, 2))
    { // KAKU Command eg.
-      TRC02_Send(strtoul(InputBuffer_Serial + 12, NULL, 16), strtoul(InputBuffer_Serial + 19, NULL, 16));
+      TRC02_Send(address, command);
       success = true;
    }
    return success;
@@ -228,27 +228,22 @@ boolean  PluginTX_011(byte function, const char *string)
 {
    boolean success = false;
    //10;HomeConfort;01b523;D3;ON;
-   //0123456789012345678901234567
-   if (strncasecmp(InputBuffer_Serial + 3, "HomeConfort;", 12) == 0)
+   Tokenizer::Fields fields(string);
+   if (fields.name("10") && fields.name("HomeConfort"))
    { // KAKU Command eg.
-      if (InputBuffer_Serial[21] != ';')
-         return success;
-
-      InputBuffer_Serial[13] = 0x30;
-      InputBuffer_Serial[14] = 0x78; // Get address from hexadecimal value
-      InputBuffer_Serial[21] = 0x00; // Get address from hexadecimal value
-
       unsigned long bitstream1 = 0L; // First Main placeholder
       unsigned long bitstream2 = 0L; // Second Main placeholder
       byte Home = 0;                 // channel A..D
       byte Address = 0;              // subchannel 1..5
       byte c;
-      byte x = 22; // pointer
+      int cmd = 0;
       // -------------------------------
-      bitstream1 = str2int(InputBuffer_Serial + 13); // Address (first 19 bits)
+      if (!fields.hex(bitstream1, 6)) // Address (first 19 bits)
+         return success;
       // -------------------------------
-      while ((c = tolower(InputBuffer_Serial[x++])) != ';')
+      for (size_t x = 0; x < fields.length(); x++)
       {
+         c = tolower(fields.field()[x]);
          if (c >= '0' && c <= '9')
          {
             Address = Address + c - '0';
@@ -258,6 +253,7 @@ boolean  PluginTX_011(byte function, const char *string)
             Home = c - 'a';
          } // Address a..d
       }
+      fields.next();
       // -------------------------------
       // prepare bitstream1
       // -------------------------------
@@ -278,21 +274,21 @@ boolean  PluginTX_011(byte function, const char *string)
       bitstream1 = bitstream1 + Home;
       // -------------------------------
       // prepare bitsrteam2
-      c = 0;
-      c = str2cmd(InputBuffer_Serial + x); // ON/OFF command
-      bitstream2 = 1;                      // value off
-      if (c == VALUE_ON)
+      if (!fields.keyword(cmd)) // ON/OFF command
+         return success;
+      bitstream2 = 1; // value off
+      if (cmd == VALUE_ON)
       {
          bitstream2 = 0x81; // value on
       }
       else
       {
-         if (c == VALUE_ALLOFF)
+         if (cmd == VALUE_ALLOFF)
          {
             bitstream2 = 0x41;
             bitstream1 = bitstream1 + 4; // set group
          }
-         else if (c == VALUE_ALLON)
+         else if (cmd == VALUE_ALLON)
          {
             bitstream2 = 0xc1;
             bitstream1 = bitstream1 + 4; // set group
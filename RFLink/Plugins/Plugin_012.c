@@ -245,27 +245,27 @@ boolean  PluginTX_012(byte function, const char *string)
 {
    boolean success = false;
    //10;FA500;001b523;D3;ON;
-   //012345678901234567890123
-   if (strncasecmp(InputBuffer_Serial + 3, "FA500;", 6) == 0)
+   Tokenizer::Fields fields(string);
+   if (fields.name("10") && fields.name("FA500"))
    { // FA500 Command
-      if (InputBuffer_Serial[16] != ';')
-         return false;
       unsigned long bitstream = 0L;
       byte Home = 0;
       byte c;
+      int cmd = 0;
 
-      InputBuffer_Serial[7] = 0x30;
-      InputBuffer_Serial[8] = 0x78;
-      bitstream = str2int(InputBuffer_Serial + 7); // get address
+      if (!fields.hex(bitstream, 7)) // get address
+         return false;
 
-      c = tolower(InputBuffer_Serial[17]); // 1..5
+      c = tolower(fields.field()[0]); // 1..5
       if (c >= '1' && c <= '5')
       {
          Home = Home + c - '0';
       }
+      fields.next();
 
-      c = 0;
-      c |= str2cmd(InputBuffer_Serial + 20) == VALUE_OFF; // ON/OFF command
+      if (!fields.keyword(cmd)) // ON/OFF command
+         return false;
+      c = cmd == VALUE_OFF;
       Flamingo_Send(bitstream, c);
       success = true;
    }
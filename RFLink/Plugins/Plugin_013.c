@@ -223,24 +223,20 @@ boolean  PluginTX_013(byte function, const char *string)
 {
    boolean success = false;
    //10;POWERFIX;000080;0;ON;
-   //012345678901234567890123
-   if (strncasecmp(InputBuffer_Serial + 3, "POWERFIX;", 9) == 0)
+   Tokenizer::Fields fields(string);
+   if (fields.name("10") && fields.name("POWERFIX"))
    {
-      if (InputBuffer_Serial[18] != ';')
-         return success;
-
-      InputBuffer_Serial[10] = 0x30;
-      InputBuffer_Serial[11] = 0x78;
-      InputBuffer_Serial[18] = 0x00; // Get address from hexadecimal value
-
       unsigned long bitstream = 0L; // Main placeholder
+      unsigned long temp = 0;
       byte command = 0;
-      byte c;
+      int cmd = 0;
       // -------------------------------
-      bitstream = str2int(InputBuffer_Serial + 10); // Address, first 12 bits of the 20 bits in total
-      bitstream = (bitstream) << 8;                 // shift left so that we can add the 8 command bits
+      if (!fields.hex(bitstream, 6)) // Address, first 12 bits of the 20 bits in total
+         return success;
+      bitstream = (bitstream) << 8; // shift left so that we can add the 8 command bits
       // -------------------------------
-      byte temp = str2int(InputBuffer_Serial + 19); // button/unit number (0..3)
+      if (!fields.hex(temp, 1)) // button/unit number (0..3)
+         return success;
       if (temp == 1)
          command = 0x82;
       if (temp == 2)
@@ -248,19 +244,19 @@ boolean  PluginTX_013(byte function, const char *string)
       if (temp == 3)
          command = 0xc2;
       // -------------------------------
-      c = 0;
-      c = str2cmd(InputBuffer_Serial + 21); // ON/OFF command
-      if (c == VALUE_ON)
+      if (!fields.keyword(cmd)) // ON/OFF command
+         return success;
+      if (cmd == VALUE_ON)
       {
          command = command | 0x10; // turn "on" bit for on command
       }
       else
       {
-         if (c == VALUE_ALLOFF)
+         if (cmd == VALUE_ALLOFF)
          { // set "all off" bits
             command = 0xe0;
          }
-         else if (c == VALUE_ALLON)
+         else if (cmd == VALUE_ALLON)
          {
             command = 0xf0; // set "all on" bits
          }
@@ -150,33 +150,22 @@ boolean  PluginTX_015(byte function, const char *string)
    //10;HomeEasy;d900ba00;23;OFF;
    //10;HomeEasy;79b2a5c3;b;ON;
    //10;HomeEasy;7a7322c7;b;ON;
-   //01234567890123456789012345
-   if (strncasecmp(InputBuffer_Serial + 3, "HOMEEASY;", 9) == 0)
+   Tokenizer::Fields fields(string);
+   if (fields.name("10") && fields.name("HOMEEASY"))
    { // KAKU Command eg.
-      if (InputBuffer_Serial[20] != ';')
-         return false;
       unsigned long bitstream = 0L;
       unsigned long commandcode = 0L;
-      byte cmd = 0;
+      int cmd = 0;
       byte group = 0;
       // ------------------------------
-      InputBuffer_Serial[10] = 0x30;
-      InputBuffer_Serial[11] = 0x78;
-      InputBuffer_Serial[20] = 0x00;
-      bitstream = str2int(InputBuffer_Serial + 10); // Get Address from hexadecimal value
+      if (!fields.hex(bitstream, 8)) // Get Address from hexadecimal value
+         return false;
       // ------------------------------
-      InputBuffer_Serial[19] = 0x30;
-      InputBuffer_Serial[20] = 0x78;                  // Get home from hexadecimal value
-      commandcode = str2int(InputBuffer_Serial + 19); // Get Button number
+      if (!fields.hex(commandcode, 2)) // Get Button number
+         return false;
       // ------------------------------
-      if (InputBuffer_Serial[23] == ';')
-      { // Get command
-         cmd = str2cmd(InputBuffer_Serial + 24);
-      }
-      else
-      {
-         cmd = str2cmd(InputBuffer_Serial + 23);
-      }
+      if (!fields.keyword(cmd)) // Get command
+         return false;
       if (cmd == VALUE_OFF)
          cmd = 0; // off
       if (cmd == VALUE_ON)
@@ -126,13 +126,9 @@ boolean  PluginTX_070(byte function, const char *string)
     boolean success = false;
     unsigned long bitstream = 0L;
     //10;SELECTPLUS;001c33;1;OFF;
-    //012345678901234567890123456
-    if (strncasecmp(InputBuffer_Serial + 3, "SELECTPLUS;", 11) == 0)
+    Tokenizer::Fields fields(string);
+    if (fields.name("10") && fields.name("SELECTPLUS") && fields.hex(bitstream, 6))
     {
-        InputBuffer_Serial[12] = 0x30;
-        InputBuffer_Serial[13] = 0x78;
-        InputBuffer_Serial[20] = 0;
-        bitstream = str2int(InputBuffer_Serial + 12);
         bitstream = bitstream << 4;
         SelectPlus_Send(bitstream); // Send RF packet
         success = true;
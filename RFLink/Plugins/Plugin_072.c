@@ -111,23 +111,16 @@ boolean  PluginTX_072(byte function, const char *string)
 {
    boolean success = false;
    //10;BYRON;112233;01;OFF;
-   //01234567890123456789012
-   if (strncasecmp(InputBuffer_Serial + 3, "BYRON;", 5) == 0)
+   unsigned long address = 0;
+   unsigned long ringtone = 0;
+   Tokenizer::Fields fields(string);
+   if (fields.name("10") && fields.name("BYRON"))
    { // KAKU Command eg.
-      if (InputBuffer_Serial[15] != ';')
+      if (!fields.hex(address, 6) || !fields.hex(ringtone, 2))
          return false;
 
-      InputBuffer_Serial[9] = '0';
-      InputBuffer_Serial[10] = 'x';
-      InputBuffer_Serial[15] = 0;
-      unsigned int tempbyte1 = 0;
-      tempbyte1 = str2int(InputBuffer_Serial + 9); // get parameter 1
-
-      int tempbyte2 = 0;
-      InputBuffer_Serial[14] = '0';
-      InputBuffer_Serial[15] = 'x';
-      InputBuffer_Serial[18] = 0;
-      tempbyte2 = str2int(InputBuffer_Serial + 14); // get parameter 2
+      unsigned int tempbyte1 = address & 0xFFFF; // get parameter 1, only the 4 lowest digits are sent
+      int tempbyte2 = ringtone;                   // get parameter 2
       //-----------------------------------------------
       unsigned long bitstream1 = tempbyte1; // address
       unsigned long bitstream = tempbyte2;  // ringtone
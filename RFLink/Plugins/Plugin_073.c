@@ -116,13 +116,9 @@ boolean  PluginTX_073(byte function, const char *string)
     boolean success = false;
     unsigned long bitstream = 0L;
     //10;DELTRONIC;001c33;1;OFF;
-    //012345678901234567890123456
-    if (strncasecmp(InputBuffer_Serial + 3, "DELTRONIC;", 10) == 0)
+    Tokenizer::Fields fields(string);
+    if (fields.name("10") && fields.name("DELTRONIC") && fields.hex(bitstream, 6))
     {
-        InputBuffer_Serial[11] = 0x30;
-        InputBuffer_Serial[12] = 0x78;
-        InputBuffer_Serial[19] = 0;
-        bitstream = str2int(InputBuffer_Serial + 11);
         bitstream = (bitstream) | 0x00000FF0L;
         Deltronic_Send(bitstream); // Send RF packet
         success = true;
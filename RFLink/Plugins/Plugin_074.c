@@ -126,13 +126,9 @@ boolean  PluginTX_074(byte function, const char *string)
     boolean success = false;
     unsigned long bitstream = 0;
     //10;Byron MP;001c33;1;OFF;
-    //012345678901234567890123456
-    if (strncasecmp(InputBuffer_Serial + 3, "BYRON MP;", 9) == 0)
+    Tokenizer::Fields fields(string);
+    if (fields.name("10") && fields.name("BYRON MP") && fields.hex(bitstream, 6))
     {
-        InputBuffer_Serial[10] = 0x30;
-        InputBuffer_Serial[11] = 0x78;
-        InputBuffer_Serial[18] = 0;
-        bitstream = str2int(InputBuffer_Serial + 10);
         bitstream = ((bitstream) << 11) | 0x000007ADL;
         RL02_Send(bitstream); // Send RF packet
         success = true;
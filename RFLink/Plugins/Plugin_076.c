@@ -164,41 +164,31 @@ boolean Plugin_076(byte function, const char *string)
  #endif // PLUGIN_076
 
 #ifdef PLUGIN_TX_076
-
+#include "15_Encoder.h"
+
+// bits are sent as a space followed by a mark, a '1' being a short space and a long mark
+const RFLink::Encoder::Protocol PLUGIN_076_Protocol = {
+    {1, HIGH, {PLUGIN_076_PREAMBLE}},
+    {2, LOW, {PLUGIN_076_LONG_PULSE, PLUGIN_076_SHORT_PULSE}},
+    {2, LOW, {PLUGIN_076_SHORT_PULSE, PLUGIN_076_LONG_PULSE}},
+    {1, LOW, {PLUGIN_076_LONG_PULSE}},
+    5,
+    15,
+};
 
 boolean  PluginTX_076(byte function, const char *string)
 {
     RawSignalStruct signal;
 
-    if (strncasecmp(InputBuffer_Serial + 3, "CAME-TOP432;", 11) == 0){
+    Tokenizer::Fields fields(string);
 
-        uint16_t code = 0x78d;
+    if (fields.name("10") && fields.name("CAME-TOP432")){
 
-        signal.Number = PLUGIN_076_PULSE_COUNT;
-        signal.Repeats = 5;
-        signal.Delay = 15;
-        signal.Multiply = RFLink::Signal::params::sample_rate;
-
-        signal.Pulses[1] = PLUGIN_076_PREAMBLE / signal.Multiply;
-
-        for(int i=0; i<12; i++){
-            unsigned long mask = 1;
-            mask = mask << (12 - i -1);
-            
-            if( (code & mask) != 0 ) {
-                signal.Pulses[2+i*2] = PLUGIN_076_SHORT_PULSE / signal.Multiply;
-                signal.Pulses[2+i*2+1] = PLUGIN_076_LONG_PULSE / signal.Multiply;
-            }
-            else {
-                signal.Pulses[2+i*2] = PLUGIN_076_LONG_PULSE / signal.Multiply;
-                signal.Pulses[2+i*2+1] = PLUGIN_076_SHORT_PULSE / signal.Multiply;
-            }
+        uint16_t code = 0x78d;
 
-        }
+        RFLink::Encoder::encode(signal, PLUGIN_076_Protocol, code, 12);
 
-       RawSendRF(&signal);
-       
-       signal.Number=0;
+        RawSendRF(&signal);
     }
     else
         return false;
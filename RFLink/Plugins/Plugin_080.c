@@ -119,17 +119,16 @@ boolean  PluginTX_080(byte function, const char *string)
 {
    boolean success = false;
    //10;FA20RF;67f570;1;ON;
-   //012345678901234567890
    unsigned long bitstream = 0;
-   if (strncasecmp(InputBuffer_Serial + 3, "FA20RF;", 7) == 0)
+   int cmd = 0;
+   Tokenizer::Fields fields(string);
+   if (fields.name("10") && fields.name("FA20RF"))
    { // KAKU Command eg.
-      if (InputBuffer_Serial[18] != ';')
+      if (!fields.hex(bitstream, 6))
+         return false;
+      fields.next(); // unit, not used
+      if (!fields.keyword(cmd)) // ON/OFF
          return false;
-      InputBuffer_Serial[8] = 0x30;
-      InputBuffer_Serial[9] = 0x78;
-      InputBuffer_Serial[16] = 0;
-      bitstream = str2int(InputBuffer_Serial + 8);
-      byte cmd = str2cmd(InputBuffer_Serial + 19); // ON/OFF
       if (cmd != VALUE_ON)
          return true; // pretend command was ok but we dont have to send anything..
       // ---------- SMOKEALERT SEND -----------
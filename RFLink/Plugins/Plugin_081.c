@@ -181,32 +181,32 @@ boolean  PluginTX_081(byte function, const char *string)
    boolean success = false;
    unsigned long bitstream = 0L;
    //10;MERTIK;64;UP;
-   //0123456789012345
-   if (strncasecmp(InputBuffer_Serial + 3, "MERTIK;", 7) == 0)
+   Tokenizer::Fields fields(string);
+   if (fields.name("10") && fields.name("MERTIK"))
    { // KAKU Command eg.
-      if (InputBuffer_Serial[12] != ';')
-         return false;
       unsigned int bitstream2 = 0; // holds last 8 bits
+      int cmd = 0;
 
-      InputBuffer_Serial[8] = 0x30;
-      InputBuffer_Serial[9] = 0x78;                // Get address from hexadecimal value
-      InputBuffer_Serial[12] = 0x00;               // Get address from hexadecimal value
-      bitstream = str2int(InputBuffer_Serial + 8); // Address (first 16 bits)
+      if (!fields.hex(bitstream, 2)) // Address (first 16 bits)
+         return false;
 
-      if (strcasecmp(InputBuffer_Serial + 13, "stop") == 0)
-         bitstream2 = 0x8;
-      else if (strcasecmp(InputBuffer_Serial + 13, "on") == 0)
-         bitstream2 = 0x3;
-      else if (strcasecmp(InputBuffer_Serial + 13, "off") == 0)
-         bitstream2 = 0x7;
-      else if (strcasecmp(InputBuffer_Serial + 13, "up") == 0)
-         bitstream2 = 0xB;
-      else if (strcasecmp(InputBuffer_Serial + 13, "down") == 0)
-         bitstream2 = 0xD;
-      else if (strcasecmp(InputBuffer_Serial + 13, "go_up") == 0)
+      if (fields.name("go_up"))
          bitstream2 = 0xA;
-      else if (strcasecmp(InputBuffer_Serial + 13, "go_down") == 0)
+      else if (fields.name("go_down"))
          bitstream2 = 0xC;
+      else if (fields.keyword(cmd))
+      {
+         if (cmd == VALUE_STOP)
+            bitstream2 = 0x8;
+         else if (cmd == VALUE_ON)
+            bitstream2 = 0x3;
+         else if (cmd == VALUE_OFF)
+            bitstream2 = 0x7;
+         else if (cmd == VALUE_UP)
+            bitstream2 = 0xB;
+         else if (cmd == VALUE_DOWN)
+            bitstream2 = 0xD;
+      }
       if (bitstream2 == 0)
          return false;
       //-----------------------------------------------
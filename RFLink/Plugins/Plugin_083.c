@@ -182,10 +182,10 @@ byte hexchar2hexvalue(char c)
  * hexvalue : Hex String to encode.
  */
 void addHighLowSignalPulses(unsigned long high, unsigned long low, 
-   char * hexvalue, int *currrentPulses)  {
+   const char * hexvalue, size_t length, int *currrentPulses)  {
 
-   int i=0;
-   while (*(hexvalue+i) != '\0') 
+   size_t i=0;
+   while (i < length) 
    {
 #ifdef PLUGIN_083_DEBUG
       Serial.print(*(hexvalue+i));
@@ -285,49 +285,44 @@ boolean  PluginTX_083(byte function, const char *string)
    //
    // Pulses 0082 Multiply 0032 : 0x2 0xb 0x4 0x0 0xc 0x8 0x0 0xf 0x1 0xe END 069c;
 
-   if (strncasecmp(string + 3, "BrelMotor;", 10) == 0)
+   Tokenizer::Fields fields(string);
+   if (fields.name("10") && fields.name("BrelMotor"))
    {
-      int command;
-      char *strings[10];
-      char *ptr = NULL;
-
-      // Tokenize input string
-      byte index = 0;
-      ptr = strtok(string, ";");  // takes a list of delimiters
-      while(ptr != NULL)
-      {
-         strings[index++] = ptr;
-         ptr = strtok(NULL, ";");  // takes a list of delimiters
-      }
-
-      char * address = strings[2]; 
-      char * subaddress = strings[3];
-      char * commandstring = strings[4];
+      int command = 0;
+      int cmd = 0;
+
+      const char * address = fields.field();
+      size_t addressLength = fields.length();
+      fields.next();
+      const char * subaddress = fields.field();
+      size_t subaddressLength = fields.length();
+      fields.next();
+      if (addressLength == 0 || subaddressLength == 0)
+         return false;
 
 #ifdef PLUGIN_083_DEBUG
-      sprintf_P(dbuffer, PSTR("Send BrelMotor %s %s"), address, subaddress);
+      sprintf_P(dbuffer, PSTR("Send BrelMotor %.*s %.*s"), (int)addressLength, address, (int)subaddressLength, subaddress);
       Serial.println(dbuffer);
 #endif
 
-      if (strncasecmp(commandstring, "on", 2) == 0)
-         command = DOOYA_UP_COMMAND;
-      else if (strncasecmp(commandstring, "up", 2) == 0)
+      if (fields.name("go_up"))
          command = DOOYA_UP_COMMAND;
-      else if (strncasecmp(commandstring, "off", 3) == 0)
-         command = DOOYA_DOWN_COMMAND;
-      else if (strncasecmp(commandstring, "stop", 4) == 0)
-         command = DOOYA_STOP_COMMAND;
-      else if (strncasecmp(commandstring, "down", 4) == 0)
-         command = DOOYA_DOWN_COMMAND;
-      else if (strncasecmp(commandstring, "go_up", 5) == 0)
-         command = DOOYA_UP_COMMAND;
-      else if (strncasecmp(commandstring, "go_down", 7) == 0)
+      else if (fields.name("go_down"))
          command = DOOYA_DOWN_COMMAND;
+      else if (fields.keyword(cmd))
+      {
+         if (cmd == VALUE_ON || cmd == VALUE_UP)
+            command = DOOYA_UP_COMMAND;
+         else if (cmd == VALUE_OFF || cmd == VALUE_DOWN)
+            command = DOOYA_DOWN_COMMAND;
+         else if (cmd == VALUE_STOP)
+            command = DOOYA_STOP_COMMAND;
+      }
       if (command == 0)
          return false;
 
 #ifdef PLUGIN_083_DEBUG
-      sprintf_P(dbuffer, PSTR("Send BrelMotor %s %s %s"), address, subaddress, command);
+      sprintf_P(dbuffer, PSTR("Send BrelMotor %.*s %.*s %02x"), (int)addressLength, address, (int)subaddressLength, subaddress, command);
       Serial.println(dbuffer);
 #endif
 
@@ -340,11 +335,11 @@ boolean  PluginTX_083(byte function, const char *string)
       addSinglePulse(DOOYA_RFSTART_0, &currentPulses);
       addSinglePulse(DOOYA_RFSTART_1, &currentPulses);
       // add Body
-      addHighLowSignalPulses(DOOYA_RFHIGH, DOOYA_RFLOW, address, &currentPulses);
-      addHighLowSignalPulses(DOOYA_RFHIGH, DOOYA_RFLOW, subaddress, &currentPulses);
+      addHighLowSignalPulses(DOOYA_RFHIGH, DOOYA_RFLOW, address, addressLength, &currentPulses);
+      addHighLowSignalPulses(DOOYA_RFHIGH, DOOYA_RFLOW, subaddress, subaddressLength, &currentPulses);
       char buffercommand[3];
       sprintf_P(buffercommand, PSTR("%2x"), command);
-      addHighLowSignalPulses(DOOYA_RFHIGH, DOOYA_RFLOW, buffercommand, &currentPulses);
+      addHighLowSignalPulses(DOOYA_RFHIGH, DOOYA_RFLOW, buffercommand, strlen(buffercommand), &currentPulses);
       // add Footer
       addSinglePulse(0, &currentPulses);
       addSinglePulse(DOOYA_RFEND_0, &currentPulses);
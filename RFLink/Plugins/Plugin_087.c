@@ -53,7 +53,6 @@ inline short pulse_type(byte pulse) {
 
 boolean Plugin_087(byte function, const char *string)
 {
-    char tmpbuf[60];
     uint32_t code = 0;
 
     if (RawSignal.Number != NOX_CONTROL_PULSECOUNT)
@@ -95,8 +94,7 @@ boolean Plugin_087(byte function, const char *string)
         code = code << 1;
     }
 
-    sprintf(tmpbuf, "***** code= 0x%04x  %u+%u ********", code, RawSignal.Pulses[i+3]*RawSignal.Multiply, RawSignal.Pulses[i+4]*RawSignal.Multiply );
-    Serial.println(tmpbuf);
+    RFLink::Log::printf(RFLink::Log::Module_Signal, RFLink::Log::Level_Debug, PSTR("***** code= 0x%04x  %u+%u ********"), code, RawSignal.Pulses[i+3]*RawSignal.Multiply, RawSignal.Pulses[i+4]*RawSignal.Multiply );
 
     RawSignal.Repeats = 3;
     RawSignal.Delay = 15;
@@ -110,56 +108,36 @@ boolean Plugin_087(byte function, const char *string)
 
 #include "1_Radio.h"
 #include "2_Signal.h"
+#include "15_Encoder.h"
+
+// a bit is a short ('0') or long ('1') mark followed by a long space
+const RFLink::Encoder::Protocol NOX_Protocol = {
+    {2, HIGH, {NOX_PULSE_LONG_LEN, NOX_HEADER_PULSE_LEN}},
+    {2, HIGH, {NOX_PULSE_SHORT_LEN, NOX_PULSE_LONG_LEN}},
+    {2, HIGH, {NOX_PULSE_LONG_LEN, NOX_PULSE_LONG_LEN}},
+    {2, HIGH, {NOX_PULSE_SHORT_LEN, NOX_PULSE_SHORT_LEN}},
+    3,
+    15,
+};
 
 boolean PluginTX_087(byte function, const char *string)
 {
-    char tmpbuf[60];
     boolean success = false;
     RawSignalStruct signal;
 
-    if (strncasecmp(InputBuffer_Serial + 3, "NOXALARM;", 8) == 0){
-       Serial.println(F("NOX TX Requested"));
-       //RawSignalStruct RawSignal = {0, 0, 0, 0, 0UL};
+    Tokenizer::Fields fields(string);
 
-       signal.Number = NOX_CONTROL_PULSECOUNT;
-       signal.Repeats = 3;
-       signal.Delay = 15;
-       signal.Multiply = 10; 
-       
-       signal.Pulses[1] = NOX_PULSE_LONG_LEN / signal.Multiply;
-       signal.Pulses[2] = NOX_HEADER_PULSE_LEN / signal.Multiply;
+    if (fields.name("10") && fields.name("NOXALARM")){
+       RFLink::Log::printf(RFLink::Log::Module_Radio, RFLink::Log::Level_Debug, PSTR("NOX TX Requested"));
 
        //uint32_t code = 0xb2b4b0e0;
        uint32_t code= 0x10101a8;
 
-       for(int i=3; i < 65; i+=2) {
+       // only the 31 upper bits are sent
+       RFLink::Encoder::encode(signal, NOX_Protocol, code >> 1, 31);
 
-            if( (code & 0x80000000) == 0 )
-                signal.Pulses[i] = NOX_PULSE_SHORT_LEN / signal.Multiply;
-            else
-                signal.Pulses[i] = NOX_PULSE_LONG_LEN / signal.Multiply;
-
-            signal.Pulses[i+1] = NOX_PULSE_LONG_LEN / signal.Multiply;
-
-            sprintf(tmpbuf, "writing pair #%u: %u,%u", (i-1)/2, signal.Pulses[i]*signal.Multiply, signal.Pulses[i+1]*signal.Multiply );
-            Serial.println(tmpbuf);
-
-            itoa (code, tmpbuf, 2);
-            Serial.println(tmpbuf);
-
-            code = code << 1;
-       }
-
-       signal.Pulses[65] = NOX_PULSE_SHORT_LEN / signal.Multiply;
-       signal.Pulses[66] = NOX_PULSE_SHORT_LEN / signal.Multiply;
-
-       //Serial.println(signal.Number);
-
-       //Plugin_087(0,"");
-       //enableTX_generic();
        Signal::RawSendRF(&signal);
-       
-       signal.Number=0;
+
        success = true;
    }
 
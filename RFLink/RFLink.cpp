@@ -30,6 +30,17 @@
 #include "10_Wifi.h"
 #include "11_Config.h"
 #include "12_Portal.h"
+#include "14_Transmit.h"
+#include "16_Batch.h"
+#include "17_Output.h"
+#include "18_Multicast.h"
+#include "20_Devices.h"
+#include "21_Filter.h"
+#include "23_Profiler.h"
+#include "24_Scheduler.h"
+#include "25_Log.h"
+#include "26_SerialTx.h"
+#include "27_Command.h"
 
 #if (defined(__AVR_ATmega328P__) || defined(__AVR_ATmega2560__))
 #include <avr/power.h>
@@ -53,6 +64,10 @@ void CallReboot(void)
 
 void CallReboot(void) {
   RFLink::sendMsgFromBuffer();
+  RFLink::Log::flush();
+  RFLink::Output::flush();
+  RFLink::SerialTx::flush();
+  RFLink::Transmit::flush();
   delay(1);
   ESP.restart();
 }
@@ -64,14 +79,181 @@ namespace RFLink {
     struct timeval timeAtBoot;
     struct timeval scheduledRebootTime;
 
+    enum BootPhase {
+      BootPhase_Serial,
+      BootPhase_Config,
+      BootPhase_Radio,
+      BootPhase_Sinks,
+      BootPhase_Plugins,
+      BootPhase_Receiving,
+      BootPhase_Wifi,
+      BootPhase_Network,
+      BootPhase_EOF,
+    };
+
+    const char *bootPhaseNames[] = {
+            "serial",
+            "config",
+            "radio",
+            "sinks",
+            "plugins",
+            "receiving",
+            "wifi",
+            "network",
+            "EOF" // matches BootPhase::BootPhase_EOF
+    };
+    static_assert(sizeof(bootPhaseNames) / sizeof(char *) == BootPhase::BootPhase_EOF + 1, "bootPhaseNames has missing/extra names, please compare with BootPhase enum declarations");
+
+    unsigned long bootPhaseEnd_ms[BootPhase_EOF] = {0}; // since power up, 0 until the phase is done
+
+    void bootPhaseDone(BootPhase phase) {
+      bootPhaseEnd_ms[phase] = millis();
+      if (bootPhaseEnd_ms[phase] == 0)
+        bootPhaseEnd_ms[phase] = 1;
+    }
+
+    void outputTask() {
+      RFLink::sendMsgFromBuffer();
+      RFLink::Output::mainLoop();
+    }
+
+#if defined(SERIAL_ENABLED) && PIN_RF_TX_DATA_0 != NOT_A_PIN
+    void serialTask() {
+      readSerialAndExecute();
+    }
+#endif
+
+    void receiverTask() {
+      if (RFLink::Signal::ScanEvent())
+        RFLink::sendMsgFromBuffer();
+    }
+
+    void rebootTask() {
+      struct timeval now;
+      gettimeofday(&now, 0);
+      if (scheduledRebootTime.tv_sec != 0 && now.tv_sec > scheduledRebootTime.tv_sec) {
+        Log::printf(Log::Module_Core, Log::Level_Info, PSTR("***** Rebooting now for scheduled reboot !!! *****"));
+        CallReboot(); // flushes the log first
+      }
+    }
+
+#if defined(RFLINK_WIFI_ENABLED)
+    uint8_t networkStartStep = 0;
+
+#ifndef RFLINK_FAST_START_DISABLED
+    extern Scheduler::Task networkStartTask;
+#endif
+
+    /**
+     * Wi-Fi then the servers, one step per call so the receiver gets serviced in between
+     * */
+    void startNetworkStep() {
+      switch (networkStartStep) {
+        case 0:
+          RFLink::Wifi::setup();
+          bootPhaseDone(BootPhase_Wifi);
+          break;
+        case 1:
+          RFLink::Portal::start();
+#ifndef RFLINK_SERIAL2NET_DISABLED
+          RFLink::Serial2Net::setup();
+#endif // !RFLINK_SERIAL2NET_DISABLED
+          bootPhaseDone(BootPhase_Network);
+#ifndef RFLINK_FAST_START_DISABLED
+          Scheduler::unregisterTask(&networkStartTask); // nothing left to start
+#endif
+          break;
+        default:
+          return;
+      }
+      networkStartStep++;
+    }
+#endif // RFLINK_WIFI_ENABLED
+
+    // name, function, period (ms), priority, budget (us), profiler section
+    Scheduler::Task transmitTask("transmit", Transmit::mainLoop, 0, 0, 1000, Profiler::Section_Transmit);
+    Scheduler::Task serialTxTask("serialtx", SerialTx::poll, 0, 0, 500, Profiler::Section_SerialTx);
+    Scheduler::Task commandTask("command", Command::mainLoop, 0, 1, 2000, Profiler::Section_Transmit); // TX commands waiting for the transmitter
+#if defined(SERIAL_ENABLED) && PIN_RF_TX_DATA_0 != NOT_A_PIN
+    Scheduler::Task serialInputTask("serial", serialTask, 0, 1, FOCUS_TIME_MS * 1000UL, Profiler::Section_Serial); // keeps focus while a command is coming
+#endif
+    Scheduler::Task outputBusTask("output", outputTask, 0, 2, 2000, Profiler::Section_Output);
+#ifndef RFLINK_SERIAL2NET_DISABLED
+    Scheduler::Task serial2netTask("serial2net", Serial2Net::serverLoop, 0, 3, 2000, Profiler::Section_Serial2Net);
+#endif
+    Scheduler::Task mqttTask("mqtt", Mqtt::checkMQTTloop, 0, 3, 5000, Profiler::Section_Mqtt);
+#if defined(RFLINK_WIFI_ENABLED)
+    Scheduler::Task portalTask("portal", Portal::mainLoop, 0, 4, 5000, Profiler::Section_Portal);
+    Scheduler::Task wifiTask("wifi", Wifi::mainLoop, 100, 5, 5000, Profiler::Section_Wifi);
+#ifndef RFLINK_FAST_START_DISABLED
+    Scheduler::Task networkStartTask("netstart", startNetworkStep, 0, 3, 5000, Profiler::Section_Wifi); // ahead of wifi and portal tasks
+#endif
+#endif
+    Scheduler::Task batchTask("batch", Batch::mainLoop, 0, 4, 2000, Profiler::Section_Batch);
+    Scheduler::Task filterTask("filter", Filter::mainLoop, 100, 6, 1000, Profiler::Section_Filter);
+    Scheduler::Task logTask("log", Log::mainLoop, 0, 6, 1000, Profiler::Section_Log);
+    Scheduler::Task scheduledRebootTask("reboot", rebootTask, 1000, 7, 1000, Profiler::Section_Other);
+    Scheduler::Task receiverScanTask("receiver", receiverTask, 0, 0, (SCAN_HIGH_TIME_MS + 10) * 1000UL, Profiler::Section_Scan); // sync mode listens for scan_high_time
+
+    void setupScheduler() {
+      Scheduler::registerTask(&transmitTask);
+      Scheduler::registerTask(&serialTxTask);
+      Scheduler::registerTask(&commandTask);
+#if defined(SERIAL_ENABLED) && PIN_RF_TX_DATA_0 != NOT_A_PIN
+      Scheduler::registerTask(&serialInputTask);
+#endif
+      Scheduler::registerTask(&outputBusTask);
+#ifndef RFLINK_SERIAL2NET_DISABLED
+      Scheduler::registerTask(&serial2netTask);
+#endif
+      Scheduler::registerTask(&mqttTask);
+#if defined(RFLINK_WIFI_ENABLED)
+      Scheduler::registerTask(&portalTask);
+      Scheduler::registerTask(&wifiTask);
+#ifndef RFLINK_FAST_START_DISABLED
+      Scheduler::registerTask(&networkStartTask);
+#endif
+#endif
+      Scheduler::registerTask(&batchTask);
+      Scheduler::registerTask(&filterTask);
+      Scheduler::registerTask(&logTask);
+      Scheduler::registerTask(&scheduledRebootTask);
+      Scheduler::setReceiverTask(&receiverScanTask);
+    }
+
+#ifdef SERIAL_ENABLED
+    bool serialSinkIsReady(size_t length) {
+      return SerialTx::available() >= length;
+    }
+
+    bool serialSinkWrite(const char *msg, size_t length) {
+      return SerialTx::write(msg, length, SerialTx::Class_Message);
+    }
+
+    bool serialSinkWriteRaw(const char *msg, size_t length) {
+      return SerialTx::write(msg, length, SerialTx::Class_Debug);
+    }
+
+    // the serial link is the reference interface, we'd rather wait than lose messages
+    Output::Sink serialSink("serial", Output::Format_Line, Output::Drop_Block, OUTPUT_POOL_SIZE,
+                            nullptr, serialSinkIsReady, serialSinkWrite, true, serialSinkWriteRaw);
+#endif // SERIAL_ENABLED
+
     void setup() {
 
+#ifdef RFLINK_FAST_START_DISABLED
       delay(250);         // Time needed to switch back from Upload to Console
+#endif
       Serial.begin(BAUD); // Initialise the serial port
 
       Serial.setRxBufferSize(512);
       Serial.setTimeout(1);
 
+      RFLink::Output::setup();
+#ifdef SERIAL_ENABLED
+      RFLink::Output::registerSink(&serialSink);
+#endif
+
       if (gettimeofday(&timeAtBoot, NULL) != 0) {
         Serial.println(F("Failed to obtain time"));
       }
@@ -116,23 +298,40 @@ namespace RFLink {
 #ifdef OLED_ENABLED
       splash_OLED();
 #endif
+      bootPhaseDone(BootPhase_Serial);
 
 #if defined(ESP32) || (ESP8266)
       RFLink::Config::setup();
+      RFLink::Log::setup();
+      RFLink::SerialTx::setup();
 #endif
+      bootPhaseDone(BootPhase_Config);
+
       RFLink::Radio::setup();
       RFLink::Signal::setup();
+      RFLink::Transmit::setup();
+      RFLink::Batch::setup();
+      RFLink::Devices::setup();
+      RFLink::Filter::setup();
+      bootPhaseDone(BootPhase_Radio);
 
 #if defined(RFLINK_WIFI_ENABLED)
+      // sinks are registered before the receiver starts: MQTT and multicast keep what is decoded meanwhile
+      // in their queue until connected, Serial2Net and WebSocket only serve clients connected at the time
       RFLink::Portal::init();
       RFLink::Mqtt::setup_MQTT();
       RFLink::Serial2Net::setup();
-      RFLink::Wifi::setup();
+      RFLink::Multicast::setup();
+      bootPhaseDone(BootPhase_Sinks);
+#ifdef RFLINK_FAST_START_DISABLED
+      startNetworkStep(); // Wi-Fi
+#endif
 #endif // RFLINK_WIFI_ENABLED
 
 
       PluginInit();
       PluginTXInit();
+      bootPhaseDone(BootPhase_Plugins);
 
       Radio::set_Radio_mode(Radio::Radio_OFF);
 
@@ -149,243 +348,61 @@ namespace RFLink {
       //RFLink::Mqtt::publishMsg();
 #endif
 
+      setupScheduler();
+
       pbuffer[0] = 0;
       Radio::set_Radio_mode(Radio::Radio_RX);
+      bootPhaseDone(BootPhase_Receiving);
+      Log::printf(Log::Module_Core, Log::Level_Info, PSTR("Receiving %lu ms after boot"), bootPhaseEnd_ms[BootPhase_Receiving]);
 
-
-#ifdef RFLINK_WIFI_ENABLED
-      RFLink::Portal::start();
-#ifndef RFLINK_SERIAL2NET_DISABLED
-      RFLink::Serial2Net::setup();
-#endif // !RFLINK_SERIAL2NET_DISABLED
-#endif
+#if defined(RFLINK_WIFI_ENABLED) && defined(RFLINK_FAST_START_DISABLED)
+      startNetworkStep(); // servers
+#endif // otherwise the netstart task takes care of it
     }
 
     void mainLoop() {
-      RFLink::Mqtt::checkMQTTloop();
-      RFLink::sendMsgFromBuffer();
-
-#if defined(RFLINK_WIFI_ENABLED)
-      RFLink::Wifi::mainLoop();
-#endif
-
-#ifndef RFLINK_SERIAL2NET_DISABLED
-      RFLink::Serial2Net::serverLoop();
-#endif // !RFLINK_SERIAL2NET_DISABLED
-
-#if defined(SERIAL_ENABLED) && PIN_RF_TX_DATA_0 != NOT_A_PIN
-      readSerialAndExecute();
-#endif
-
-      if (RFLink::Signal::ScanEvent())
-        RFLink::sendMsgFromBuffer();
-
-      struct timeval now;
-      gettimeofday(&now, 0);
-      if (scheduledRebootTime.tv_sec != 0 && now.tv_sec > scheduledRebootTime.tv_sec) {
-        Serial.println(F("***** Rebooting now for scheduled reboot !!! *****"));
-        ESP.restart();
-      }
+      Scheduler::mainLoop();
     }
 
     void sendMsgFromBuffer() {
       if (pbuffer[0] != 0) {
-
-#ifdef SERIAL_ENABLED
-        Serial.print(pbuffer);
-#endif
-
-#ifndef RFLINK_MQTT_DISABLED
-        RFLink::Mqtt::publishMsg();
-#endif // !RFLINK_MQTT_DISABLED
-
-
-#ifndef RFLINK_SERIAL2NET_DISABLED
-        RFLink::Serial2Net::broadcastMessage(pbuffer);
-#endif // !RFLINK_SERIAL2NET_DISABLED
-
-#ifdef OLED_ENABLED
-        print_OLED();
-#endif
-
+        // allow/deny list first, so rejected devices do not take room in the table
+        if (RFLink::Filter::accepts(pbuffer) && RFLink::Devices::update(pbuffer)) // false if filtered out
+          if (!RFLink::Command::reply(pbuffer)) // answers only go back where the command came from
+            RFLink::Output::publish(pbuffer); // each sink gets its own copy, see 17_Output.h
         pbuffer[0] = 0;
       }
     }
 
     void sendRawPrint(const char *buf) {
-      if (buf[0] != 0) {
-
-#ifdef SERIAL_ENABLED
-        Serial.print(buf);
-#endif
-#ifndef RFLINK_SERIAL2NET_DISABLED
-        RFLink::Serial2Net::broadcastMessage(buf);
-#endif // !RFLINK_SERIAL2NET_DISABLED
-
-      }
+      Output::publishRaw(buf); // coalesced, see 17_Output.h
     }
 
     void sendRawPrint(long n)
     {
-#ifdef SERIAL_ENABLED
-      Serial.print(n);
-#endif
-#ifndef RFLINK_SERIAL2NET_DISABLED
-      RFLink::Serial2Net::broadcastMessage(String(n).c_str());
-#endif // !RFLINK_SERIAL2NET_DISABLED
+      char buf[12];
+      Output::publishRaw(ltoa(n, buf, 10));
     }
 
     void sendRawPrint(unsigned long n)
     {
-#ifdef SERIAL_ENABLED
-      Serial.print(n);
-#endif
-#ifndef RFLINK_SERIAL2NET_DISABLED
-      RFLink::Serial2Net::broadcastMessage(String(n).c_str());
-#endif // !RFLINK_SERIAL2NET_DISABLED
+      char buf[12];
+      Output::publishRaw(ultoa(n, buf, 10));
     }
 
     void sendRawPrint(int n)
     {
-#ifdef SERIAL_ENABLED
-      Serial.print(n);
-#endif
-#ifndef RFLINK_SERIAL2NET_DISABLED
-      RFLink::Serial2Net::broadcastMessage(String(n).c_str());
-#endif // !RFLINK_SERIAL2NET_DISABLED
+      sendRawPrint((long)n);
     }
 
     void sendRawPrint(unsigned int n)
     {
-#ifdef SERIAL_ENABLED
-      Serial.print(n);
-#endif
-#ifndef RFLINK_SERIAL2NET_DISABLED
-      RFLink::Serial2Net::broadcastMessage(String(n).c_str());
-#endif // !RFLINK_SERIAL2NET_DISABLED
+      sendRawPrint((unsigned long)n);
     }
 
     void sendRawPrint(char c)
     {
-#ifdef SERIAL_ENABLED
-      Serial.write(c);
-#endif
-#ifndef RFLINK_SERIAL2NET_DISABLED
-      RFLink::Serial2Net::broadcastMessage(c);
-#endif // !RFLINK_SERIAL2NET_DISABLED
-    }
-
-    bool executeCliCommand(char *cmd) {
-      static byte ValidCommand = 0;
-      if (strlen(cmd) > 7) { // need to see minimal 8 characters on the serial port
-        // 10;....;..;ON;
-        if (strncmp(cmd, "10;", 3) == 0) { // Command from Master to RFLink
-          // -------------------------------------------------------
-          // Handle Device Management Commands
-          // -------------------------------------------------------
-          if (strncasecmp(cmd + 3, "PING;", 5) == 0) {
-            display_Header();
-            display_Name(PSTR("PONG"));
-            display_Footer();
-          } else if (strncasecmp(cmd + 3, "REBOOT;", 7) == 0) {
-            display_Header();
-            display_Name(PSTR("REBOOT"));
-            display_Footer();
-            CallReboot();
-          } else if (strncasecmp(cmd + 3, "RFDEBUG=O", 9) == 0) {
-            if (cmd[12] == 'N' || cmd[12] == 'n') {
-              RFDebug = true;    // full debug on
-              QRFDebug = false;  // q full debug off
-              RFUDebug = false;  // undecoded debug off
-              QRFUDebug = false; // q undecoded debug off
-              display_Header();
-              display_Name(PSTR("RFDEBUG=ON"));
-              display_Footer();
-            } else {
-              RFDebug = false; // full debug off
-              display_Header();
-              display_Name(PSTR("RFDEBUG=OFF"));
-              display_Footer();
-            }
-          } else if (strncasecmp(cmd + 3, "RFUDEBUG=O", 10) == 0) {
-            if (cmd[13] == 'N' || cmd[13] == 'n') {
-              RFDebug = false;   // full debug off
-              QRFDebug = false;  // q debug off
-              RFUDebug = true;   // undecoded debug on
-              QRFUDebug = false; // q undecoded debug off
-              display_Header();
-              display_Name(PSTR("RFUDEBUG=ON"));
-              display_Footer();
-            } else {
-              RFUDebug = false; // undecoded debug off
-              display_Header();
-              display_Name(PSTR("RFUDEBUG=OFF"));
-              display_Footer();
-            }
-          } else if (strncasecmp(cmd + 3, "QRFDEBUG=O", 10) == 0) {
-            if (cmd[13] == 'N' || cmd[13] == 'n') {
-              RFDebug = false;   // full debug off
-              QRFDebug = true;   // q debug on
-              RFUDebug = false;  // undecoded debug off
-              QRFUDebug = false; // q undecoded debug off
-              display_Header();
-              display_Name(PSTR("QRFDEBUG=ON"));
-              display_Footer();
-            } else {
-              QRFDebug = false; // q debug off
-              display_Header();
-              display_Name(PSTR("QRFDEBUG=OFF"));
-              display_Footer();
-            }
-          } else if (strncasecmp(cmd + 3, "QRFUDEBUG=O", 11) == 0) {
-            if (cmd[14] == 'N' || cmd[14] == 'n') {
-              RFDebug = false;  // full debug off
-              QRFDebug = false; // q debug off
-              RFUDebug = false; // undecoded debug off
-              QRFUDebug = true; // q undecoded debug on
-              display_Header();
-              display_Name(PSTR("QRFUDEBUG=ON"));
-              display_Footer();
-            } else {
-              QRFUDebug = false; // q undecode debug off
-              display_Header();
-              display_Name(PSTR("QRFUDEBUG=OFF"));
-              display_Footer();
-            }
-          } else if (strncasecmp(cmd + 3, "VERSION", 7) == 0) {
-            display_Header();
-            display_Splash();
-            display_Footer();
-          } else if (strncasecmp(cmd + 3, "signal", 6) == 0) {
-            Signal::executeCliCommand(cmd + 3 + 6 + 1);
-          } else if (strncasecmp(cmd + 3, "config", 6) == 0) {
-            Config::executeCliCommand(cmd + 3 + 6 + 1);
-          } else {
-            // -------------------------------------------------------
-            // Handle Generic Commands / Translate protocol data into Nodo text commands
-            // -------------------------------------------------------
-            Radio::set_Radio_mode(Radio::Radio_TX);
-
-            if (PluginTXCall(0, cmd))
-              ValidCommand = 1;
-            else // Answer that an invalid command was received?
-              ValidCommand = 2;
-
-            Radio::set_Radio_mode(Radio::Radio_RX);
-          }
-        }
-      } // if > 7
-      if (ValidCommand != 0) {
-        display_Header();
-        if (ValidCommand == 1)
-          display_Name(PSTR("OK"));
-        else
-          display_Name(PSTR("CMD UNKNOWN"));
-        display_Footer();
-      }
-      ValidCommand = 0;
-      sendMsgFromBuffer(); // in case there is a response waiting to be sent
-      return true;
+      Output::publishRaw(&c, 1);
     }
 
     void scheduleReboot(unsigned int seconds) {
@@ -399,7 +416,7 @@ namespace RFLink {
 
       struct timeval now;
       if (gettimeofday(&now, NULL) != 0) {
-        Serial.println(F("Failed to obtain time"));
+        Log::printf(Log::Module_Core, Log::Level_Error, PSTR("Failed to obtain time"));
       }
 
       output["uptime"] = now.tv_sec - timeAtBoot.tv_sec;
@@ -414,6 +431,18 @@ namespace RFLink {
       sprintf_P(buffer, PSTR("RFLink_ESP_%d.%d-%s"), BUILDNR, REVNR, PSTR(RFLINK_BUILDNAME));
       output["sw_version"] = buffer;
 
+      auto &&boot = output.createNestedObject(F("boot"));
+#ifdef RFLINK_FAST_START_DISABLED
+      boot[F("fast_start")] = false;
+#else
+      boot[F("fast_start")] = true;
+#endif
+      auto &&phases = boot.createNestedObject(F("phases_ms")); // end of each phase since power up
+      for (int i = 0; i < BootPhase_EOF; i++) {
+        if (bootPhaseEnd_ms[i] != 0)
+          phases[bootPhaseNames[i]] = bootPhaseEnd_ms[i];
+      }
+
     }
 
 }
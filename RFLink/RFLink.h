@@ -24,6 +24,7 @@
 #endif
 
 #define SERIAL_ENABLED // Send RFLink messages over Serial
+//#define RFLINK_FAST_START_DISABLED // receiver only starts once Wi-Fi and network services are set up, as in older releases
 //#define RFLINK_AUTOOTA_ENABLED // if you want to the device to self-update at boot from a given URKL
                           // dont forget to set the URL in Crendentials.h  
 
@@ -42,7 +43,6 @@
 
 // MQTT messages
 //#define MQTT_ENABLED          // Send RFLink messages over MQTT
-#define MQTT_LOOP_MS 1000     // MQTTClient.loop(); call period (in mSec)
 #define MQTT_RETAINED_0 false // Retained option
 #define MQTT_LWT              // Let know if Module is Online or Offline via MQTT Last Will message
 // #define MQTT_SSL           // Send MQTT messages over SSL
@@ -63,7 +63,6 @@ namespace RFLink {
     void setup();
     void mainLoop();
 
-    bool executeCliCommand(char *cmd);
     void sendMsgFromBuffer();
     void sendRawPrint(const char *buf);
     inline void sendRawPrint(const __FlashStringHelper *buf) {sendRawPrint(reinterpret_cast<const char *>(buf));};